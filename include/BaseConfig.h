@@ -3,11 +3,33 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include "List.h"
+#include "StrUtils.h"
 
-enum paramtype_t : uint8_t { PAR_BOOL, PAR_I8, PAR_UI8, PAR_I16, PAR_UI16, PAR_I32, PAR_UI32, PAR_FLOAT, PAR_CHAR, PAR_STR, PAR_PSWD };
+enum paramtype_t : uint8_t { PAR_BOOL, PAR_I8, PAR_UI8, PAR_I16, PAR_UI16, PAR_I32, PAR_UI32, PAR_FLOAT, PAR_CHAR, PAR_STR, PAR_PSWD, PAR_ARRAY, PAR_BLOB };
+
+constexpr uint8_t paramItemSize(paramtype_t type) { // Array item, PAR_BOOL..PAR_FLOAT only
+  return (type <= PAR_UI8) ? 1 : (type <= PAR_UI16) ? 2 : 4;
+}
+
+enum paramerror_t : uint8_t { PARERR_OK, PARERR_FORMAT, PARERR_RANGE, PARERR_STEP, PARERR_CHOICE, PARERR_PATTERN };
+
+struct __packed paramlimits_t {
+  double _min; // Value or string length, NAN if not limited
+  double _max;
+  double _step; // 0 if any
+  PGM_P _choices; // Allowed values separated by '|' or NULL
+  PGM_P _pattern; // See matchPattern_P() or NULL
+};
+
+#define LIMITS_RANGE(min, max, step) { ._min = (min), ._max = (max), ._step = (step), ._choices = NULL, ._pattern = NULL }
+#define LIMITS_LENGTH(min, max) { ._min = (min), ._max = (max), ._step = 0, ._choices = NULL, ._pattern = NULL }
+#define LIMITS_CHOICES(choices) { ._min = NAN, ._max = NAN, ._step = 0, ._choices = (choices), ._pattern = NULL }
+#define LIMITS_PATTERN(pattern) { ._min = NAN, ._max = NAN, ._step = 0, ._choices = NULL, ._pattern = (pattern) }
 
 struct __packed param_t {
   paramtype_t _type;
+  paramtype_t _item; // Array item type, same as _type for scalars
   PGM_P _name;
   PGM_P _descr;
   uint16_t _size;
@@ -22,29 +44,83 @@ struct __packed param_t {
     float asfloat;
     char aschar;
     PGM_P asstr;
+    const void *asdata; // Array or blob in PROGMEM, NULL for zeros
   } _default;
+  const paramlimits_t *_limits; // In PROGMEM or NULL
+};
+
+#define _PARAM(type, name, descr, size, field, def, limits) _PARAM_ITEM(type, type, name, descr, size, field, def, limits)
+#define _PARAM_ITEM(type, item, name, descr, size, field, def, limits) { ._type = (type), ._item = (item), ._name = (name), ._descr = (descr), ._size = (size), \
+  ._default = { .field = (def) }, ._limits = (limits) }
+
+#define PARAM_BOOL(name, descr, def) _PARAM(PAR_BOOL, name, descr, sizeof(bool), asbool, def, NULL)
+#define PARAM_I8(name, descr, def) _PARAM(PAR_I8, name, descr, sizeof(int8_t), asi8, def, NULL)
+#define PARAM_UI8(name, descr, def) _PARAM(PAR_UI8, name, descr, sizeof(uint8_t), asui8, def, NULL)
+#define PARAM_I16(name, descr, def) _PARAM(PAR_I16, name, descr, sizeof(int16_t), asi16, def, NULL)
+#define PARAM_UI16(name, descr, def) _PARAM(PAR_UI16, name, descr, sizeof(uint16_t), asui16, def, NULL)
+#define PARAM_I32(name, descr, def) _PARAM(PAR_I32, name, descr, sizeof(int32_t), asi32, def, NULL)
+#define PARAM_UI32(name, descr, def) _PARAM(PAR_UI32, name, descr, sizeof(uint32_t), asui32, def, NULL)
+#define PARAM_FLOAT(name, descr, def) _PARAM(PAR_FLOAT, name, descr, sizeof(float), asfloat, def, NULL)
+#define PARAM_CHAR(name, descr, def) _PARAM(PAR_CHAR, name, descr, sizeof(char), aschar, def, NULL)
+#define PARAM_STR(name, descr, size, def) _PARAM(PAR_STR, name, descr, size, asstr, def, NULL)
+#define PARAM_PSWD(name, descr, size, def) _PARAM(PAR_PSWD, name, descr, size, asstr, def, NULL)
+#define PARAM_ARRAY(name, descr, item, count, def) _PARAM_ITEM(PAR_ARRAY, item, name, descr, (count) * paramItemSize(item), asdata, def, NULL)
+#define PARAM_BLOB(name, descr, size, def) _PARAM_ITEM(PAR_BLOB, PAR_UI8, name, descr, size, asdata, def, NULL)
+
+#define PARAM_I8_LIMITS(name, descr, def, limits) _PARAM(PAR_I8, name, descr, sizeof(int8_t), asi8, def, &(limits))
+#define PARAM_UI8_LIMITS(name, descr, def, limits) _PARAM(PAR_UI8, name, descr, sizeof(uint8_t), asui8, def, &(limits))
+#define PARAM_I16_LIMITS(name, descr, def, limits) _PARAM(PAR_I16, name, descr, sizeof(int16_t), asi16, def, &(limits))
+#define PARAM_UI16_LIMITS(name, descr, def, limits) _PARAM(PAR_UI16, name, descr, sizeof(uint16_t), asui16, def, &(limits))
+#define PARAM_I32_LIMITS(name, descr, def, limits) _PARAM(PAR_I32, name, descr, sizeof(int32_t), asi32, def, &(limits))
+#define PARAM_UI32_LIMITS(name, descr, def, limits) _PARAM(PAR_UI32, name, descr, sizeof(uint32_t), asui32, def, &(limits))
+#define PARAM_FLOAT_LIMITS(name, descr, def, limits) _PARAM(PAR_FLOAT, name, descr, sizeof(float), asfloat, def, &(limits))
+#define PARAM_CHAR_LIMITS(name, descr, def, limits) _PARAM(PAR_CHAR, name, descr, sizeof(char), aschar, def, &(limits))
+#define PARAM_STR_LIMITS(name, descr, size, def, limits) _PARAM(PAR_STR, name, descr, size, asstr, def, &(limits))
+#define PARAM_PSWD_LIMITS(name, descr, size, def, limits) _PARAM(PAR_PSWD, name, descr, size, asstr, def, &(limits))
+#define PARAM_ARRAY_LIMITS(name, descr, item, count, def, limits) _PARAM_ITEM(PAR_ARRAY, item, name, descr, (count) * paramItemSize(item), asdata, def, &(limits))
+
+struct __packed paramsection_t {
+  PGM_P _name;
+  uint8_t _count; // Consecutive params following previous section
+};
+
+#define SECTION(name, count) { ._name = (name), ._count = (count) }
+
+struct __packed parammigration_t {
+  uint16_t _version; // Schema version which renamed param, table is sorted by it
+  PGM_P _from; // Name in files of older schema
+  PGM_P _to;
 };
 
-#define PARAM_BOOL(name, descr, def) { ._type = PAR_BOOL, ._name = (name), ._descr = (descr), ._size = sizeof(bool), ._default = { .asbool = (def) } }
-#define PARAM_I8(name, descr, def) { ._type = PAR_I8, ._name = (name), ._descr = (descr), ._size = sizeof(int8_t), ._default = { .asi8 = (def) } }
-#define PARAM_UI8(name, descr, def) { ._type = PAR_UI8, ._name = (name), ._descr = (descr), ._size = sizeof(uint8_t), ._default = { .asui8 = (def) } }
-#define PARAM_I16(name, descr, def) { ._type = PAR_I16, ._name = (name), ._descr = (descr), ._size = sizeof(int16_t), ._default = { .asi16 = (def) } }
-#define PARAM_UI16(name, descr, def) { ._type = PAR_UI16, ._name = (name), ._descr = (descr), ._size = sizeof(uint16_t), ._default = { .asui16 = (def) } }
-#define PARAM_I32(name, descr, def) { ._type = PAR_I32, ._name = (name), ._descr = (descr), ._size = sizeof(int32_t), ._default = { .asi32 = (def) } }
-#define PARAM_UI32(name, descr, def) { ._type = PAR_UI32, ._name = (name), ._descr = (descr), ._size = sizeof(uint32_t), ._default = { .asui32 = (def) } }
-#define PARAM_FLOAT(name, descr, def) { ._type = PAR_FLOAT, ._name = (name), ._descr = (descr), ._size = sizeof(float), ._default = { .asfloat = (def) } }
-#define PARAM_CHAR(name, descr, def) { ._type = PAR_CHAR, ._name = (name), ._descr = (descr), ._size = sizeof(char), ._default = { .aschar = (def) } }
-#define PARAM_STR(name, descr, size, def) { ._type = PAR_STR, ._name = (name), ._descr = (descr), ._size = (size), ._default = { .asstr = (def) } }
-#define PARAM_PSWD(name, descr, size, def) { ._type = PAR_PSWD, ._name = (name), ._descr = (descr), ._size = (size), ._default = { .asstr = (def) } }
+#define MIGRATE_RENAME(version, from, to) { ._version = (version), ._from = (from), ._to = (to) }
 
 const char EMPTYSTR[] PROGMEM = "";
-const char CONFIG_FILE_NAME[] PROGMEM = "/config.json";
+const char CONFIG_FILE_NAME[] PROGMEM = "/config.json"; // Also holds first section
+const char CONFIG_SECTION_PREFIX[] PROGMEM = "/config_";
+const char CONFIG_SECTION_EXT[] PROGMEM = ".json";
+const char CONFIG_SCHEMA_KEY[] PROGMEM = "$schema"; // Written first to each config file
+const char PSWD_MASK[] PROGMEM = "********"; // Returned instead of password, posting it back keeps current value
+const char PSWD_SEALED[] PROGMEM = "$cp1$"; // Prefix of encrypted password in storage
 
 class BaseConfig {
 public:
   static const uint8_t ERR_INDEX = 0xFF;
 
-  BaseConfig(const param_t *params, uint8_t paramCount) : _params((param_t*)params), _paramCount(paramCount) {}
+  typedef void (*paramchanged_t)(uint8_t index, const void *oldValue, const void *newValue, void *arg);
+
+  BaseConfig(const param_t *params, uint8_t paramCount, const paramsection_t *sections = NULL, uint8_t sectionCount = 0) : _params((param_t*)params), _paramCount(paramCount),
+    _sections((paramsection_t*)sections), _sectionCount(sectionCount), _loaded(0), _dirty(0), _jsonDoc(NULL), _nameIndex(NULL),
+    _staging(NULL), _offsets(NULL), _generation(0), _updating(false), _migrations(NULL), _migrationCount(0), _schema(0) {}
+  virtual ~BaseConfig() {
+    if (_jsonDoc)
+      delete _jsonDoc;
+    if (_nameIndex)
+      free(_nameIndex);
+    if (_staging)
+      free(_staging);
+    if (_offsets)
+      free(_offsets);
+  }
 
   uint8_t paramCount() const {
     return _paramCount;
@@ -53,28 +129,192 @@ public:
   uint8_t findParam(const char *name) const;
   uint8_t findParam_P(PGM_P name) const;
   paramtype_t paramType(uint8_t index) const;
+  paramtype_t itemType(uint8_t index) const;
+  uint16_t itemCount(uint8_t index) const;
   PGM_P paramName(uint8_t index) const;
   PGM_P paramDescr(uint8_t index) const;
   uint16_t paramSize(uint8_t index) const;
+  bool getLimits(uint8_t index, paramlimits_t &limits) const;
+  paramerror_t checkParam(uint8_t index, const void *value) const;
   virtual void *getParamPtr(uint8_t index) = 0;
+  virtual bool setParam(uint8_t index, const char *value);
+
+  uint8_t sectionCount() const;
+  PGM_P sectionName(uint8_t section) const;
+  uint8_t findSection(const char *name) const;
+  uint8_t paramSection(uint8_t index) const;
+  bool sectionRange(uint8_t section, uint8_t &first, uint8_t &count) const;
+  String sectionFile(uint8_t section) const;
+  bool isLoaded(uint8_t section) const {
+    return (_loaded >> section) & 1;
+  }
+  bool require(uint8_t section);
+  bool requireAll();
+
+  void setSchema(uint16_t version, const parammigration_t *migrations = NULL, uint8_t migrationCount = 0);
+  uint16_t schema() const {
+    return _schema;
+  }
 
   virtual void clear();
   virtual bool load();
+  virtual bool load(uint8_t section);
   virtual bool save();
 
   virtual String toString();
   virtual bool fromString(const String &str);
+  virtual bool fromJson(const char *json, size_t length, uint8_t section = ERR_INDEX);
+  virtual size_t exportJson(Print &out);
+
+  virtual size_t toMsgPack(Print &out, uint8_t section = ERR_INDEX);
+  virtual bool fromMsgPack(const uint8_t *data, size_t size, uint8_t section = ERR_INDEX);
+
+  size_t jsonCapacity() const;
+  size_t jsonLength() const;
+
+  bool beginUpdate();
+  bool commitUpdate();
+  void cancelUpdate();
+  bool updating() const {
+    return _updating;
+  }
+
+  uint32_t generation() const {
+    return _generation;
+  }
+  bool readParam(uint8_t index, void *dest, uint32_t *generation = NULL);
+  size_t snapshotSize();
+  bool snapshot(void *dest, uint32_t *generation = NULL);
+  bool restore(const void *src); // Publishes values taken by snapshot()
+
+  bool subscribe(uint8_t index, paramchanged_t callback, void *arg = NULL);
+  bool subscribe_P(PGM_P prefix, paramchanged_t callback, void *arg = NULL);
+  void unsubscribe(paramchanged_t callback, void *arg = NULL);
+
+  uint8_t errorCount() const {
+    return _errors.count();
+  }
+  bool getError(uint8_t i, uint8_t &index, paramerror_t &error) const;
+  static PGM_P errorText(paramerror_t error);
 
 protected:
-  static const uint16_t JSON_BUF_SIZE = 1024;
+  static const uint8_t READ_ATTEMPTS = 4;
+  static const uint8_t MAX_ERRORS = 8;
+  static const uint8_t MAX_SECTIONS = 16;
+  static const uint8_t SEAL_KEY_SIZE = 32; // ChaCha20-Poly1305
+  static const uint8_t SEAL_NONCE_SIZE = 12;
+  static const uint8_t SEAL_TAG_SIZE = 16;
+
+  enum mpcode_t : uint8_t { MP_FIXMAP = 0x80, MP_FIXARRAY = 0x90, MP_FIXSTR = 0xA0, MP_NIL = 0xC0, MP_FALSE = 0xC2, MP_TRUE = 0xC3,
+    MP_BIN8 = 0xC4, MP_BIN16 = 0xC5, MP_FLOAT32 = 0xCA, MP_FLOAT64 = 0xCB, MP_UINT8 = 0xCC, MP_UINT16 = 0xCD, MP_UINT32 = 0xCE, MP_UINT64 = 0xCF,
+    MP_INT8 = 0xD0, MP_INT16 = 0xD1, MP_INT32 = 0xD2, MP_INT64 = 0xD3, MP_STR8 = 0xD9, MP_STR16 = 0xDA, MP_ARRAY16 = 0xDC, MP_MAP16 = 0xDE };
+
+  struct mpreader_t {
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+  };
+
+  struct mpvalue_t {
+    enum { MP_NIL, MP_BOOL, MP_INT, MP_FLOAT, MP_STR, MP_BIN, MP_ARRAY } kind; // Array items follow in reader
+    union {
+      int64_t i;
+      float f;
+      const char *str;
+    };
+    uint16_t len;
+  };
+
+  JsonDocument *getJsonDoc();
+
+  void *paramPtr(uint8_t index);
+  bool buildOffsets();
+  virtual void paramChanged(uint8_t index, const void *oldValue, const void *newValue);
+
+  void setDefault(uint8_t index);
+  bool parseParam(uint8_t index, const char *value);
+  bool validateParam(uint8_t index);
+  bool paramError(uint8_t index, paramerror_t error);
+  void setLoaded(uint8_t first, uint8_t count);
+  bool saveSection(uint8_t section);
+  bool setParam(uint8_t index, const mpvalue_t &value);
+  bool setArray(uint8_t index, mpreader_t &reader, uint16_t count);
+  uint8_t migrateName(const char *name, uint16_t version) const;
+  bool convertParam(uint8_t index, const char *value);
+  static paramerror_t convertItem(void *ptr, paramtype_t type, const char *value);
+  static bool setInt(void *ptr, paramtype_t partype, int64_t value);
+  static paramerror_t parseItem(void *ptr, paramtype_t type, const char *value);
+  static paramerror_t setItem(void *ptr, paramtype_t type, const mpvalue_t &value);
+  static paramerror_t checkNumber(const paramlimits_t &limits, double value);
+  static double itemValue(const void *ptr, paramtype_t type);
+
+  static size_t sealedLength(uint16_t size) { // Of password param, without terminator
+    return strlen_P(PSWD_SEALED) + base64Length(SEAL_NONCE_SIZE + size - 1 + SEAL_TAG_SIZE);
+  }
+  virtual void sealKey(uint8_t *key);
+  bool sealPassword(uint8_t index, const char *value, char *sealed);
+  bool openPassword(uint8_t index, const char *sealed, char *value);
+  bool setPassword(uint8_t index, const char *value, uint16_t len);
+
+  static size_t mpWriteUInt(Print &out, uint8_t code, uint32_t value, uint8_t bytes);
+  static size_t mpWriteInt(Print &out, int32_t value);
+  static size_t mpWriteUnsigned(Print &out, uint32_t value);
+  static size_t mpWriteStrHeader(Print &out, uint16_t len);
+  static size_t mpWriteItem(Print &out, paramtype_t type, const void *value);
+  static bool mpRead(mpreader_t &reader, void *buf, size_t size);
+  static uint32_t mpReadUInt(mpreader_t &reader, uint8_t bytes);
+  static bool mpReadValue(mpreader_t &reader, mpvalue_t &value);
+  static bool mpSkipValue(mpreader_t &reader, uint8_t depth);
 
-  virtual void read(const JsonDocument &doc);
-  virtual void write(JsonDocument &doc);
+  virtual void write(JsonDocument &doc, uint8_t first, uint8_t count);
 
   struct __packed {
     param_t *_params;
     uint8_t _paramCount;
+    paramsection_t *_sections; // Without sections all params form one
+    uint8_t _sectionCount;
+    uint16_t _loaded; // Bitmap of sections
+    uint16_t _dirty; // Bitmap of sections changed since load or save
   };
+  DynamicJsonDocument *_jsonDoc; // Reusable memory pool sized from params
+
+  struct __packed paramindex_t {
+    uint16_t hash;
+    uint8_t index;
+  };
+
+  static uint16_t nameHash(const char *name, bool progmem);
+  bool buildNameIndex() const;
+  uint8_t lowerBound(uint16_t hash) const;
+
+  mutable paramindex_t *_nameIndex; // Params sorted by name hash, built on first lookup
+
+  uint8_t *_staging; // New values followed by previous values of changed params
+  uint16_t *_offsets; // Packed offset of each param value, _paramCount + 1 items
+  volatile uint32_t _generation; // Odd while publishing
+  bool _updating;
+
+  struct __packed subscription_t {
+    paramchanged_t callback;
+    void *arg;
+    PGM_P prefix; // Group of params by name prefix or NULL
+    uint8_t index;
+  };
+
+  List<subscription_t, 32> _subscriptions;
+
+  struct __packed fielderror_t {
+    uint8_t index;
+    paramerror_t error;
+  };
+
+  StaticList<fielderror_t, MAX_ERRORS> _errors; // Rejected params of last update
+
+  parammigration_t *_migrations; // In PROGMEM
+  uint8_t _migrationCount;
+  uint16_t _schema; // 0 if not versioned
+
+  friend class ConfigParser;
 };
 
 bool initSPIFFS();
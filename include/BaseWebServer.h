@@ -8,23 +8,50 @@
 #endif
 #include "Customization.h"
 #include "BaseConfig.h"
+#include "HtmlHelper.h"
+#include "ScratchPool.h"
+
+class ConfigParser;
 
 const char INDEX_HTML[] PROGMEM = "index.html";
-const char ROOT_URI[] PROGMEM = "/";
-const char SETUP_URI[] PROGMEM = "/setup";
-const char CONFIG_URI[] PROGMEM = "/config";
-const char SCRIPT_URI[] PROGMEM = "/script.js";
-const char CSS_URI[] PROGMEM = "/styles.css";
-const char RESTART_URI[] PROGMEM = "/restart";
-const char SPIFFS_URI[] PROGMEM = "/spiffs";
-const char FWUPDATE_URI[] PROGMEM = "/fwupdate";
+#define ROOT_URI_STR "/"
+const char ROOT_URI[] PROGMEM = ROOT_URI_STR;
+#define SETUP_URI_STR "/setup"
+const char SETUP_URI[] PROGMEM = SETUP_URI_STR;
+#define CONFIG_URI_STR "/config"
+const char CONFIG_URI[] PROGMEM = CONFIG_URI_STR;
+#define API_CONFIG_URI_STR "/api/config" // Raw JSON or MessagePack body, form posts stay on CONFIG_URI
+const char API_CONFIG_URI[] PROGMEM = API_CONFIG_URI_STR;
+#define SCRIPT_URI_STR "/script.js"
+const char SCRIPT_URI[] PROGMEM = SCRIPT_URI_STR;
+#define CSS_URI_STR "/styles.css"
+const char CSS_URI[] PROGMEM = CSS_URI_STR;
+#define RESTART_URI_STR "/restart"
+const char RESTART_URI[] PROGMEM = RESTART_URI_STR;
+#define SPIFFS_URI_STR "/spiffs"
+const char SPIFFS_URI[] PROGMEM = SPIFFS_URI_STR;
+#define FWUPDATE_URI_STR "/fwupdate"
+const char FWUPDATE_URI[] PROGMEM = FWUPDATE_URI_STR;
+#ifdef BUNDLE_KEY
+#define BUNDLE_URI_STR "/bundle"
+const char BUNDLE_URI[] PROGMEM = BUNDLE_URI_STR;
+#endif
+#ifdef USE_METRICS
+#define METRICS_URI_STR "/metrics"
+const char METRICS_URI[] PROGMEM = METRICS_URI_STR;
+#endif
+#ifdef USE_HEAPTRACE
+#define HEAPTRACE_URI_STR "/heaptrace"
+const char HEAPTRACE_URI[] PROGMEM = HEAPTRACE_URI_STR;
+#endif
 
 class BaseWebServer {
 public:
-  BaseWebServer(const BaseConfig *config) : _config((BaseConfig*)config), _http(NULL) {}
+  BaseWebServer(const BaseConfig *config) : _config((BaseConfig*)config), _http(NULL), _parser(NULL), _bodyLength(0), _bodyStatus(0), _bodyType(BODY_JSON) {}
   virtual ~BaseWebServer() {
     if (_http)
-      delete[] _http;
+      delete _http;
+    freeBody();
   }
 
   virtual bool _setup();
@@ -32,6 +59,10 @@ public:
   virtual void begin();
 
 protected:
+  static const uint16_t MAX_BODY_SIZE = 2048; // Max raw config body length
+
+  enum bodytype_t : uint8_t { BODY_JSON, BODY_MSGPACK };
+
   virtual void cleanup();
   virtual void restart();
 
@@ -42,19 +73,40 @@ protected:
   virtual void handleScript();
   virtual void handleRoot();
   virtual void handleSetup();
+#ifdef USE_SSR_SETUP
+  virtual void handleSetupForm();
+#endif
   virtual void handleGetConfig();
   virtual void handleSetConfig();
+  virtual void handleSetConfigBody();
+  virtual void handleConfigBody();
   virtual void handleClearConfig();
   virtual void handleRestart();
   virtual void handleSPIFFS();
+  void printFiles(Print &out);
   virtual void handleFileUploaded();
   virtual void handleFileUpload();
   virtual void handleFileDelete();
+  virtual void handleFilesDelete();
   virtual void handleFwUpdate();
   virtual void handleSketchUpdated();
   virtual void handleSketchUpdate();
+#ifdef BUNDLE_KEY
+  virtual void handleExport();
+  virtual void handleImport();
+  virtual void handleBundleBody();
+  uint16_t importBundle(File &file); // HTTP status, bundle is applied whole or not at all
+  bool isConfigFile(const String &path) const; // Written by config itself, never bundled as file
+#endif
+#ifdef USE_METRICS
+  virtual void handleMetrics();
+#endif
+#ifdef USE_HEAPTRACE
+  virtual void handleHeapTrace();
+#endif
 #ifdef USE_AUTHORIZATION
-  virtual bool checkAuthorization();
+  virtual bool isAuthorized();
+  virtual bool checkAuthorization(); // Asks for credentials when not authorized
 #endif
   virtual bool beforeHandle() {
 #ifdef USE_AUTHORIZATION
@@ -66,6 +118,12 @@ protected:
   virtual String getContentType(const String &fileName);
   virtual bool handleFileRead(const String &path);
   virtual String getCss();
+  virtual void templateValue(Print &out, const char *name); // Placeholders of page templates
+  void sendTemplate(PGM_P tmpl, uint16_t retcode = 200);
+  static void templateCallback(Print &out, const char *name, void *arg);
+
+  bool getSection(uint8_t &section);
+  void freeBody();
 
   BaseConfig *_config;
 #ifdef ESP32
@@ -73,6 +131,12 @@ protected:
 #else
   ESP8266WebServer *_http;
 #endif
+  ScratchBuffer _body;
+  ConfigParser *_parser;
+  size_t _bodyLength;
+  uint16_t _bodyStatus;
+  bodytype_t _bodyType;
+  PageBuilder _page; // Shared by handlers building whole response in memory
 };
 
 #endif
@@ -0,0 +1,14 @@
+#ifndef __BENCHMARK_H
+#define __BENCHMARK_H
+
+#include <Arduino.h>
+
+// Times config serialization paths over synthetic param tables, one CSV line per result:
+// BENCH,path,params,strsize,ns/op,allocs/op,bytes/op,peak
+// then sealing and opening of one password param:
+// BENCH,path,passwords,strsize,ns/op
+// and PROGMEM string compares against their byte at a time references:
+// BENCH,path,offset,strlen,ns/op
+void runBenchmarks(Print &out);
+
+#endif
@@ -10,13 +10,13 @@
 class CaptivePortal : public BaseWebServer {
 public:
 #ifdef USE_LED
-  CaptivePortal(const BaseConfig *config, const Led *led) : BaseWebServer(config), _led((Led*)led), _dns(NULL) {}
+  CaptivePortal(const BaseConfig *config, const Led *led) : BaseWebServer(config), _led((Led*)led), _dns(NULL), _apChannel(0), _scanning(false), _surveyChannel(false) {}
 #else
-  CaptivePortal(const BaseConfig *config) : BaseWebServer(config), _dns(NULL) {}
+  CaptivePortal(const BaseConfig *config) : BaseWebServer(config), _dns(NULL), _apChannel(0), _scanning(false), _surveyChannel(false) {}
 #endif
   ~CaptivePortal() {
     if (_dns)
-      delete[] _dns;
+      delete _dns;
   }
 
   bool _setup();
@@ -26,7 +26,7 @@ public:
 
   virtual String ssid() const;
   virtual String password() const;
-  virtual uint8_t channel() const;
+  virtual uint8_t channel() const; // Result of last survey kept across reboots, 1 before first one. Override not calling it keeps its channel unless autoChannel() returns true
 
 protected:
 #ifdef USE_LED
@@ -44,11 +44,18 @@ protected:
   }
 
   virtual bool isCaptivePortal();
+  virtual bool autoChannel() const { // Survey channels while AP is up and move to least interfered one, only for channel() of this class by default
+    return _surveyChannel;
+  }
+  void checkSurvey();
 
 #ifdef USE_LED
   Led *_led;
 #endif
   DNSServer *_dns;
+  uint8_t _apChannel;
+  bool _scanning;
+  mutable bool _surveyChannel; // Set by channel() of this class, so overridden channel() is not moved
 };
 
 #endif
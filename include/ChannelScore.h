@@ -0,0 +1,19 @@
+#ifndef __CHANNELSCORE_H
+#define __CHANNELSCORE_H
+
+#include <inttypes.h>
+#include <pgmspace.h>
+
+// Chooses 2.4 GHz AP channel from scan results, no WiFi dependencies (recorded scans can be replayed on host)
+
+struct wifinet_t {
+  uint8_t channel;
+  int8_t rssi; // dBm
+};
+
+const int8_t CHANNEL_QUIET = -128; // Interference level of channel without any overlapping network
+
+int8_t channelInterference(const wifinet_t *nets, uint8_t count, uint8_t channel); // Total received power in dBm
+uint8_t bestChannel(const wifinet_t *nets, uint8_t count, uint8_t maxChannel); // Least interfered, 1, 6 and 11 win ties
+
+#endif
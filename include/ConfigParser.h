@@ -0,0 +1,83 @@
+#ifndef __CONFIGPARSER_H
+#define __CONFIGPARSER_H
+
+#include <Arduino.h>
+#include "BaseConfig.h"
+#include "StrUtils.h"
+
+class ConfigParser {
+public:
+  static const uint8_t MAX_KEY_LENGTH = 32; // Longer keys are skipped as unknown
+  static const uint8_t MAX_TEXT_LENGTH = 24; // Number or literal text
+
+  enum parseerror_t : uint8_t { PARSE_OK, PARSE_SYNTAX, PARSE_INCOMPLETE, PARSE_UPDATE, PARSE_INVALID };
+
+  ConfigParser(BaseConfig *config, bool strict = false, uint8_t section = BaseConfig::ERR_INDEX);
+  ~ConfigParser();
+
+  bool parse(char c);
+  bool parse(const char *data, size_t length);
+  bool parse(Stream &stream);
+  bool finish();
+
+  parseerror_t error() const {
+    return _error;
+  }
+  uint8_t invalidCount() const {
+    return _invalid;
+  }
+  bool migrating() const { // Input is of older schema
+    return _version < _config->_schema;
+  }
+
+protected:
+  enum parsestate_t : uint8_t { PS_START, PS_KEY_OR_END, PS_KEY_START, PS_KEY, PS_COLON, PS_VALUE, PS_STRING, PS_NUMBER, PS_LITERAL, PS_ARRAY, PS_SKIP, PS_AFTER_VALUE, PS_DONE };
+
+  bool parseEscape(char c);
+  void keyComplete();
+  void putChar(char c);
+  void putUnicode(uint16_t code);
+  void putBase64(char c);
+  void putByte(uint8_t b);
+  void valueComplete(bool quoted);
+  void itemComplete();
+  void arrayComplete();
+  void blobComplete();
+  void freeSecret();
+  void markSeen();
+  bool fail();
+
+  static bool isSpace(char c) {
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+  }
+
+  BaseConfig *_config;
+  char *_target; // String parameter being parsed in place or password buffer
+  uint16_t _capacity;
+  uint8_t _seen[32]; // Bitmap of up to 256 parameters
+  char _key[MAX_KEY_LENGTH];
+  char _text[MAX_TEXT_LENGTH];
+  uint16_t _length; // Length of current key, text or string value
+  uint16_t _unicode;
+  uint16_t _item; // Index of next array item
+  uint16_t _version; // Schema of input
+  uint32_t _quad; // Pending base64 bits of blob value
+  uint8_t _index; // Current parameter index or BaseConfig::ERR_INDEX
+  uint8_t _first; // Params of section, others are skipped
+  uint8_t _count;
+  uint8_t _depth; // Nesting of skipped value
+  uint8_t _escape; // 0 - none, 1 - after backslash, 2..5 - \uXXXX digits
+  uint8_t _quadLen;
+  uint8_t _invalid;
+  bool _overflow;
+  bool _inString; // Inside string of skipped value
+  bool _blob; // String value is base64 decoded into blob parameter
+  bool _secret; // _target is allocated for password value
+  bool _schemaKey; // Value is schema version of input
+  bool _active; // Update transaction is open
+  bool _strict; // Reject whole update on invalid value instead of using default
+  parsestate_t _state;
+  parseerror_t _error;
+};
+
+#endif
@@ -4,12 +4,19 @@
 #define USE_SERIAL // Use UART for output
 #define USE_LED // Use led for visualization
 //#define USE_AUTHORIZATION // Use web page basic authorization
+//#define USE_SSR_SETUP // Render setup form on server side (no script required)
+//#define USE_BENCHMARK // Print config benchmark results to UART on boot (see env:d1_mini_bench)
+//#define USE_METRICS // Collect latency histograms and heap stats, enables /metrics
+//#define USE_HEAPTRACE // Count heap allocations per request, enables /heaptrace, needs malloc wrapping linker flags (see env:d1_mini_heaptrace)
+//#define USE_SCRATCH_POOL // Reserve request body buffers at boot, answer 503 when all are busy
 
 #ifdef USE_AUTHORIZATION
 #define AUTH_USER "ESP" // User name for basic authorization
 #define AUTH_PSWD "12345678" // Password for basic authorization
 #endif
 
+//#define BUNDLE_KEY "change me" // Shared secret signing config export bundles, enables /bundle
+
 //#define CP_SSID "ESP" // Non-automatic Captive Portal AP name
 //#define CP_PSWD "1029384756" // Non-automatic Captive Portal AP password
 
@@ -17,5 +24,6 @@
 #define CP_SALT "12" // Captive Portal AP password suffix
 
 #define MAX_WIFI_CHANNEL 13 // Max WiFi channel for AP (11 for North America, 13 for Europe)
+#define CP_RTC_BLOCK 126 // First of two 4-byte blocks of RTC user memory caching surveyed AP channel (ESP8266)
 
 #endif
@@ -0,0 +1,35 @@
+#ifndef __HEAPTRACE_H
+#define __HEAPTRACE_H
+
+#include <inttypes.h>
+#include "Customization.h"
+
+// Counts heap allocations between heapTraceBegin() and heapTraceEnd(), all zero without USE_HEAPTRACE.
+// USE_HEAPTRACE needs linking with -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc -Wl,--wrap=free
+
+struct heaptrace_t {
+  uint32_t allocs; // malloc(), calloc() and realloc() calls
+  uint32_t frees; // free() calls
+  uint32_t bytes; // Requested by allocations
+  uint32_t peak; // Max heap used above level at begin
+  int32_t retained; // Heap still used at end
+};
+
+void heapTraceBegin();
+void heapTraceEnd(heaptrace_t &trace);
+
+#ifdef USE_HEAPTRACE
+const uint8_t HEAPTRACE_HISTORY = 16; // Last traced requests kept
+const uint8_t HEAPTRACE_ROUTE = 32;
+
+struct heaprequest_t {
+  uint32_t time; // millis() at end
+  heaptrace_t trace;
+  char route[HEAPTRACE_ROUTE]; // Method and URI, truncated
+};
+
+void heapTraceRecord(const char *method, const char *uri, const heaptrace_t &trace);
+const heaprequest_t *heapTraceRequest(uint8_t index); // Newest first, NULL past end
+#endif
+
+#endif
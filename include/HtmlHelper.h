@@ -1,24 +1,83 @@
 #ifndef __HTMLHELPER_H
 #define __HTMLHELPER_H
 
+#include <Print.h>
 #include <WString.h>
 
 const char TEXT_HTML[] PROGMEM = "text/html";
 const char TEXT_PLAIN[] PROGMEM = "text/plain";
 const char TEXT_CSS[] PROGMEM = "text/css";
 const char APPLICATION_JSON[] PROGMEM = "application/json";
-const char APPLICATION_JAVASCRIPT[] PROGMEM = "application/javascript";
+#define APPLICATION_JAVASCRIPT_STR "application/javascript"
+const char APPLICATION_JAVASCRIPT[] PROGMEM = APPLICATION_JAVASCRIPT_STR;
+const char APPLICATION_MSGPACK[] PROGMEM = "application/msgpack";
+const char MSGPACK_SUBTYPE[] PROGMEM = "msgpack"; // Matches "application/x-msgpack" too
 
-const char HTML_PAGE_START[] PROGMEM = "<!DOCTYPE html>\n"
-  "<html>\n"
-  "<head>\n"
+// *_STR macros are for building page templates from literals at compile time
+#define HTML_PAGE_START_STR "<!DOCTYPE html>\n" \
+  "<html>\n" \
+  "<head>\n" \
+  "<meta charset=\"utf-8\"/>\n"
 //  "<meta http-equiv=\"Pragma\" content=\"no-cache\"/>\n"
 //  "<meta http-equiv=\"Cache-Control\" content=\"no-cache\"/>\n"
-  "<meta charset=\"utf-8\"/>\n";
-const char HTML_HEAD_END[] PROGMEM = "</head>\n";
-const char HTML_BODY_START[] PROGMEM = "<body>\n";
-const char HTML_PAGE_END[] PROGMEM = "</body>\n"
-  "</html>";
+#define HTML_HEAD_END_STR "</head>\n"
+#define HTML_BODY_START_STR "<body>\n"
+#define HTML_PAGE_END_STR "</body>\n" \
+  "</html>"
+#define HTML_TITLE_STR(title) "<title>" title "</title>\n"
+
+const char HTML_PAGE_START[] PROGMEM = HTML_PAGE_START_STR;
+const char HTML_HEAD_END[] PROGMEM = HTML_HEAD_END_STR;
+const char HTML_BODY_START[] PROGMEM = HTML_BODY_START_STR;
+const char HTML_PAGE_END[] PROGMEM = HTML_PAGE_END_STR;
+
+const uint8_t TEMPLATE_NAME_LENGTH = 15; // Longer placeholder names are truncated
+
+typedef void (*templatecb_t)(Print &out, const char *name, void *arg);
+
+// Copies PROGMEM template to output, calls back for each {{name}} placeholder
+void renderTemplate(Print &out, PGM_P tmpl, templatecb_t callback = NULL, void *arg = NULL);
+
+class HtmlWriter : public Print { // Writes markup straight to output without temporary strings
+public:
+  HtmlWriter(Print &out) : _out(out) {}
+
+  size_t write(uint8_t c) {
+    return _out.write(c);
+  }
+  size_t write(const uint8_t *buffer, size_t size) {
+    return _out.write(buffer, size);
+  }
+
+  void tagOpen(const char *tagName, const char *tagOptions, bool nl = false);
+  void tagOpen(const char *tagName, bool nl = false);
+  void tagClose(const char *tagName, bool nl = false);
+
+  void tag(const char *tagName, const char *tagOptions, const char *tagValue, bool nl = false);
+  void tag(const char *tagName, const char *tagValue, bool nl = false);
+  void tag(const char *tagName, bool nl = false);
+
+  void tagOpen_P(PGM_P tagName, const char *tagOptions, bool nl = false);
+  void tagOpen_P(PGM_P tagName, const __FlashStringHelper *tagOptions, bool nl = false);
+  void tagOpen_P(PGM_P tagName, bool nl = false);
+  void tagClose_P(PGM_P tagName, bool nl = false);
+
+  void tag_P(PGM_P tagName, const char *tagOptions, const char *tagValue, bool nl = false);
+  void tag_P(PGM_P tagName, const char *tagValue, bool nl = false);
+  void tag_P(PGM_P tagName, const __FlashStringHelper *tagValue, bool nl = false);
+  void tag_P(PGM_P tagName, bool nl = false);
+
+  void attr(const char *attrName, const char *attrValue); // ' name="value"' with value escaped
+  void attr_P(PGM_P attrName, const char *attrValue);
+
+  void escape(const char *str); // Text or attribute value
+  void escape_P(PGM_P str);
+
+protected:
+  void escape(char c);
+
+  Print &_out;
+};
 
 String tagOpen(const String &tagName, const String &tagOptions, bool nl = false);
 String tagOpen(const String &tagName, bool nl = false);
@@ -36,4 +95,20 @@ String tag_P(PGM_P tagName, const String &tagOptions, const String &tagValue, bo
 String tag_P(PGM_P tagName, const String &tagValue, bool nl = false);
 String tag_P(PGM_P tagName, bool nl = false);
 
+String escapeHtml(const char *str);
+
+class PageBuilder { // Text response in one buffer reused across requests instead of new String each time
+public:
+  static const uint16_t KEEP_CAPACITY = 2048; // Larger buffer is released after use
+
+  PageBuilder() : _capacity(0) {}
+
+  String &begin(size_t capacity); // Empty page with room for capacity chars, upper bound of page length
+  void end(); // Page is sent
+
+protected:
+  String _page;
+  size_t _capacity;
+};
+
 #endif
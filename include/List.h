@@ -44,8 +44,8 @@ class StaticList {
 public:
   static const uint8_t ERR_INDEX = 0xFF;
 
-  List() : _count(0) {}
-  ~List() {
+  StaticList() : _count(0) {}
+  ~StaticList() {
     clear();
   }
 
@@ -130,7 +130,7 @@ template <class T, uint8_t MAX_SIZE>
 uint8_t List<T, MAX_SIZE>::find(const T &t) {
   if (_items) {
     for (uint8_t i = 0; i < _count; ++i) {
-      if (match(i, t))
+      if (match(i, &t))
         return i;
     }
   }
@@ -181,7 +181,7 @@ void StaticList<T, MAX_SIZE>::remove(uint8_t index) {
 template <class T, uint8_t MAX_SIZE>
 uint8_t StaticList<T, MAX_SIZE>::find(const T &t) {
   for (uint8_t i = 0; i < _count; ++i) {
-    if (match(i, t))
+    if (match(i, &t))
       return i;
   }
 
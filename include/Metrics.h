@@ -0,0 +1,45 @@
+#ifndef __METRICS_H
+#define __METRICS_H
+
+#include <Arduino.h>
+#include "Customization.h"
+
+// Fixed-bucket latency histograms of hot paths and heap gauges, compiled out without USE_METRICS
+
+enum metric_t : uint8_t { MET_LOOP, MET_LED_UPDATE, MET_CONFIG_SAVE,
+  MET_HTTP_NOTFOUND, MET_HTTP_CSS, MET_HTTP_SCRIPT, MET_HTTP_ROOT, MET_HTTP_SETUP, MET_HTTP_GETCONFIG, MET_HTTP_SETCONFIG,
+  MET_HTTP_API_GETCONFIG, MET_HTTP_API_SETCONFIG, MET_HTTP_CLEARCONFIG, MET_HTTP_RESTART, MET_HTTP_SPIFFS, MET_HTTP_UPLOAD, MET_HTTP_DELETE, MET_HTTP_FWUPDATE, MET_HTTP_SKETCHUPDATE,
+  MET_HTTP_EXPORT, MET_HTTP_IMPORT, MET_HTTP_METRICS, MET_HTTP_HEAPTRACE, METRIC_COUNT };
+
+const uint8_t MET_HTTP_FIRST = MET_HTTP_NOTFOUND;
+
+#ifdef USE_METRICS
+const uint8_t METRIC_BUCKETS = 12; // Plus +Inf
+
+void metricObserve(uint8_t metric, uint32_t us);
+void metricsReset();
+
+// Append one metric, return false if HTTP route was never hit. JSON objects after first are comma prefixed
+bool metricToPrometheus(String &str, uint8_t metric);
+bool metricToJson(String &str, uint8_t metric);
+void heapToPrometheus(String &str);
+void heapToJson(String &str);
+
+class MetricScope {
+public:
+  MetricScope(uint8_t metric) : _start(micros()), _metric(metric) {}
+  ~MetricScope() {
+    metricObserve(_metric, micros() - _start);
+  }
+
+protected:
+  uint32_t _start;
+  uint8_t _metric;
+};
+
+#define METRIC_SCOPE(metric) MetricScope _metricScope(metric)
+#else
+#define METRIC_SCOPE(metric)
+#endif
+
+#endif
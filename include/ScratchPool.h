@@ -0,0 +1,57 @@
+#ifndef __SCRATCHPOOL_H
+#define __SCRATCHPOOL_H
+
+#include <stdlib.h>
+#include <inttypes.h>
+#include "Customization.h"
+
+// Large per request buffers. With USE_SCRATCH_POOL they are taken from few blocks reserved by scratchBegin() at boot,
+// scratchAcquire() returns NULL when all are checked out instead of fragmenting heap. Without it they are plain malloc().
+
+#ifdef USE_SCRATCH_POOL
+const uint8_t SCRATCH_COUNT = 1; // Web server handles one request at a time
+const uint16_t SCRATCH_SIZE = 2052; // Fits config body of BaseWebServer::MAX_BODY_SIZE and terminator
+
+bool scratchBegin(); // Call early in setup() while heap is not fragmented
+void *scratchAcquire(size_t size);
+void scratchRelease(void *buf);
+#else
+inline bool scratchBegin() {
+  return true;
+}
+inline void *scratchAcquire(size_t size) {
+  return malloc(size);
+}
+inline void scratchRelease(void *buf) {
+  free(buf);
+}
+#endif
+
+class ScratchBuffer { // Checked out buffer, returned to pool on release or destruction
+public:
+  ScratchBuffer() : _buf(NULL) {}
+  ~ScratchBuffer() {
+    release();
+  }
+
+  bool acquire(size_t size) {
+    release();
+    _buf = (uint8_t*)scratchAcquire(size);
+    return _buf != NULL;
+  }
+  void release() {
+    if (_buf) {
+      scratchRelease(_buf);
+      _buf = NULL;
+    }
+  }
+
+  uint8_t *data() const {
+    return _buf;
+  }
+
+protected:
+  uint8_t *_buf;
+};
+
+#endif
@@ -5,11 +5,40 @@
 #include <pgmspace.h>
 #include <WString.h>
 
+// Strings up to 30 chars share size classed slabs instead of own heap blocks, *str must be NULL or set by these functions
 bool allocStr(char **str, const char *src);
 bool allocStr_P(char **str, PGM_P src);
-inline bool allocStr(char **str, const __FlashStringHelper *src);
+inline bool allocStr(char **str, const __FlashStringHelper *src) {
+  return allocStr_P(str, (PGM_P)src);
+}
 void disposeStr(char **str);
 
+class StrArena { // Strings released all at once when arena goes out of scope
+public:
+  StrArena(bool intern = false) : _chunks(NULL), _intern(intern) {}
+  ~StrArena() {
+    clear();
+  }
+
+  const char *add(const char *str); // Copy of str or NULL, equal string added before when interning
+  const char *add_P(PGM_P str);
+  void clear();
+
+protected:
+  static const uint16_t CHUNK_SIZE = 256;
+
+  struct chunk_t { // Followed by size bytes of NUL terminated strings
+    chunk_t *next;
+    uint16_t used;
+    uint16_t size;
+  };
+
+  const char *add(const char *str, bool progmem);
+
+  chunk_t *_chunks;
+  bool _intern;
+};
+
 int8_t strcmp_PP(PGM_P s1, PGM_P s2);
 int8_t strncmp_PP(PGM_P s1, PGM_P s2, uint16_t maxlen);
 int8_t strcasecmp_PP(PGM_P s1, PGM_P s2);
@@ -17,4 +46,14 @@ int8_t strncasecmp_PP(PGM_P s1, PGM_P s2, uint16_t maxlen);
 
 char *byteToHex(char *out, uint8_t value);
 
+bool matchPattern_P(const char *str, PGM_P pattern); // Whole string, supports . [a-z] [^...] \d \w \s * + ?
+bool matchChoice_P(const char *str, PGM_P choices); // Choices separated by '|'
+
+inline size_t base64Length(size_t len) {
+  return (len + 2) / 3 * 4;
+}
+char *base64Encode(char *out, const uint8_t *data, size_t len); // out must hold base64Length(len) + 1 chars
+int8_t base64Value(char c);
+int32_t base64Decode(uint8_t *out, size_t size, const char *str); // Decoded length or -1
+
 #endif
@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <time.h>
+#include <new>
+#include "Arduino.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static const uint8_t PIN_COUNT = 17;
+
+static int64_t clockOffset = 0; // us added to monotonic clock by delay() and nativeSetMillis()
+static uint8_t pinLevel[PIN_COUNT];
+static int16_t pinAnalog[PIN_COUNT] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+static uint32_t rtcMemory[128];
+
+static int64_t monotonicNs() {
+  static int64_t start = 0;
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  int64_t now = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+  if (! start)
+    start = now;
+
+  return now - start;
+}
+
+static uint64_t uptimeUs() {
+  return monotonicNs() / 1000 + clockOffset;
+}
+
+unsigned long millis() {
+  return uptimeUs() / 1000;
+}
+
+unsigned long micros() {
+  return uptimeUs();
+}
+
+void delay(unsigned long ms) { // Time passes at once, tests do not wait
+  clockOffset += (int64_t)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+  clockOffset += us;
+}
+
+void yield() {}
+
+void nativeSetMillis(unsigned long ms) {
+  clockOffset += (int64_t)ms * 1000 - (int64_t)uptimeUs();
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < PIN_COUNT) {
+    pinLevel[pin] = value ? HIGH : LOW;
+    pinAnalog[pin] = -1;
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < PIN_COUNT ? pinLevel[pin] : LOW;
+}
+
+void analogWrite(uint8_t pin, int value) {
+  if (pin < PIN_COUNT) {
+    pinLevel[pin] = value ? HIGH : LOW;
+    pinAnalog[pin] = value;
+  }
+}
+
+int analogRead(uint8_t) {
+  return 0;
+}
+
+int nativeAnalogValue(uint8_t pin) {
+  return pin < PIN_COUNT ? pinAnalog[pin] : -1;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  long divisor = in_max - in_min;
+
+  if (! divisor)
+    return -1;
+
+  return (x - in_min) * (out_max - out_min) / divisor + out_min;
+}
+
+long random(long howbig) {
+  return howbig ? ::random() % howbig : 0;
+}
+
+long random(long howsmall, long howbig) {
+  return howsmall >= howbig ? howsmall : random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed)
+    srandom(seed);
+}
+
+void configTime(int, int, const char*, const char*, const char*) {}
+
+void HardwareSerial::begin(unsigned long, int, int) {}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush() {
+  fflush(stdout);
+}
+
+void EspClass::restart() {
+  ++_restarts;
+}
+
+void EspClass::deepSleep(uint64_t) {}
+
+uint32_t EspClass::getChipId() const {
+  return 0x00C0FFEE;
+}
+
+uint32_t EspClass::getFlashChipId() const {
+  return 0x001640EF;
+}
+
+uint32_t EspClass::getFlashChipSize() const {
+  return 4194304;
+}
+
+uint32_t EspClass::getFreeSketchSpace() const {
+  return 1044480;
+}
+
+uint32_t EspClass::getCycleCount() const {
+  return monotonicNs() * getCpuFreqMHz() / 1000;
+}
+
+uint32_t EspClass::getFreeHeap() const {
+  uint32_t result;
+
+  nativeHeapStats(&result, nullptr, nullptr);
+
+  return result;
+}
+
+uint32_t EspClass::getMaxFreeBlockSize() const {
+  uint32_t result;
+
+  nativeHeapStats(nullptr, &result, nullptr);
+
+  return result;
+}
+
+uint8_t EspClass::getHeapFragmentation() const {
+  uint8_t result;
+
+  nativeHeapStats(nullptr, nullptr, &result);
+
+  return result;
+}
+
+void EspClass::getHeapStats(uint32_t *free, uint32_t *max, uint8_t *frag) const {
+  nativeHeapStats(free, max, frag);
+}
+
+uint32_t EspClass::random() const {
+  return ((uint32_t)::random() << 16) ^ (uint32_t)::random();
+}
+
+uint8_t *EspClass::random(uint8_t *resultArray, const size_t outputSizeBytes) const {
+  for (size_t i = 0; i < outputSizeBytes; ++i) {
+    resultArray[i] = ::random();
+  }
+
+  return resultArray;
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size) {
+  if ((offset >= 128) || (offset * 4 + size > sizeof(rtcMemory)))
+    return false;
+  memcpy(data, &rtcMemory[offset], size);
+
+  return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size) {
+  if ((offset >= 128) || (offset * 4 + size > sizeof(rtcMemory)))
+    return false;
+  memcpy(&rtcMemory[offset], data, size);
+
+  return true;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _address[0], _address[1], _address[2], _address[3]);
+
+  return String(buf);
+}
+
+size_t IPAddress::printTo(Print &p) const {
+  return p.print(toString());
+}
+
+// As on ESP8266, new and delete go through malloc() and free(), so wrapped allocators count them too
+
+void *operator new(size_t size) {
+  void *result = malloc(size ? size : 1);
+
+  if (! result)
+    throw std::bad_alloc();
+
+  return result;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept {
+  return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return malloc(size ? size : 1);
+}
+
+void operator delete(void *ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+  free(ptr);
+}
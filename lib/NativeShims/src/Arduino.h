@@ -0,0 +1,131 @@
+#ifndef __ARDUINO_H
+#define __ARDUINO_H
+
+// Host stand-in for the ESP8266 Arduino core, enough to build and test the project on Linux (see env:native)
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "pgmspace.h"
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+
+#ifndef __packed
+#define __packed __attribute__((packed))
+#endif
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x00
+#define INPUT_PULLUP 0x02
+#define OUTPUT 0x01
+
+#define LED_BUILTIN 2
+
+#define SERIAL_8N1 0x1c
+#define SERIAL_FULL 0
+#define SERIAL_TX_ONLY 2
+
+using std::min;
+using std::max;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+int analogRead(uint8_t pin);
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+void configTime(int timezone, int daylightOffset_sec, const char *server1, const char *server2 = nullptr, const char *server3 = nullptr);
+
+class HardwareSerial : public Stream { // Output goes to stdout
+public:
+  void begin(unsigned long baud, int config = SERIAL_8N1, int mode = SERIAL_FULL);
+  void end() {}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  int available() override {
+    return 0;
+  }
+  int read() override {
+    return -1;
+  }
+  int peek() override {
+    return -1;
+  }
+  void flush() override;
+  void setDebugOutput(bool) {}
+};
+
+extern HardwareSerial Serial;
+
+#ifndef NATIVE_HEAP_SIZE
+#define NATIVE_HEAP_SIZE 1048576 // Pool of malloc() replacement in Heap.cpp
+#endif
+
+class EspClass {
+public:
+  void restart();
+  void reset() {
+    restart();
+  }
+  void deepSleep(uint64_t time_us);
+
+  uint32_t getChipId() const;
+  uint32_t getFlashChipId() const;
+  uint32_t getFlashChipSize() const;
+  uint32_t getFreeSketchSpace() const;
+  uint8_t getCpuFreqMHz() const {
+    return 80;
+  }
+  uint32_t getCycleCount() const; // Derived from monotonic clock at getCpuFreqMHz()
+
+  uint32_t getFreeHeap() const;
+  uint32_t getMaxFreeBlockSize() const;
+  uint8_t getHeapFragmentation() const;
+  void getHeapStats(uint32_t *free = nullptr, uint32_t *max = nullptr, uint8_t *frag = nullptr) const;
+
+  uint32_t random() const;
+  uint8_t *random(uint8_t *resultArray, const size_t outputSizeBytes) const;
+
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size); // 512 bytes kept until process exit
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size);
+
+  uint32_t restarts() const { // Host only, restart() calls so far
+    return _restarts;
+  }
+
+protected:
+  uint32_t _restarts = 0;
+};
+
+extern EspClass ESP;
+
+// Host only test hooks
+
+void nativeSetMillis(unsigned long ms); // Clock jumps to ms, millis() keeps counting from there
+int nativeAnalogValue(uint8_t pin); // Last analogWrite() value, -1 after digitalWrite()
+void nativeHeapStats(uint32_t *free, uint32_t *max, uint8_t *frag); // Walks pool of Heap.cpp
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef __DNSSERVER_H
+#define __DNSSERVER_H
+
+#include "Arduino.h"
+
+enum class DNSReplyCode { NoError = 0, FormError = 1, ServerFailure = 2, NonExistentDomain = 3 };
+
+class DNSServer { // Answers nothing, captive portal redirects are tested through Host header
+public:
+  void setErrorReplyCode(const DNSReplyCode &replyCode) {}
+  bool start(const uint16_t &port, const String &domainName, const IPAddress &resolvedIP) {
+    return resolvedIP.isSet();
+  }
+  void processNextRequest() {}
+  void stop() {}
+};
+
+#endif
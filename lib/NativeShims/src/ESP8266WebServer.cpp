@@ -0,0 +1,329 @@
+#include <ctype.h>
+#include "ESP8266WebServer.h"
+
+UpdaterClass Update;
+
+void ESP8266WebServer::on(const Uri &uri, HTTPMethod method, THandlerFunction fn) {
+  on(uri, method, fn, NULL);
+}
+
+void ESP8266WebServer::on(const Uri &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) {
+  handler_t handler;
+
+  handler.uri = uri.uri();
+  handler.method = method;
+  handler.fn = fn;
+  handler.ufn = ufn;
+  _handlers.push_back(handler);
+}
+
+const String *ESP8266WebServer::find(const std::vector<pair_t> &list, const String &name) {
+  for (const pair_t &item : list) {
+    if (item.first.equalsIgnoreCase(name))
+      return &item.second;
+  }
+
+  return NULL;
+}
+
+const String &ESP8266WebServer::arg(const String &name) const {
+  for (const pair_t &item : _args) {
+    if (item.first == name)
+      return item.second;
+  }
+
+  return emptyString;
+}
+
+const String &ESP8266WebServer::arg(int i) const {
+  return (i >= 0) && (i < args()) ? _args[i].second : emptyString;
+}
+
+const String &ESP8266WebServer::argName(int i) const {
+  return (i >= 0) && (i < args()) ? _args[i].first : emptyString;
+}
+
+bool ESP8266WebServer::hasArg(const String &name) const {
+  for (const pair_t &item : _args) {
+    if (item.first == name)
+      return true;
+  }
+
+  return false;
+}
+
+const String &ESP8266WebServer::header(const String &name) const {
+  const String *value = find(_headers, name);
+
+  return value ? *value : emptyString;
+}
+
+bool ESP8266WebServer::hasHeader(const String &name) const {
+  return find(_headers, name) != NULL;
+}
+
+static String base64(const String &str) {
+  static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  String result;
+
+  for (unsigned int i = 0; i < str.length(); i += 3) {
+    uint32_t triple = (uint8_t)str[i] << 16;
+
+    if (i + 1 < str.length())
+      triple |= (uint8_t)str[i + 1] << 8;
+    if (i + 2 < str.length())
+      triple |= (uint8_t)str[i + 2];
+    result += ALPHABET[(triple >> 18) & 0x3F];
+    result += ALPHABET[(triple >> 12) & 0x3F];
+    result += i + 1 < str.length() ? ALPHABET[(triple >> 6) & 0x3F] : '=';
+    result += i + 2 < str.length() ? ALPHABET[triple & 0x3F] : '=';
+  }
+
+  return result;
+}
+
+bool ESP8266WebServer::authenticate(const char *username, const char *password) {
+  String expected = F("Basic ");
+
+  expected += base64(String(username) + ':' + password);
+
+  return header(F("Authorization")) == expected;
+}
+
+void ESP8266WebServer::requestAuthentication() {
+  sendHeader(F("WWW-Authenticate"), F("Basic realm=\"Login Required\""));
+  send(401);
+}
+
+void ESP8266WebServer::send(int code, const char *content_type, const String &content) {
+  _code = code;
+  _type = content_type ? content_type : "text/html";
+  _chunked = _contentLength == CONTENT_LENGTH_UNKNOWN;
+  _sent = content.length();
+  if (_keepResponse)
+    _response = content;
+}
+
+void ESP8266WebServer::sendHeader(const String &name, const String &value, bool first) {
+  if (first)
+    _responseHeaders.insert(_responseHeaders.begin(), pair_t(name, value));
+  else
+    _responseHeaders.push_back(pair_t(name, value));
+}
+
+void ESP8266WebServer::sendContent(const char *content, size_t size) {
+  if (_chunked && (! size)) // Last chunk
+    _chunked = false;
+  else {
+    _sent += size;
+    if (_keepResponse)
+      _response.concat(content, size);
+  }
+}
+
+const String &ESP8266WebServer::responseHeader(const String &name) const {
+  const String *value = find(_responseHeaders, name);
+
+  return value ? *value : emptyString;
+}
+
+void ESP8266WebServer::setRequestHeader(const String &name, const String &value) {
+  _nextHeaders.push_back(pair_t(name, value));
+}
+
+String ESP8266WebServer::urlDecode(const char *data, size_t length) {
+  String result;
+
+  for (size_t i = 0; i < length; ++i) {
+    if ((data[i] == '%') && (i + 2 < length) && isxdigit(data[i + 1]) && isxdigit(data[i + 2])) {
+      char hex[3] = { data[i + 1], data[i + 2], '\0' };
+
+      result += (char)strtol(hex, NULL, 16);
+      i += 2;
+    } else if (data[i] == '+')
+      result += ' ';
+    else
+      result += data[i];
+  }
+
+  return result;
+}
+
+void ESP8266WebServer::parseArgs(std::vector<pair_t> &list, const char *data, size_t length) {
+  size_t start = 0;
+
+  while (start < length) {
+    const char *amp = (const char*)memchr(data + start, '&', length - start);
+    size_t end = amp ? amp - data : length;
+    const char *eq = (const char*)memchr(data + start, '=', end - start);
+
+    if (end > start) {
+      if (eq)
+        list.push_back(pair_t(urlDecode(data + start, eq - data - start), urlDecode(eq + 1, data + end - eq - 1)));
+      else
+        list.push_back(pair_t(urlDecode(data + start, end - start), String()));
+    }
+    start = end + 1;
+  }
+}
+
+void ESP8266WebServer::parseMultipart(const handler_t *handler, const String &boundary) {
+  String delimiter = String(F("--")) + boundary;
+  const char *data = (const char*)_body.data();
+  size_t length = _body.size();
+  size_t pos = 0;
+
+  auto search = [&](const char *what, size_t len, size_t from) -> size_t {
+    for (size_t i = from; i + len <= length; ++i) {
+      if (! memcmp(data + i, what, len))
+        return i;
+    }
+    return length;
+  };
+
+  pos = search(delimiter.c_str(), delimiter.length(), 0);
+  while (pos < length) {
+    pos += delimiter.length();
+    if ((pos + 2 <= length) && (! memcmp(data + pos, "--", 2))) // Closing delimiter
+      break;
+    pos += 2; // CRLF
+
+    size_t headersEnd = search("\r\n\r\n", 4, pos);
+
+    if (headersEnd >= length)
+      break;
+
+    String headers(data + pos, headersEnd - pos);
+    String name, filename, type;
+    int i;
+
+    if ((i = headers.indexOf(F("name=\""))) >= 0)
+      name = headers.substring(i + 6, headers.indexOf('"', i + 6));
+    if ((i = headers.indexOf(F("filename=\""))) >= 0)
+      filename = headers.substring(i + 10, headers.indexOf('"', i + 10));
+    if ((i = headers.indexOf(F("Content-Type: "))) >= 0)
+      type = headers.substring(i + 14, headers.indexOf('\r', i + 14) >= 0 ? headers.indexOf('\r', i + 14) : headers.length());
+
+    size_t start = headersEnd + 4;
+    String next = String(F("\r\n")) + delimiter;
+    size_t end = search(next.c_str(), next.length(), start);
+
+    if (filename.length()) {
+      if (handler && handler->ufn) {
+        _upload.status = UPLOAD_FILE_START;
+        _upload.name = name;
+        _upload.filename = filename;
+        _upload.type = type;
+        _upload.totalSize = 0;
+        _upload.currentSize = 0;
+        _upload.contentLength = length;
+        handler->ufn();
+        for (size_t chunk = start; chunk < end; chunk += HTTP_UPLOAD_BUFLEN) {
+          _upload.status = UPLOAD_FILE_WRITE;
+          _upload.currentSize = end - chunk < HTTP_UPLOAD_BUFLEN ? end - chunk : HTTP_UPLOAD_BUFLEN;
+          memcpy(_upload.buf, data + chunk, _upload.currentSize);
+          _upload.totalSize += _upload.currentSize;
+          handler->ufn();
+        }
+        _upload.status = UPLOAD_FILE_END;
+        _upload.currentSize = 0;
+        handler->ufn();
+      }
+    } else
+      _args.push_back(pair_t(name, String(data + start, end - start)));
+    pos = end + 2;
+  }
+}
+
+int ESP8266WebServer::request(HTTPMethod method, const String &uri, const String &contentType, const String &body) {
+  return request(method, uri, contentType, (const uint8_t*)body.c_str(), body.length());
+}
+
+int ESP8266WebServer::request(HTTPMethod method, const String &uri, const String &contentType, const uint8_t *body, size_t length) {
+  int query = uri.indexOf('?');
+
+  _method = method;
+  _uri = query < 0 ? uri : uri.substring(0, query);
+  _args.clear();
+  if (query >= 0)
+    parseArgs(_args, uri.c_str() + query + 1, uri.length() - query - 1);
+  _headers = _nextHeaders;
+  _nextHeaders.clear();
+  if (! find(_headers, F("Host")))
+    _headers.push_back(pair_t(F("Host"), F("192.168.4.1")));
+  if (contentType.length())
+    _headers.push_back(pair_t(F("Content-Type"), contentType));
+  _body.assign(body, body + length);
+
+  _contentLength = CONTENT_LENGTH_NOT_SET;
+  _chunked = false;
+  _code = 0;
+  _type = String();
+  _response = String();
+  _sent = 0;
+  _responseHeaders.clear();
+
+  const handler_t *handler = NULL;
+
+  for (const handler_t &h : _handlers) {
+    if (((h.method == HTTP_ANY) || (h.method == method)) && (h.uri == _uri)) {
+      handler = &h;
+      break;
+    }
+  }
+
+  if (contentType.startsWith(F("multipart/form-data"))) {
+    int boundary = contentType.indexOf(F("boundary="));
+
+    if (boundary >= 0)
+      parseMultipart(handler, contentType.substring(boundary + 9));
+  } else if (length) {
+    if (handler && handler->ufn) {
+      _raw.status = RAW_START;
+      _raw.totalSize = 0;
+      _raw.currentSize = 0;
+      _raw.data = NULL;
+      handler->ufn();
+      for (size_t chunk = 0; chunk < length; chunk += HTTP_RAW_BUFLEN) {
+        _raw.status = RAW_WRITE;
+        _raw.currentSize = length - chunk < HTTP_RAW_BUFLEN ? length - chunk : HTTP_RAW_BUFLEN;
+        memcpy(_raw.buf, body + chunk, _raw.currentSize);
+        _raw.totalSize += _raw.currentSize;
+        handler->ufn();
+      }
+      _raw.status = RAW_END;
+      _raw.currentSize = 0;
+      handler->ufn();
+    } else if (contentType.startsWith(F("application/x-www-form-urlencoded")))
+      parseArgs(_args, (const char*)body, length);
+    else
+      _args.push_back(pair_t(F("plain"), String((const char*)body, length)));
+  }
+
+  if (handler)
+    handler->fn();
+  else if (_notFound)
+    _notFound();
+  else
+    send(404, "text/plain", String(F("Not found: ")) + _uri);
+
+  return _code;
+}
+
+int ESP8266WebServer::uploadFile(const String &uri, const String &filename, const uint8_t *data, size_t length) {
+  static const char BOUNDARY[] = "NativeShimsBoundary";
+  String body;
+
+  body.reserve(length + 200);
+  body += F("--");
+  body += BOUNDARY;
+  body += F("\r\nContent-Disposition: form-data; name=\"upload\"; filename=\"");
+  body += filename;
+  body += F("\"\r\nContent-Type: application/octet-stream\r\n\r\n");
+  body.concat((const char*)data, length);
+  body += F("\r\n--");
+  body += BOUNDARY;
+  body += F("--\r\n");
+
+  return request(HTTP_POST, uri, String(F("multipart/form-data; boundary=")) + BOUNDARY, body);
+}
@@ -0,0 +1,236 @@
+#ifndef __ESP8266WEBSERVER_H
+#define __ESP8266WEBSERVER_H
+
+#include <functional>
+#include <vector>
+#include "Arduino.h"
+#include "FS.h"
+#include "Updater.h"
+
+// No sockets, request() runs one request through the handlers the way ESP8266 core 3.x parses it:
+// multipart bodies go to the upload callback, other bodies to the raw callback when the route has one,
+// otherwise url-encoded bodies become args and anything else the "plain" arg
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+enum HTTPRawStatus { RAW_START, RAW_WRITE, RAW_END, RAW_ABORTED };
+
+#define HTTP_UPLOAD_BUFLEN 2048
+#define HTTP_RAW_BUFLEN 1460
+#define CONTENT_LENGTH_UNKNOWN ((size_t) -1)
+#define CONTENT_LENGTH_NOT_SET ((size_t) -2)
+
+struct HTTPUpload {
+  HTTPUploadStatus status;
+  String filename;
+  String name;
+  String type;
+  size_t totalSize;
+  size_t currentSize;
+  size_t contentLength;
+  uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+struct HTTPRaw {
+  HTTPRawStatus status;
+  size_t totalSize;
+  size_t currentSize;
+  void *data;
+  uint8_t buf[HTTP_RAW_BUFLEN];
+};
+
+class Uri {
+public:
+  Uri(const char *uri) : _uri(uri) {}
+  Uri(const String &uri) : _uri(uri) {}
+  Uri(const __FlashStringHelper *uri) : _uri(uri) {}
+
+  const String &uri() const {
+    return _uri;
+  }
+
+protected:
+  String _uri;
+};
+
+class WiFiClient : public Stream {
+public:
+  size_t write(uint8_t) override {
+    return 1;
+  }
+  int available() override {
+    return 0;
+  }
+  int read() override {
+    return -1;
+  }
+  int peek() override {
+    return -1;
+  }
+  bool connected() {
+    return false;
+  }
+};
+
+class ESP8266WebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  ESP8266WebServer(int port = 80) : _port(port), _method(HTTP_ANY), _contentLength(CONTENT_LENGTH_NOT_SET), _chunked(false), _code(0), _sent(0), _keepResponse(true) {}
+
+  void begin() {}
+  void close() {}
+  void stop() {}
+  void handleClient() {}
+
+  void on(const Uri &uri, HTTPMethod method, THandlerFunction fn);
+  void on(const Uri &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
+  void onNotFound(THandlerFunction fn) {
+    _notFound = fn;
+  }
+
+  const String &uri() const {
+    return _uri;
+  }
+  HTTPMethod method() const {
+    return _method;
+  }
+  WiFiClient &client() {
+    return _client;
+  }
+  HTTPUpload &upload() {
+    return _upload;
+  }
+  HTTPRaw &raw() {
+    return _raw;
+  }
+
+  const String &arg(const String &name) const;
+  const String &arg(int i) const;
+  const String &argName(int i) const;
+  int args() const {
+    return _args.size();
+  }
+  bool hasArg(const String &name) const;
+
+  void collectHeaders(const char *headerKeys[], const size_t headerKeysCount) {}
+  const String &header(const String &name) const;
+  bool hasHeader(const String &name) const;
+  const String &hostHeader() const {
+    return header(F("Host"));
+  }
+  size_t clientContentLength() const {
+    return _body.size();
+  }
+
+  bool authenticate(const char *username, const char *password);
+  void requestAuthentication();
+
+  void send(int code, const char *content_type = NULL, const String &content = emptyString);
+  void send(int code, const String &content_type, const String &content) {
+    send(code, content_type.c_str(), content);
+  }
+  void send(int code, const __FlashStringHelper *content_type, const String &content) {
+    send(code, reinterpret_cast<const char*>(content_type), content);
+  }
+  void send(int code, const char *content_type, const char *content, size_t contentLength) {
+    send(code, content_type, String(content ? content : "", contentLength));
+  }
+  void send_P(int code, PGM_P content_type, PGM_P content) {
+    send(code, content_type, String(content));
+  }
+  void send_P(int code, PGM_P content_type, PGM_P content, size_t contentLength) {
+    send(code, content_type, content, contentLength);
+  }
+
+  void setContentLength(const size_t contentLength) {
+    _contentLength = contentLength;
+  }
+  void sendHeader(const String &name, const String &value, bool first = false);
+  void sendContent(const String &content) {
+    sendContent(content.c_str(), content.length());
+  }
+  void sendContent(const char *content, size_t size);
+  void sendContent_P(PGM_P content) {
+    sendContent(content, strlen_P(content));
+  }
+  void sendContent_P(PGM_P content, size_t size) {
+    sendContent(content, size);
+  }
+
+  template<typename T> size_t streamFile(T &file, const String &contentType) {
+    String content;
+
+    content.reserve(file.size());
+    while (file.available()) {
+      content += (char)file.read();
+    }
+    send(200, contentType, content);
+
+    return content.length();
+  }
+
+  // Host only
+
+  void setRequestHeader(const String &name, const String &value); // Sent with next request()
+  int request(HTTPMethod method, const String &uri, const String &contentType = emptyString, const String &body = emptyString); // Response code, 0 if none sent
+  int request(HTTPMethod method, const String &uri, const String &contentType, const uint8_t *body, size_t length);
+  int uploadFile(const String &uri, const String &filename, const uint8_t *data, size_t length); // As multipart/form-data from a file input
+  void keepResponse(bool keep) { // Off drops body as a socket would, so it does not count as heap of handler
+    _keepResponse = keep;
+  }
+
+  int responseCode() const {
+    return _code;
+  }
+  const String &responseType() const {
+    return _type;
+  }
+  const String &responseBody() const {
+    return _response;
+  }
+  size_t responseLength() const { // Also when body is not kept
+    return _sent;
+  }
+  const String &responseHeader(const String &name) const;
+
+protected:
+  struct handler_t {
+    String uri;
+    HTTPMethod method;
+    THandlerFunction fn;
+    THandlerFunction ufn;
+  };
+
+  typedef std::pair<String, String> pair_t;
+
+  static const String *find(const std::vector<pair_t> &list, const String &name);
+  static void parseArgs(std::vector<pair_t> &list, const char *data, size_t length);
+  static String urlDecode(const char *data, size_t length);
+  void parseMultipart(const handler_t *handler, const String &boundary);
+
+  int _port;
+  std::vector<handler_t> _handlers;
+  THandlerFunction _notFound;
+  WiFiClient _client;
+  HTTPUpload _upload;
+  HTTPRaw _raw;
+
+  HTTPMethod _method;
+  String _uri;
+  std::vector<pair_t> _args;
+  std::vector<pair_t> _headers;
+  std::vector<pair_t> _nextHeaders;
+  std::vector<uint8_t> _body;
+
+  size_t _contentLength;
+  bool _chunked;
+  int _code;
+  String _type;
+  String _response;
+  size_t _sent;
+  bool _keepResponse;
+  std::vector<pair_t> _responseHeaders;
+};
+
+#endif
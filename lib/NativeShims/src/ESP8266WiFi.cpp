@@ -0,0 +1,93 @@
+#include "ESP8266WiFi.h"
+
+ESP8266WiFiClass WiFi;
+
+bool ESP8266WiFiClass::enableSTA(bool enable) {
+  if (enable)
+    _mode = (WiFiMode_t)(_mode | WIFI_STA);
+  else
+    _mode = (WiFiMode_t)(_mode & ~WIFI_STA);
+
+  return true;
+}
+
+bool ESP8266WiFiClass::enableAP(bool enable) {
+  if (enable)
+    _mode = (WiFiMode_t)(_mode | WIFI_AP);
+  else
+    _mode = (WiFiMode_t)(_mode & ~WIFI_AP);
+
+  return true;
+}
+
+wl_status_t ESP8266WiFiClass::begin(const char*, const char*, int32_t, const uint8_t*, bool) {
+  enableSTA(true);
+
+  return WL_DISCONNECTED;
+}
+
+bool ESP8266WiFiClass::disconnect(bool wifioff) {
+  if (wifioff)
+    enableSTA(false);
+
+  return true;
+}
+
+bool ESP8266WiFiClass::softAP(const char *ssid, const char*, int channel, int, int) {
+  if ((! ssid) || (! *ssid) || (channel < 1) || (channel > 14))
+    return false;
+  enableAP(true);
+  _apUp = true;
+  _apChannel = channel;
+  ++_apStarts;
+
+  return true;
+}
+
+bool ESP8266WiFiClass::softAPdisconnect(bool wifioff) {
+  _apUp = false;
+  _stations = 0;
+  if (wifioff)
+    enableAP(false);
+
+  return true;
+}
+
+int8_t ESP8266WiFiClass::scanNetworks(bool async, bool, uint8_t, uint8_t*) {
+  if (! (_mode & WIFI_STA))
+    return WIFI_SCAN_FAILED;
+  ++_scans;
+  _scan = _nextScan;
+  if (async && _scanPolls) {
+    _scanState = WIFI_SCAN_RUNNING;
+    return WIFI_SCAN_RUNNING;
+  }
+  _scanState = _scan.size();
+
+  return _scanState;
+}
+
+int8_t ESP8266WiFiClass::scanComplete() {
+  if ((_scanState == WIFI_SCAN_RUNNING) && (! --_scanPolls))
+    _scanState = _scan.size();
+
+  return _scanState;
+}
+
+void ESP8266WiFiClass::scanDelete() {
+  _scan.clear();
+  _scanState = WIFI_SCAN_FAILED;
+}
+
+uint8_t ESP8266WiFiClass::channel(uint8_t networkItem) const {
+  return networkItem < _scan.size() ? _scan[networkItem].first : 0;
+}
+
+int32_t ESP8266WiFiClass::RSSI(uint8_t networkItem) const {
+  return networkItem < _scan.size() ? _scan[networkItem].second : 0;
+}
+
+void ESP8266WiFiClass::nativeScanResults(const std::vector<std::pair<uint8_t, int8_t>> &nets, uint8_t polls) {
+  _nextScan = nets;
+  _scanPolls = polls;
+}
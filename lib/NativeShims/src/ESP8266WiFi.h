@@ -0,0 +1,89 @@
+#ifndef __ESP8266WIFI_H
+#define __ESP8266WIFI_H
+
+#include <functional>
+#include <vector>
+#include "Arduino.h"
+
+// No radio, the soft AP always starts and scans return networks set by nativeScanResults()
+
+enum WiFiMode_t { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 };
+enum wl_status_t { WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL = 1, WL_CONNECTED = 3, WL_CONNECT_FAILED = 4, WL_DISCONNECTED = 6 };
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+class ESP8266WiFiClass {
+public:
+  bool mode(WiFiMode_t mode) {
+    _mode = mode;
+    return true;
+  }
+  WiFiMode_t getMode() const {
+    return _mode;
+  }
+  bool enableSTA(bool enable);
+  bool enableAP(bool enable);
+
+  wl_status_t begin(const char *ssid, const char *passphrase = NULL, int32_t channel = 0, const uint8_t *bssid = NULL, bool connect = true);
+  bool disconnect(bool wifioff = false);
+  bool isConnected() const {
+    return false;
+  }
+  wl_status_t status() const {
+    return WL_DISCONNECTED;
+  }
+  IPAddress localIP() const {
+    return IPAddress();
+  }
+
+  bool softAP(const char *ssid, const char *passphrase = NULL, int channel = 1, int ssid_hidden = 0, int max_connection = 4);
+  bool softAPdisconnect(bool wifioff = false);
+  IPAddress softAPIP() const {
+    return _apUp ? IPAddress(192, 168, 4, 1) : IPAddress();
+  }
+  uint8_t softAPgetStationNum() const {
+    return _stations;
+  }
+
+  int8_t scanNetworks(bool async = false, bool show_hidden = false, uint8_t channel = 0, uint8_t *ssid = NULL);
+  int8_t scanComplete();
+  void scanDelete();
+  uint8_t channel(uint8_t networkItem) const;
+  int32_t RSSI(uint8_t networkItem) const;
+  int32_t channel() const {
+    return _apChannel;
+  }
+
+  // Host only
+
+  void nativeScanResults(const std::vector<std::pair<uint8_t, int8_t>> &nets, uint8_t polls = 1); // Channel and RSSI of next scan, async scan completes after polls
+  void nativeSetStations(uint8_t count) {
+    _stations = count;
+  }
+  uint8_t nativeApChannel() const { // 0 while AP is down
+    return _apUp ? _apChannel : 0;
+  }
+  uint16_t nativeApStarts() const {
+    return _apStarts;
+  }
+  uint16_t nativeScans() const {
+    return _scans;
+  }
+
+protected:
+  WiFiMode_t _mode = WIFI_OFF;
+  bool _apUp = false;
+  uint8_t _apChannel = 0;
+  uint8_t _stations = 0;
+  uint16_t _apStarts = 0;
+  uint16_t _scans = 0;
+  std::vector<std::pair<uint8_t, int8_t>> _nextScan;
+  std::vector<std::pair<uint8_t, int8_t>> _scan;
+  uint8_t _scanPolls = 1;
+  int8_t _scanState = WIFI_SCAN_FAILED;
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif
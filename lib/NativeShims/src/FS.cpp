@@ -0,0 +1,180 @@
+#include "FS.h"
+
+FS SPIFFS;
+
+std::vector<uint8_t> *File::data() const {
+  if (! _fs)
+    return NULL;
+
+  auto it = _fs->_files.find(_name);
+
+  return it == _fs->_files.end() ? NULL : &it->second;
+}
+
+size_t File::write(const uint8_t *buffer, size_t size) {
+  std::vector<uint8_t> *content = data();
+
+  if ((! content) || (! _write))
+    return 0;
+
+  size_t used = _fs->usedBytes();
+  size_t limit = content->size() + (used < _fs->_capacity ? _fs->_capacity - used : 0); // Partition full, write what fits
+
+  if (_pos + size > limit)
+    size = _pos < limit ? limit - _pos : 0;
+  if (_pos + size > content->size())
+    content->resize(_pos + size);
+  memcpy(content->data() + _pos, buffer, size);
+  _pos += size;
+
+  return size;
+}
+
+int File::available() {
+  std::vector<uint8_t> *content = data();
+
+  return content && (_pos < content->size()) ? content->size() - _pos : 0;
+}
+
+int File::read() {
+  std::vector<uint8_t> *content = data();
+
+  if ((! content) || (_pos >= content->size()))
+    return -1;
+
+  return (*content)[_pos++];
+}
+
+int File::peek() {
+  std::vector<uint8_t> *content = data();
+
+  if ((! content) || (_pos >= content->size()))
+    return -1;
+
+  return (*content)[_pos];
+}
+
+size_t File::read(uint8_t *buffer, size_t size) {
+  size_t avail = available();
+
+  if (size > avail)
+    size = avail;
+  if (size) {
+    memcpy(buffer, data()->data() + _pos, size);
+    _pos += size;
+  }
+
+  return size;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  std::vector<uint8_t> *content = data();
+
+  if (! content)
+    return false;
+
+  int64_t target = pos;
+
+  if (mode == SeekCur)
+    target += _pos;
+  else if (mode == SeekEnd)
+    target = content->size() - pos;
+  if ((target < 0) || (target > (int64_t)content->size()))
+    return false;
+  _pos = target;
+
+  return true;
+}
+
+size_t File::size() const {
+  std::vector<uint8_t> *content = data();
+
+  return content ? content->size() : 0;
+}
+
+bool Dir::next() {
+  auto it = _started ? _fs->_files.upper_bound(_current) : _fs->_files.lower_bound(_prefix);
+
+  _started = true;
+  if ((it == _fs->_files.end()) || it->first.compare(0, _prefix.size(), _prefix)) {
+    _current.clear();
+    return false;
+  }
+  _current = it->first;
+
+  return true;
+}
+
+size_t Dir::fileSize() const {
+  auto it = _fs->_files.find(_current);
+
+  return it == _fs->_files.end() ? 0 : it->second.size();
+}
+
+File Dir::openFile(const char *mode) {
+  return _fs->open(_current.c_str(), mode);
+}
+
+bool FS::info(FSInfo &info) {
+  info.totalBytes = _capacity;
+  info.usedBytes = usedBytes();
+  info.blockSize = 8192;
+  info.pageSize = 256;
+  info.maxOpenFiles = 5;
+  info.maxPathLength = 32;
+
+  return true;
+}
+
+File FS::open(const char *path, const char *mode) {
+  File result;
+
+  if ((! path) || (*path != '/') || (! mode))
+    return result;
+
+  bool exists = _files.count(path) > 0;
+
+  if ((mode[0] == 'r') && (! exists))
+    return result;
+  if ((mode[0] == 'w') || (! exists))
+    _files[path].clear();
+  result._fs = this;
+  result._name = path;
+  result._write = (mode[0] != 'r') || (mode[1] == '+');
+  if (mode[0] == 'a')
+    result._pos = _files[path].size();
+
+  return result;
+}
+
+Dir FS::openDir(const char *path) {
+  Dir result;
+
+  result._fs = this;
+  result._prefix = path;
+
+  return result;
+}
+
+bool FS::rename(const char *pathFrom, const char *pathTo) {
+  auto it = _files.find(pathFrom);
+
+  if ((it == _files.end()) || _files.count(pathTo) || (! _renames))
+    return false;
+  if (_renames > 0)
+    --_renames;
+  _files[pathTo] = std::move(it->second);
+  _files.erase(pathFrom);
+
+  return true;
+}
+
+size_t FS::usedBytes() const {
+  size_t result = 0;
+
+  for (const auto &file : _files) {
+    result += file.second.size();
+  }
+
+  return result;
+}
@@ -0,0 +1,168 @@
+#ifndef __FS_H
+#define __FS_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+// Flat RAM-backed file system with the ESP8266 SPIFFS interface, contents live until format() or process exit
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct FSInfo {
+  size_t totalBytes;
+  size_t usedBytes;
+  size_t blockSize;
+  size_t pageSize;
+  size_t maxOpenFiles;
+  size_t maxPathLength;
+};
+
+class FS;
+
+class File : public Stream {
+public:
+  File() : _fs(NULL), _pos(0), _write(false) {}
+
+  operator bool() const {
+    return _fs != NULL;
+  }
+
+  size_t write(uint8_t c) override {
+    return write(&c, 1);
+  }
+  size_t write(const uint8_t *buffer, size_t size) override;
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() override {}
+
+  size_t read(uint8_t *buffer, size_t size);
+  bool seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const {
+    return _pos;
+  }
+  size_t size() const;
+  void close() {
+    _fs = NULL;
+  }
+  const char *name() const {
+    return _name.c_str();
+  }
+  const char *fullName() const {
+    return _name.c_str();
+  }
+  bool isFile() const {
+    return _fs != NULL;
+  }
+  bool isDirectory() const {
+    return false;
+  }
+
+protected:
+  std::vector<uint8_t> *data() const;
+
+  FS *_fs;
+  std::string _name;
+  size_t _pos;
+  bool _write;
+
+  friend class FS;
+};
+
+class Dir {
+public:
+  Dir() : _fs(NULL), _started(false) {}
+
+  bool next();
+  String fileName() const {
+    return String(_current.c_str());
+  }
+  size_t fileSize() const;
+  File openFile(const char *mode);
+  bool isFile() const {
+    return _started && (! _current.empty());
+  }
+  bool isDirectory() const {
+    return false;
+  }
+  bool rewind() {
+    _started = false;
+    return true;
+  }
+
+protected:
+  FS *_fs;
+  std::string _prefix;
+  std::string _current;
+  bool _started;
+
+  friend class FS;
+};
+
+class FS {
+public:
+  bool begin() {
+    return true;
+  }
+  void end() {}
+  bool format() {
+    _files.clear();
+    return true;
+  }
+  bool info(FSInfo &info);
+
+  File open(const char *path, const char *mode);
+  File open(const String &path, const char *mode) {
+    return open(path.c_str(), mode);
+  }
+  File open(const __FlashStringHelper *path, const char *mode) {
+    return open(reinterpret_cast<const char*>(path), mode);
+  }
+  bool exists(const char *path) const {
+    return _files.count(path) > 0;
+  }
+  bool exists(const String &path) const {
+    return exists(path.c_str());
+  }
+  Dir openDir(const char *path);
+  Dir openDir(const String &path) {
+    return openDir(path.c_str());
+  }
+  Dir openDir(const __FlashStringHelper *path) {
+    return openDir(reinterpret_cast<const char*>(path));
+  }
+  bool remove(const char *path) {
+    return _files.erase(path) > 0;
+  }
+  bool remove(const String &path) {
+    return remove(path.c_str());
+  }
+  bool rename(const char *pathFrom, const char *pathTo);
+  bool rename(const String &pathFrom, const String &pathTo) {
+    return rename(pathFrom.c_str(), pathTo.c_str());
+  }
+
+  // Host only
+
+  void setCapacity(size_t bytes) { // Writes past it fail as on a full partition
+    _capacity = bytes;
+  }
+  void setRenameLimit(int16_t renames) { // Renames past it fail as on a flash error, -1 for no limit
+    _renames = renames;
+  }
+  size_t usedBytes() const;
+
+protected:
+  std::map<std::string, std::vector<uint8_t>> _files;
+  size_t _capacity = 1024 * 1024;
+  int16_t _renames = -1;
+
+  friend class File;
+  friend class Dir;
+};
+
+extern FS SPIFFS;
+
+#endif
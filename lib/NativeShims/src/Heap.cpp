@@ -0,0 +1,242 @@
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include "Arduino.h"
+
+// Replaces host malloc() with best fit allocator over fixed pool like umm_malloc of ESP8266 core, so free heap,
+// largest block and fragmentation reported by EspClass follow the sketch alone and are the same on every run.
+// Single threaded, as sketch is.
+
+struct __attribute__((aligned(16))) block_t {
+  size_t size; // Including header, lowest bit set when used
+  size_t prevSize; // Size of previous block, 0 for first one
+};
+
+static const size_t BLOCK_USED = 1;
+static const size_t BLOCK_MIN = 2 * sizeof(block_t);
+
+static uint8_t heap[NATIVE_HEAP_SIZE] __attribute__((aligned(16)));
+static uint8_t *const heapEnd = heap + NATIVE_HEAP_SIZE;
+
+static inline block_t *blockAt(uint8_t *ptr) {
+  return (block_t*)ptr;
+}
+
+static inline size_t blockSize(const block_t *block) {
+  return block->size & ~BLOCK_USED;
+}
+
+static inline block_t *nextBlock(block_t *block) {
+  uint8_t *next = (uint8_t*)block + blockSize(block);
+
+  return next < heapEnd ? blockAt(next) : NULL;
+}
+
+static inline block_t *ptrBlock(void *ptr) {
+  return (block_t*)ptr - 1;
+}
+
+static bool heapOwns(void *ptr) {
+  return ((uint8_t*)ptr > heap) && ((uint8_t*)ptr < heapEnd);
+}
+
+static void heapInit() {
+  if (! blockAt(heap)->size) {
+    blockAt(heap)->size = NATIVE_HEAP_SIZE;
+    blockAt(heap)->prevSize = 0;
+  }
+}
+
+static void setSize(block_t *block, size_t size, bool used) {
+  block_t *next;
+
+  block->size = size | (used ? BLOCK_USED : 0);
+  next = nextBlock(block);
+  if (next)
+    next->prevSize = size;
+}
+
+static void split(block_t *block, size_t size) { // Tail beyond size becomes free block
+  size_t rest = blockSize(block) - size;
+
+  if (rest >= BLOCK_MIN) {
+    block_t *tail = blockAt((uint8_t*)block + size);
+
+    block->size = size | (block->size & BLOCK_USED);
+    tail->prevSize = size;
+    setSize(tail, rest, false);
+  }
+}
+
+static bool blockNeed(size_t size, size_t &need) {
+  if (size > NATIVE_HEAP_SIZE - sizeof(block_t))
+    return false;
+  need = (size + sizeof(block_t) + sizeof(block_t) - 1) & ~(sizeof(block_t) - 1);
+  if (need < BLOCK_MIN)
+    need = BLOCK_MIN;
+
+  return true;
+}
+
+static void *heapMalloc(size_t size) {
+  block_t *best = NULL;
+  size_t need;
+
+  heapInit();
+  if (! blockNeed(size, need)) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  for (block_t *block = blockAt(heap); block; block = nextBlock(block)) {
+    if ((! (block->size & BLOCK_USED)) && (block->size >= need) && ((! best) || (block->size < best->size))) {
+      best = block;
+      if (block->size == need)
+        break;
+    }
+  }
+  if (! best) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  best->size |= BLOCK_USED;
+  split(best, need);
+
+  return best + 1;
+}
+
+static void heapFree(void *ptr) {
+  block_t *block, *next;
+
+  if (! heapOwns(ptr))
+    return;
+  block = ptrBlock(ptr);
+  block->size &= ~BLOCK_USED;
+  next = nextBlock(block);
+  if (next && (! (next->size & BLOCK_USED)))
+    setSize(block, block->size + next->size, false);
+  if (block->prevSize) {
+    block_t *prev = blockAt((uint8_t*)block - block->prevSize);
+
+    if (! (prev->size & BLOCK_USED))
+      setSize(prev, prev->size + block->size, false);
+  }
+}
+
+static void *heapRealloc(void *ptr, size_t size) {
+  block_t *block, *next;
+  size_t need;
+  void *result;
+
+  if (! heapOwns(ptr))
+    return heapMalloc(size);
+  if (! size) {
+    heapFree(ptr);
+    return NULL;
+  }
+  if (! blockNeed(size, need)) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  block = ptrBlock(ptr);
+  if (blockSize(block) < need) { // Grow into free neighbour before moving
+    next = nextBlock(block);
+    if (next && (! (next->size & BLOCK_USED)) && (blockSize(block) + next->size >= need))
+      setSize(block, blockSize(block) + next->size, true);
+  }
+  if (blockSize(block) >= need) {
+    split(block, need);
+    next = nextBlock(block);
+    if (next && (! (next->size & BLOCK_USED))) { // Freed tail joins following free block
+      block_t *after = nextBlock(next);
+
+      if (after && (! (after->size & BLOCK_USED)))
+        setSize(next, next->size + after->size, false);
+    }
+    return ptr;
+  }
+  result = heapMalloc(size);
+  if (result) {
+    memcpy(result, ptr, blockSize(block) - sizeof(block_t));
+    heapFree(ptr);
+  }
+
+  return result;
+}
+
+extern "C" {
+
+void *malloc(size_t size) {
+  return heapMalloc(size);
+}
+
+void free(void *ptr) {
+  heapFree(ptr);
+}
+
+void *calloc(size_t count, size_t size) {
+  void *result;
+
+  if (size && (count > (size_t)-1 / size)) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  result = heapMalloc(count * size);
+  if (result)
+    memset(result, 0, count * size);
+
+  return result;
+}
+
+void *realloc(void *ptr, size_t size) {
+  return heapRealloc(ptr, size);
+}
+
+size_t malloc_usable_size(void *ptr) {
+  return heapOwns(ptr) ? blockSize(ptrBlock(ptr)) - sizeof(block_t) : 0;
+}
+
+void *memalign(size_t alignment, size_t size) { // Blocks are aligned to header size only
+  if (alignment > sizeof(block_t)) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  return heapMalloc(size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+  if (alignment > sizeof(block_t))
+    return EINVAL;
+  *ptr = heapMalloc(size);
+
+  return *ptr || (! size) ? 0 : ENOMEM;
+}
+
+}
+
+void nativeHeapStats(uint32_t *free, uint32_t *max, uint8_t *frag) {
+  uint32_t freeSum = 0, maxSize = 0;
+  double squares = 0;
+
+  heapInit();
+  for (block_t *block = blockAt(heap); block; block = nextBlock(block)) {
+    if (! (block->size & BLOCK_USED)) {
+      uint32_t size = block->size - sizeof(block_t);
+
+      freeSum += size;
+      if (size > maxSize)
+        maxSize = size;
+      squares += (double)size * size;
+    }
+  }
+  if (free)
+    *free = freeSum;
+  if (max)
+    *max = maxSize;
+  if (frag) // Same metric as umm_fragmentation_metric()
+    *frag = freeSum ? 100 - (uint8_t)(sqrt(squares) * 100 / freeSum) : 0;
+}
@@ -0,0 +1,34 @@
+#ifndef __IPADDRESS_H
+#define __IPADDRESS_H
+
+#include <inttypes.h>
+#include <string.h>
+#include "Printable.h"
+#include "WString.h"
+
+class IPAddress : public Printable {
+public:
+  IPAddress() : _address{ 0, 0, 0, 0 } {}
+  IPAddress(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4) : _address{ b1, b2, b3, b4 } {}
+
+  bool isSet() const {
+    return _address[0] || _address[1] || _address[2] || _address[3];
+  }
+  uint8_t operator[](int index) const {
+    return _address[index];
+  }
+  bool operator==(const IPAddress &addr) const {
+    return ! memcmp(_address, addr._address, sizeof(_address));
+  }
+  bool operator!=(const IPAddress &addr) const {
+    return ! (*this == addr);
+  }
+
+  String toString() const;
+  size_t printTo(Print &p) const override;
+
+protected:
+  uint8_t _address[4];
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Print.h"
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t result = 0;
+
+  while (size--) {
+    if (! write(*buffer++))
+      break;
+    ++result;
+  }
+
+  return result;
+}
+
+static size_t vprint(Print &out, const char *format, va_list arg) {
+  char buf[64];
+  va_list copy;
+
+  va_copy(copy, arg);
+  int len = vsnprintf(buf, sizeof(buf), format, copy);
+  va_end(copy);
+  if (len < 0)
+    return 0;
+  if ((size_t)len < sizeof(buf))
+    return out.write((const uint8_t*)buf, len);
+
+  char *big = (char*)malloc(len + 1);
+
+  if (! big)
+    return 0;
+  vsnprintf(big, len + 1, format, arg);
+  len = out.write((const uint8_t*)big, len);
+  free(big);
+
+  return len;
+}
+
+size_t Print::printf(const char *format, ...) {
+  va_list arg;
+
+  va_start(arg, format);
+  size_t result = vprint(*this, format, arg);
+  va_end(arg);
+
+  return result;
+}
+
+size_t Print::printf_P(PGM_P format, ...) {
+  va_list arg;
+
+  va_start(arg, format);
+  size_t result = vprint(*this, format, arg);
+  va_end(arg);
+
+  return result;
+}
+
+size_t Print::print(const __FlashStringHelper *str) {
+  return write(reinterpret_cast<const char*>(str));
+}
+
+size_t Print::print(const String &str) {
+  return write((const uint8_t*)str.c_str(), str.length());
+}
+
+size_t Print::print(const char *str) {
+  return write(str);
+}
+
+size_t Print::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char value, int base) {
+  return print((unsigned long long)value, base);
+}
+
+size_t Print::print(int value, int base) {
+  return print((long long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+  return print((unsigned long long)value, base);
+}
+
+size_t Print::print(long value, int base) {
+  return print((long long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  return print((unsigned long long)value, base);
+}
+
+size_t Print::print(long long value, int base) {
+  if (! base)
+    return write((uint8_t)value);
+
+  return print(String(value, base));
+}
+
+size_t Print::print(unsigned long long value, int base) {
+  if (! base)
+    return write((uint8_t)value);
+
+  return print(String(value, base));
+}
+
+size_t Print::print(double value, int digits) {
+  return print(String(value, digits));
+}
+
+size_t Print::print(const Printable &p) {
+  return p.printTo(*this);
+}
+
+size_t Print::println() {
+  return write("\r\n");
+}
@@ -0,0 +1,51 @@
+#include "Stream.h"
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+  size_t result = 0;
+
+  while (result < length) {
+    int c = read();
+
+    if (c < 0)
+      break;
+    buffer[result++] = c;
+  }
+
+  return result;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length) {
+  size_t result = 0;
+
+  while (result < length) {
+    int c = read();
+
+    if ((c < 0) || (c == terminator))
+      break;
+    buffer[result++] = c;
+  }
+
+  return result;
+}
+
+String Stream::readString() {
+  String result;
+  int c;
+
+  while ((c = read()) >= 0) {
+    result += (char)c;
+  }
+
+  return result;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String result;
+  int c;
+
+  while (((c = read()) >= 0) && (c != terminator)) {
+    result += (char)c;
+  }
+
+  return result;
+}
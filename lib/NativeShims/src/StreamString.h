@@ -0,0 +1,28 @@
+#ifndef __STREAMSTRING_H
+#define __STREAMSTRING_H
+
+#include "Stream.h"
+
+class StreamString : public Stream, public String {
+public:
+  size_t write(const uint8_t *buffer, size_t size) override {
+    return concat((const char*)buffer, size) ? size : 0;
+  }
+  size_t write(uint8_t c) override {
+    return concat((char)c) ? 1 : 0;
+  }
+  int available() override {
+    return length() - _pos;
+  }
+  int read() override {
+    return _pos < length() ? (uint8_t)c_str()[_pos++] : -1;
+  }
+  int peek() override {
+    return _pos < length() ? (uint8_t)c_str()[_pos] : -1;
+  }
+
+protected:
+  unsigned int _pos = 0;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef __TESTFIXTURE_H
+#define __TESTFIXTURE_H
+
+#include "BaseConfig.h"
+#include "BaseWebServer.h"
+
+// Config and web server shared by unit tests: one param of each kind the tests exercise, split into two sections
+
+const char NAME_PARAM[] PROGMEM = "name";
+const char PSWD_PARAM[] PROGMEM = "pswd";
+const char LEVEL_PARAM[] PROGMEM = "level";
+const char LEVEL_DESCR[] PROGMEM = "Level";
+const paramlimits_t LEVEL_LIMITS PROGMEM = LIMITS_RANGE(0, 10, 2);
+const char RATIO_PARAM[] PROGMEM = "ratio";
+const char ENABLED_PARAM[] PROGMEM = "enabled";
+const char SLOTS_PARAM[] PROGMEM = "slots";
+const char NAME_DEF[] PROGMEM = "device";
+const uint16_t SLOTS_DEF[] PROGMEM = { 1, 2, 3 };
+
+const char MAIN_SECTION[] PROGMEM = "main";
+const char EXTRA_SECTION[] PROGMEM = "extra";
+
+const param_t TEST_PARAMS[] PROGMEM = {
+  PARAM_STR(NAME_PARAM, NULL, 16, NAME_DEF),
+  PARAM_PSWD(PSWD_PARAM, NULL, 16, NULL),
+  PARAM_UI8_LIMITS(LEVEL_PARAM, LEVEL_DESCR, 4, LEVEL_LIMITS),
+  PARAM_FLOAT(RATIO_PARAM, NULL, 0.5),
+  PARAM_BOOL(ENABLED_PARAM, NULL, true),
+  PARAM_ARRAY(SLOTS_PARAM, NULL, PAR_UI16, 3, SLOTS_DEF)
+};
+
+enum { SECTION_MAIN, SECTION_EXTRA };
+
+const paramsection_t TEST_SECTIONS[] PROGMEM = {
+  SECTION(MAIN_SECTION, 2),
+  SECTION(EXTRA_SECTION, 4)
+};
+
+class TestConfig : public BaseConfig {
+public:
+  TestConfig() : BaseConfig(TEST_PARAMS, 6, TEST_SECTIONS, 2) {}
+
+  void *getParamPtr(uint8_t index) {
+    if (index == 0)
+      return _name;
+    else if (index == 1)
+      return _pswd;
+    else if (index == 2)
+      return &_level;
+    else if (index == 3)
+      return &_ratio;
+    else if (index == 4)
+      return &_enabled;
+    else if (index == 5)
+      return _slots;
+
+    return NULL;
+  }
+
+  struct __packed {
+    char _name[16];
+    char _pswd[16];
+    uint8_t _level;
+    float _ratio;
+    bool _enabled;
+    uint16_t _slots[3];
+  };
+};
+
+class TestWebServer : public BaseWebServer { // Gives tests the in-process server of shims
+public:
+  TestWebServer(const BaseConfig *config) : BaseWebServer(config) {}
+
+  ESP8266WebServer &server() {
+    return *_http;
+  }
+};
+
+#endif
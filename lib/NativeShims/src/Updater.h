@@ -0,0 +1,42 @@
+#ifndef __UPDATER_H
+#define __UPDATER_H
+
+#include "Arduino.h"
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+class UpdaterClass { // Counts firmware bytes, nothing is flashed
+public:
+  bool begin(size_t size) {
+    _size = size;
+    _written = 0;
+    _error = false;
+    return true;
+  }
+  size_t write(uint8_t *data, size_t len) {
+    _written += len;
+    return len;
+  }
+  bool end(bool evenIfRemaining = false) {
+    _error = (! evenIfRemaining) && (_size != UPDATE_SIZE_UNKNOWN) && (_written != _size);
+    return ! _error;
+  }
+  bool hasError() const {
+    return _error;
+  }
+  void printError(Print &out) {
+    out.println(F("Native update error"));
+  }
+  size_t progress() const {
+    return _written;
+  }
+
+protected:
+  size_t _size = 0;
+  size_t _written = 0;
+  bool _error = false;
+};
+
+extern UpdaterClass Update;
+
+#endif
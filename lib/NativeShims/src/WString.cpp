@@ -0,0 +1,510 @@
+#include <stdlib.h>
+#include <ctype.h>
+#include "WString.h"
+
+const String emptyString;
+
+static char *numberToStr(char *buf, unsigned long long value, bool negative, unsigned char base) {
+  char *p = &buf[sizeof(unsigned long long) * 8 + 1];
+
+  *p = '\0';
+  if ((base < 2) || (base > 36))
+    base = 10;
+  do {
+    uint8_t digit = value % base;
+
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  if (negative)
+    *--p = '-';
+
+  return p;
+}
+
+static char *floatToStr(char *buf, size_t size, double value, unsigned char decimalPlaces) {
+  snprintf(buf, size, "%.*f", decimalPlaces, value);
+
+  return buf;
+}
+
+String::String(const char *cstr) : _buf(NULL), _len(0), _cap(0) {
+  if (cstr)
+    copy(cstr, strlen(cstr));
+}
+
+String::String(const char *cstr, unsigned int length) : _buf(NULL), _len(0), _cap(0) {
+  if (cstr)
+    copy(cstr, length);
+}
+
+String::String(const String &str) : _buf(NULL), _len(0), _cap(0) {
+  copy(str.c_str(), str._len);
+}
+
+String::String(String &&str) : _buf(NULL), _len(0), _cap(0) {
+  move(str);
+}
+
+String::String(const __FlashStringHelper *str) : String(reinterpret_cast<const char*>(str)) {}
+
+String::String(char c) : _buf(NULL), _len(0), _cap(0) {
+  copy(&c, 1);
+}
+
+String::String(unsigned char value, unsigned char base) : String((unsigned long long)value, base) {}
+
+String::String(int value, unsigned char base) : String((long long)value, base) {}
+
+String::String(unsigned int value, unsigned char base) : String((unsigned long long)value, base) {}
+
+String::String(long value, unsigned char base) : String((long long)value, base) {}
+
+String::String(unsigned long value, unsigned char base) : String((unsigned long long)value, base) {}
+
+String::String(long long value, unsigned char base) : _buf(NULL), _len(0), _cap(0) {
+  char buf[sizeof(unsigned long long) * 8 + 2];
+
+  if ((base == 10) && (value < 0))
+    *this = numberToStr(buf, -(unsigned long long)value, true, base);
+  else
+    *this = numberToStr(buf, value, false, base);
+}
+
+String::String(unsigned long long value, unsigned char base) : _buf(NULL), _len(0), _cap(0) {
+  char buf[sizeof(unsigned long long) * 8 + 2];
+
+  *this = numberToStr(buf, value, false, base);
+}
+
+String::String(float value, unsigned char decimalPlaces) : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned char decimalPlaces) : _buf(NULL), _len(0), _cap(0) {
+  char buf[64];
+
+  *this = floatToStr(buf, sizeof(buf), value, decimalPlaces);
+}
+
+String::~String() {
+  if (_buf)
+    free(_buf);
+}
+
+bool String::reserve(unsigned int size) {
+  if (_buf && (_cap >= size))
+    return true;
+
+  return grow(size);
+}
+
+bool String::grow(unsigned int length) {
+  char *buf = (char*)realloc(_buf, length + 1);
+
+  if (! buf)
+    return false;
+  if (! _buf)
+    buf[0] = '\0';
+  _buf = buf;
+  _cap = length;
+
+  return true;
+}
+
+String &String::copy(const char *cstr, unsigned int length) {
+  if (! reserve(length)) {
+    clear();
+    return *this;
+  }
+  memmove(_buf, cstr, length);
+  _len = length;
+  _buf[_len] = '\0';
+
+  return *this;
+}
+
+void String::move(String &rhs) {
+  if (_buf)
+    free(_buf);
+  _buf = rhs._buf;
+  _len = rhs._len;
+  _cap = rhs._cap;
+  rhs._buf = NULL;
+  rhs._len = 0;
+  rhs._cap = 0;
+}
+
+String &String::operator=(const String &rhs) {
+  if (this != &rhs)
+    copy(rhs.c_str(), rhs._len);
+
+  return *this;
+}
+
+String &String::operator=(String &&rhs) {
+  if (this != &rhs)
+    move(rhs);
+
+  return *this;
+}
+
+String &String::operator=(const char *cstr) {
+  if (cstr)
+    copy(cstr, strlen(cstr));
+  else
+    clear();
+
+  return *this;
+}
+
+String &String::operator=(const __FlashStringHelper *str) {
+  return *this = reinterpret_cast<const char*>(str);
+}
+
+String &String::operator=(char c) {
+  return copy(&c, 1);
+}
+
+bool String::concat(const char *cstr, unsigned int length) {
+  if (! length)
+    return true;
+  if (! cstr)
+    return false;
+  if (_len + length > _cap) {
+    unsigned int size = _cap * 3 / 2;
+
+    if (size < _len + length)
+      size = _len + length;
+    if (cstr >= c_str() && (cstr < c_str() + _len)) { // Appending part of itself
+      String tmp(cstr, length);
+
+      return grow(size) && concat(tmp);
+    }
+    if (! grow(size))
+      return false;
+  }
+  memcpy(&_buf[_len], cstr, length);
+  _len += length;
+  _buf[_len] = '\0';
+
+  return true;
+}
+
+bool String::concat(const String &str) {
+  return concat(str.c_str(), str._len);
+}
+
+bool String::concat(const char *cstr) {
+  return cstr && concat(cstr, strlen(cstr));
+}
+
+bool String::concat(const __FlashStringHelper *str) {
+  return concat(reinterpret_cast<const char*>(str));
+}
+
+bool String::concat(char c) {
+  return concat(&c, 1);
+}
+
+bool String::concat(unsigned char value) {
+  return concat(String(value));
+}
+
+bool String::concat(int value) {
+  return concat(String(value));
+}
+
+bool String::concat(unsigned int value) {
+  return concat(String(value));
+}
+
+bool String::concat(long value) {
+  return concat(String(value));
+}
+
+bool String::concat(unsigned long value) {
+  return concat(String(value));
+}
+
+bool String::concat(long long value) {
+  return concat(String(value));
+}
+
+bool String::concat(unsigned long long value) {
+  return concat(String(value));
+}
+
+bool String::concat(float value) {
+  return concat(String(value));
+}
+
+bool String::concat(double value) {
+  return concat(String(value));
+}
+
+int String::compareTo(const String &s) const {
+  return strcmp(c_str(), s.c_str());
+}
+
+bool String::equals(const String &s) const {
+  return (_len == s._len) && (! memcmp(c_str(), s.c_str(), _len));
+}
+
+bool String::equals(const char *cstr) const {
+  return ! strcmp(c_str(), cstr ? cstr : "");
+}
+
+bool String::equalsIgnoreCase(const String &s) const {
+  return (_len == s._len) && (! strcasecmp(c_str(), s.c_str()));
+}
+
+bool String::equalsConstantTime(const String &s) const {
+  uint8_t diff = _len != s._len;
+
+  for (unsigned int i = 0; (i < _len) && (i < s._len); ++i) {
+    diff |= _buf[i] ^ s._buf[i];
+  }
+
+  return ! diff;
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const {
+  return (offset + prefix._len <= _len) && (! memcmp(c_str() + offset, prefix.c_str(), prefix._len));
+}
+
+bool String::startsWith(const String &prefix) const {
+  return startsWith(prefix, 0);
+}
+
+bool String::endsWith(const String &suffix) const {
+  return (suffix._len <= _len) && (! memcmp(c_str() + _len - suffix._len, suffix.c_str(), suffix._len));
+}
+
+char String::charAt(unsigned int index) const {
+  return index < _len ? _buf[index] : '\0';
+}
+
+void String::setCharAt(unsigned int index, char c) {
+  if (index < _len)
+    _buf[index] = c;
+}
+
+char String::operator[](unsigned int index) const {
+  return charAt(index);
+}
+
+char &String::operator[](unsigned int index) {
+  static char dummy;
+
+  if (index >= _len) {
+    dummy = '\0';
+    return dummy;
+  }
+
+  return _buf[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const {
+  if ((! bufsize) || (! buf))
+    return;
+  if (index >= _len) {
+    buf[0] = '\0';
+    return;
+  }
+
+  unsigned int n = bufsize - 1;
+
+  if (n > _len - index)
+    n = _len - index;
+  memcpy(buf, _buf + index, n);
+  buf[n] = '\0';
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+  if (fromIndex >= _len)
+    return -1;
+
+  const char *p = (const char*)memchr(_buf + fromIndex, ch, _len - fromIndex);
+
+  return p ? p - _buf : -1;
+}
+
+int String::indexOf(const char *str, unsigned int fromIndex) const {
+  if (fromIndex > _len)
+    return -1;
+
+  const char *p = strstr(c_str() + fromIndex, str);
+
+  return p ? p - c_str() : -1;
+}
+
+int String::lastIndexOf(char ch) const {
+  return _len ? lastIndexOf(ch, _len - 1) : -1;
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const {
+  if (fromIndex >= _len)
+    return -1;
+  for (int i = fromIndex; i >= 0; --i) {
+    if (_buf[i] == ch)
+      return i;
+  }
+
+  return -1;
+}
+
+int String::lastIndexOf(const String &str) const {
+  if (str._len > _len)
+    return -1;
+  for (int i = _len - str._len; i >= 0; --i) {
+    if (! memcmp(_buf + i, str.c_str(), str._len))
+      return i;
+  }
+
+  return -1;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+  if (beginIndex > endIndex) {
+    unsigned int tmp = beginIndex;
+
+    beginIndex = endIndex;
+    endIndex = tmp;
+  }
+  if (beginIndex >= _len)
+    return String();
+  if (endIndex > _len)
+    endIndex = _len;
+
+  return String(_buf + beginIndex, endIndex - beginIndex);
+}
+
+void String::replace(char find, char replace) {
+  for (unsigned int i = 0; i < _len; ++i) {
+    if (_buf[i] == find)
+      _buf[i] = replace;
+  }
+}
+
+void String::replace(const String &find, const String &replace) {
+  if (! find._len)
+    return;
+
+  String result;
+  int from = 0;
+  int pos;
+
+  while ((pos = indexOf(find, from)) >= 0) {
+    result.concat(c_str() + from, pos - from);
+    result.concat(replace);
+    from = pos + find._len;
+  }
+  result.concat(c_str() + from, _len - from);
+  move(result);
+}
+
+void String::remove(unsigned int index) {
+  remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index >= _len)
+    return;
+  if (count > _len - index)
+    count = _len - index;
+  memmove(_buf + index, _buf + index + count, _len - index - count + 1);
+  _len -= count;
+}
+
+void String::clear() {
+  _len = 0;
+  if (_buf)
+    _buf[0] = '\0';
+}
+
+void String::toLowerCase() {
+  for (unsigned int i = 0; i < _len; ++i) {
+    _buf[i] = tolower((unsigned char)_buf[i]);
+  }
+}
+
+void String::toUpperCase() {
+  for (unsigned int i = 0; i < _len; ++i) {
+    _buf[i] = toupper((unsigned char)_buf[i]);
+  }
+}
+
+void String::trim() {
+  unsigned int first = 0;
+
+  while ((first < _len) && isspace((unsigned char)_buf[first])) {
+    ++first;
+  }
+  while ((_len > first) && isspace((unsigned char)_buf[_len - 1])) {
+    --_len;
+  }
+  if (_buf) {
+    memmove(_buf, _buf + first, _len - first);
+    _len -= first;
+    _buf[_len] = '\0';
+  }
+}
+
+long String::toInt() const {
+  return atol(c_str());
+}
+
+float String::toFloat() const {
+  return atof(c_str());
+}
+
+double String::toDouble() const {
+  return atof(c_str());
+}
+
+String operator+(const String &lhs, const String &rhs) {
+  String result(lhs);
+
+  result.concat(rhs);
+
+  return result;
+}
+
+String operator+(const String &lhs, const char *rhs) {
+  String result(lhs);
+
+  result.concat(rhs);
+
+  return result;
+}
+
+String operator+(const char *lhs, const String &rhs) {
+  String result(lhs);
+
+  result.concat(rhs);
+
+  return result;
+}
+
+String operator+(const String &lhs, const __FlashStringHelper *rhs) {
+  String result(lhs);
+
+  result.concat(rhs);
+
+  return result;
+}
+
+String operator+(const String &lhs, char rhs) {
+  String result(lhs);
+
+  result.concat(rhs);
+
+  return result;
+}
+
+String operator+(char lhs, const String &rhs) {
+  String result(lhs);
+
+  result.concat(rhs);
+
+  return result;
+}
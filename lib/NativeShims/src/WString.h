@@ -0,0 +1,185 @@
+#ifndef __WSTRING_H
+#define __WSTRING_H
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "pgmspace.h"
+
+class __FlashStringHelper;
+#define FPSTR(pstr_pointer) (reinterpret_cast<const __FlashStringHelper *>(pstr_pointer))
+#define F(string_literal) (FPSTR(PSTR(string_literal)))
+
+// Heap String with the ESP8266 core interface, buffer comes from malloc() so heap tracing sees it
+
+class String {
+public:
+  String(const char *cstr = "");
+  String(const char *cstr, unsigned int length);
+  String(const String &str);
+  String(String &&str);
+  String(const __FlashStringHelper *str);
+  explicit String(char c);
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(float value, unsigned char decimalPlaces = 2);
+  explicit String(double value, unsigned char decimalPlaces = 2);
+  ~String();
+
+  bool reserve(unsigned int size);
+  unsigned int length() const {
+    return _len;
+  }
+  unsigned int capacity() const {
+    return _cap;
+  }
+  bool isEmpty() const {
+    return ! _len;
+  }
+
+  String &operator=(const String &rhs);
+  String &operator=(String &&rhs);
+  String &operator=(const char *cstr);
+  String &operator=(const __FlashStringHelper *str);
+  String &operator=(char c);
+
+  bool concat(const String &str);
+  bool concat(const char *cstr);
+  bool concat(const char *cstr, unsigned int length);
+  bool concat(const __FlashStringHelper *str);
+  bool concat(char c);
+  bool concat(unsigned char value);
+  bool concat(int value);
+  bool concat(unsigned int value);
+  bool concat(long value);
+  bool concat(unsigned long value);
+  bool concat(long long value);
+  bool concat(unsigned long long value);
+  bool concat(float value);
+  bool concat(double value);
+
+  template<typename T> String &operator+=(const T &rhs) {
+    concat(rhs);
+    return *this;
+  }
+  String &operator+=(const char *cstr) {
+    concat(cstr);
+    return *this;
+  }
+
+  int compareTo(const String &s) const;
+  bool equals(const String &s) const;
+  bool equals(const char *cstr) const;
+  bool equalsIgnoreCase(const String &s) const;
+  bool equalsConstantTime(const String &s) const;
+  bool operator==(const String &rhs) const {
+    return equals(rhs);
+  }
+  bool operator==(const char *cstr) const {
+    return equals(cstr);
+  }
+  bool operator==(const __FlashStringHelper *rhs) const {
+    return equals(reinterpret_cast<const char*>(rhs));
+  }
+  bool operator!=(const String &rhs) const {
+    return ! equals(rhs);
+  }
+  bool operator!=(const char *cstr) const {
+    return ! equals(cstr);
+  }
+  bool operator!=(const __FlashStringHelper *rhs) const {
+    return ! equals(reinterpret_cast<const char*>(rhs));
+  }
+  bool operator<(const String &rhs) const {
+    return compareTo(rhs) < 0;
+  }
+  bool startsWith(const String &prefix) const;
+  bool startsWith(const String &prefix, unsigned int offset) const;
+  bool startsWith(const __FlashStringHelper *prefix) const {
+    return startsWith(String(prefix));
+  }
+  bool endsWith(const String &suffix) const;
+  bool endsWith(const __FlashStringHelper *suffix) const {
+    return endsWith(String(suffix));
+  }
+
+  char charAt(unsigned int index) const;
+  void setCharAt(unsigned int index, char c);
+  char operator[](unsigned int index) const;
+  char &operator[](unsigned int index);
+  void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+  void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const {
+    getBytes((unsigned char*)buf, bufsize, index);
+  }
+  const char *c_str() const {
+    return _buf ? _buf : "";
+  }
+  char *begin() {
+    return _buf;
+  }
+  char *end() {
+    return _buf + _len;
+  }
+  const char *begin() const {
+    return c_str();
+  }
+  const char *end() const {
+    return c_str() + _len;
+  }
+
+  int indexOf(char ch, unsigned int fromIndex = 0) const;
+  int indexOf(const char *str, unsigned int fromIndex = 0) const;
+  int indexOf(const String &str, unsigned int fromIndex = 0) const {
+    return indexOf(str.c_str(), fromIndex);
+  }
+  int indexOf(const __FlashStringHelper *str, unsigned int fromIndex = 0) const {
+    return indexOf(reinterpret_cast<const char*>(str), fromIndex);
+  }
+  int lastIndexOf(char ch) const;
+  int lastIndexOf(char ch, unsigned int fromIndex) const;
+  int lastIndexOf(const String &str) const;
+  String substring(unsigned int beginIndex) const {
+    return substring(beginIndex, _len);
+  }
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void replace(char find, char replace);
+  void replace(const String &find, const String &replace);
+  void remove(unsigned int index);
+  void remove(unsigned int index, unsigned int count);
+  void clear();
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const;
+  float toFloat() const;
+  double toDouble() const;
+
+protected:
+  bool grow(unsigned int length);
+  String &copy(const char *cstr, unsigned int length);
+  void move(String &rhs);
+
+  char *_buf;
+  unsigned int _len;
+  unsigned int _cap;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, const __FlashStringHelper *rhs);
+String operator+(const String &lhs, char rhs);
+String operator+(char lhs, const String &rhs);
+
+extern const String emptyString;
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef __WIFIUDP_H
+#define __WIFIUDP_H
+
+class WiFiUDP {
+public:
+  static void stopAll() {}
+};
+
+#endif
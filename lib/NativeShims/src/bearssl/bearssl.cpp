@@ -0,0 +1,339 @@
+#include <string.h>
+#include "bearssl.h"
+
+// Straightforward FIPS 180-4 and RFC 8439 code, host tests need correct results rather than speed
+
+static const uint32_t SHA256_K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t rotr(uint32_t x, uint8_t n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+static inline uint32_t rotl(uint32_t x, uint8_t n) {
+  return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t load32le(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void store32le(uint8_t *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static void sha256Block(uint32_t *val, const uint8_t *block) {
+  uint32_t w[64];
+  uint32_t s[8];
+
+  for (uint8_t i = 0; i < 16; ++i) {
+    w[i] = ((uint32_t)block[i * 4] << 24) | (block[i * 4 + 1] << 16) | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+  }
+  for (uint8_t i = 16; i < 64; ++i) {
+    w[i] = w[i - 16] + (rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3)) + w[i - 7] + (rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10));
+  }
+  memcpy(s, val, sizeof(s));
+  for (uint8_t i = 0; i < 64; ++i) {
+    uint32_t t1 = s[7] + (rotr(s[4], 6) ^ rotr(s[4], 11) ^ rotr(s[4], 25)) + ((s[4] & s[5]) ^ (~s[4] & s[6])) + SHA256_K[i] + w[i];
+    uint32_t t2 = (rotr(s[0], 2) ^ rotr(s[0], 13) ^ rotr(s[0], 22)) + ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+
+    memmove(&s[1], &s[0], sizeof(uint32_t) * 7);
+    s[4] += t1;
+    s[0] = t1 + t2;
+  }
+  for (uint8_t i = 0; i < 8; ++i) {
+    val[i] += s[i];
+  }
+}
+
+static void sha256Init(const br_hash_class **ctx) {
+  br_sha256_init((br_sha256_context*)ctx);
+}
+
+static void sha256Update(const br_hash_class **ctx, const void *data, size_t len) {
+  br_sha256_update((br_sha256_context*)ctx, data, len);
+}
+
+static void sha256Out(const br_hash_class *const *ctx, void *dst) {
+  br_sha256_out((const br_sha256_context*)ctx, dst);
+}
+
+const br_hash_class br_sha256_vtable = { sizeof(br_sha256_context), 4, sha256Init, sha256Update, sha256Out };
+
+void br_sha256_init(br_sha256_context *ctx) {
+  static const uint32_t IV[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+
+  ctx->vtable = &br_sha256_vtable;
+  ctx->count = 0;
+  memcpy(ctx->val, IV, sizeof(IV));
+}
+
+void br_sha256_update(br_sha256_context *ctx, const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t*)data;
+
+  while (len) {
+    size_t pos = ctx->count & 63;
+    size_t n = 64 - pos < len ? 64 - pos : len;
+
+    memcpy(ctx->buf + pos, p, n);
+    ctx->count += n;
+    p += n;
+    len -= n;
+    if (! (ctx->count & 63))
+      sha256Block(ctx->val, ctx->buf);
+  }
+}
+
+void br_sha256_out(const br_sha256_context *ctx, void *out) {
+  br_sha256_context copy = *ctx;
+  uint64_t bits = ctx->count * 8;
+  uint8_t pad = 0x80;
+
+  br_sha256_update(&copy, &pad, 1);
+  pad = 0;
+  while ((copy.count & 63) != 56) {
+    br_sha256_update(&copy, &pad, 1);
+  }
+  for (int8_t i = 7; i >= 0; --i) {
+    pad = bits >> (i * 8);
+    br_sha256_update(&copy, &pad, 1);
+  }
+  for (uint8_t i = 0; i < 8; ++i) {
+    ((uint8_t*)out)[i * 4] = copy.val[i] >> 24;
+    ((uint8_t*)out)[i * 4 + 1] = copy.val[i] >> 16;
+    ((uint8_t*)out)[i * 4 + 2] = copy.val[i] >> 8;
+    ((uint8_t*)out)[i * 4 + 3] = copy.val[i];
+  }
+}
+
+void br_hmac_key_init(br_hmac_key_context *kc, const br_hash_class *digest_vtable, const void *key, size_t key_len) {
+  uint8_t block[64];
+
+  memset(block, 0, sizeof(block));
+  if (key_len > sizeof(block)) {
+    br_sha256_context ctx;
+
+    br_sha256_init(&ctx);
+    br_sha256_update(&ctx, key, key_len);
+    br_sha256_out(&ctx, block);
+  } else
+    memcpy(block, key, key_len);
+  kc->dig_vtable = digest_vtable;
+  for (uint8_t i = 0; i < sizeof(block); ++i) {
+    kc->ksi[i] = block[i] ^ 0x36;
+    kc->kso[i] = block[i] ^ 0x5C;
+  }
+}
+
+void br_hmac_init(br_hmac_context *ctx, const br_hmac_key_context *kc, size_t out_len) {
+  br_sha256_init(&ctx->dig);
+  br_sha256_update(&ctx->dig, kc->ksi, sizeof(kc->ksi));
+  memcpy(ctx->kso, kc->kso, sizeof(ctx->kso));
+  ctx->out_len = (out_len && (out_len < br_sha256_SIZE)) ? out_len : br_sha256_SIZE;
+}
+
+void br_hmac_update(br_hmac_context *ctx, const void *data, size_t len) {
+  br_sha256_update(&ctx->dig, data, len);
+}
+
+size_t br_hmac_out(const br_hmac_context *ctx, void *out) {
+  uint8_t inner[br_sha256_SIZE];
+  uint8_t result[br_sha256_SIZE];
+  br_sha256_context outer;
+
+  br_sha256_out(&ctx->dig, inner);
+  br_sha256_init(&outer);
+  br_sha256_update(&outer, ctx->kso, sizeof(ctx->kso));
+  br_sha256_update(&outer, inner, sizeof(inner));
+  br_sha256_out(&outer, result);
+  memcpy(out, result, ctx->out_len);
+
+  return ctx->out_len;
+}
+
+#define QUARTERROUND(a, b, c, d) \
+  a += b; d = rotl(d ^ a, 16); \
+  c += d; b = rotl(b ^ c, 12); \
+  a += b; d = rotl(d ^ a, 8); \
+  c += d; b = rotl(b ^ c, 7);
+
+uint32_t br_chacha20_ct_run(const void *key, const void *iv, uint32_t cc, void *data, size_t len) {
+  uint32_t state[16];
+  uint8_t *p = (uint8_t*)data;
+
+  state[0] = 0x61707865;
+  state[1] = 0x3320646e;
+  state[2] = 0x79622d32;
+  state[3] = 0x6b206574;
+  for (uint8_t i = 0; i < 8; ++i) {
+    state[4 + i] = load32le((const uint8_t*)key + i * 4);
+  }
+  for (uint8_t i = 0; i < 3; ++i) {
+    state[13 + i] = load32le((const uint8_t*)iv + i * 4);
+  }
+  while (len) {
+    uint32_t x[16];
+    uint8_t stream[64];
+
+    state[12] = cc;
+    memcpy(x, state, sizeof(x));
+    for (uint8_t i = 0; i < 10; ++i) {
+      QUARTERROUND(x[0], x[4], x[8], x[12]);
+      QUARTERROUND(x[1], x[5], x[9], x[13]);
+      QUARTERROUND(x[2], x[6], x[10], x[14]);
+      QUARTERROUND(x[3], x[7], x[11], x[15]);
+      QUARTERROUND(x[0], x[5], x[10], x[15]);
+      QUARTERROUND(x[1], x[6], x[11], x[12]);
+      QUARTERROUND(x[2], x[7], x[8], x[13]);
+      QUARTERROUND(x[3], x[4], x[9], x[14]);
+    }
+    for (uint8_t i = 0; i < 16; ++i) {
+      store32le(&stream[i * 4], x[i] + state[i]);
+    }
+
+    size_t n = len < sizeof(stream) ? len : sizeof(stream);
+
+    for (size_t i = 0; i < n; ++i) {
+      p[i] ^= stream[i];
+    }
+    p += n;
+    len -= n;
+    ++cc;
+  }
+
+  return cc;
+}
+
+struct poly1305_t {
+  uint32_t r[5];
+  uint32_t h[5];
+  uint32_t pad[4];
+};
+
+static void poly1305Init(poly1305_t &st, const uint8_t *key) {
+  st.r[0] = load32le(&key[0]) & 0x3ffffff;
+  st.r[1] = (load32le(&key[3]) >> 2) & 0x3ffff03;
+  st.r[2] = (load32le(&key[6]) >> 4) & 0x3ffc0ff;
+  st.r[3] = (load32le(&key[9]) >> 6) & 0x3f03fff;
+  st.r[4] = (load32le(&key[12]) >> 8) & 0x00fffff;
+  memset(st.h, 0, sizeof(st.h));
+  for (uint8_t i = 0; i < 4; ++i) {
+    st.pad[i] = load32le(&key[16 + i * 4]);
+  }
+}
+
+static void poly1305Blocks(poly1305_t &st, const uint8_t *m, size_t len) { // Zero padded to 16 bytes as AEAD needs
+  const uint32_t r0 = st.r[0], r1 = st.r[1], r2 = st.r[2], r3 = st.r[3], r4 = st.r[4];
+  const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+  uint32_t h0 = st.h[0], h1 = st.h[1], h2 = st.h[2], h3 = st.h[3], h4 = st.h[4];
+
+  while (len) {
+    uint8_t block[16];
+    size_t n = len < sizeof(block) ? len : sizeof(block);
+
+    memset(block, 0, sizeof(block));
+    memcpy(block, m, n);
+    h0 += load32le(&block[0]) & 0x3ffffff;
+    h1 += (load32le(&block[3]) >> 2) & 0x3ffffff;
+    h2 += (load32le(&block[6]) >> 4) & 0x3ffffff;
+    h3 += (load32le(&block[9]) >> 6) & 0x3ffffff;
+    h4 += (load32le(&block[12]) >> 8) | (1 << 24);
+
+    uint64_t d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+    uint64_t d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+    uint64_t d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 + (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+    uint64_t d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 + (uint64_t)h3 * r0 + (uint64_t)h4 * s4;
+    uint64_t d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 + (uint64_t)h3 * r1 + (uint64_t)h4 * r0;
+    uint32_t c;
+
+    c = d0 >> 26; h0 = d0 & 0x3ffffff;
+    d1 += c; c = d1 >> 26; h1 = d1 & 0x3ffffff;
+    d2 += c; c = d2 >> 26; h2 = d2 & 0x3ffffff;
+    d3 += c; c = d3 >> 26; h3 = d3 & 0x3ffffff;
+    d4 += c; c = d4 >> 26; h4 = d4 & 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+    m += n;
+    len -= n;
+  }
+  st.h[0] = h0;
+  st.h[1] = h1;
+  st.h[2] = h2;
+  st.h[3] = h3;
+  st.h[4] = h4;
+}
+
+static void poly1305Finish(poly1305_t &st, uint8_t *mac) {
+  uint32_t h0 = st.h[0], h1 = st.h[1], h2 = st.h[2], h3 = st.h[3], h4 = st.h[4];
+  uint32_t c, g0, g1, g2, g3, g4, mask;
+  uint64_t f;
+
+  c = h1 >> 26; h1 &= 0x3ffffff;
+  h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+  h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+  h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+  h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+  h1 += c;
+
+  g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+  g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+  g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+  g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+  g4 = h4 + c - (1 << 26);
+
+  mask = (g4 >> 31) - 1;
+  h0 = (h0 & ~mask) | (g0 & mask);
+  h1 = (h1 & ~mask) | (g1 & mask);
+  h2 = (h2 & ~mask) | (g2 & mask);
+  h3 = (h3 & ~mask) | (g3 & mask);
+  h4 = (h4 & ~mask) | (g4 & mask);
+
+  h0 = (h0 | (h1 << 26)) & 0xffffffff;
+  h1 = ((h1 >> 6) | (h2 << 20)) & 0xffffffff;
+  h2 = ((h2 >> 12) | (h3 << 14)) & 0xffffffff;
+  h3 = ((h3 >> 18) | (h4 << 8)) & 0xffffffff;
+
+  f = (uint64_t)h0 + st.pad[0]; h0 = f;
+  f = (uint64_t)h1 + st.pad[1] + (f >> 32); h1 = f;
+  f = (uint64_t)h2 + st.pad[2] + (f >> 32); h2 = f;
+  f = (uint64_t)h3 + st.pad[3] + (f >> 32); h3 = f;
+
+  store32le(&mac[0], h0);
+  store32le(&mac[4], h1);
+  store32le(&mac[8], h2);
+  store32le(&mac[12], h3);
+}
+
+void br_poly1305_ctmul_run(const void *key, const void *iv, void *data, size_t len, const void *aad, size_t aad_len, void *tag, br_chacha20_run ichacha,
+  int encrypt) {
+  uint8_t polyKey[32];
+  uint8_t lengths[16];
+  poly1305_t st;
+
+  memset(polyKey, 0, sizeof(polyKey));
+  ichacha(key, iv, 0, polyKey, sizeof(polyKey));
+  if (encrypt)
+    ichacha(key, iv, 1, data, len);
+  poly1305Init(st, polyKey);
+  poly1305Blocks(st, (const uint8_t*)aad, aad_len);
+  poly1305Blocks(st, (const uint8_t*)data, len);
+  for (uint8_t i = 0; i < 8; ++i) {
+    lengths[i] = (uint64_t)aad_len >> (i * 8);
+    lengths[8 + i] = (uint64_t)len >> (i * 8);
+  }
+  poly1305Blocks(st, lengths, sizeof(lengths));
+  poly1305Finish(st, (uint8_t*)tag);
+  if (! encrypt)
+    ichacha(key, iv, 1, data, len);
+}
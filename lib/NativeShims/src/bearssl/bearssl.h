@@ -0,0 +1,58 @@
+#ifndef __BEARSSL_H
+#define __BEARSSL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Subset of BearSSL used by the project: SHA-256, HMAC and ChaCha20-Poly1305, same signatures and results
+
+typedef struct br_hash_class_ br_hash_class;
+
+struct br_hash_class_ {
+  size_t context_size;
+  uint32_t desc;
+  void (*init)(const br_hash_class **ctx);
+  void (*update)(const br_hash_class **ctx, const void *data, size_t len);
+  void (*out)(const br_hash_class *const *ctx, void *dst);
+};
+
+#define br_sha256_SIZE 32
+
+typedef struct {
+  const br_hash_class *vtable;
+  unsigned char buf[64];
+  uint64_t count;
+  uint32_t val[8];
+} br_sha256_context;
+
+extern const br_hash_class br_sha256_vtable;
+
+void br_sha256_init(br_sha256_context *ctx);
+void br_sha256_update(br_sha256_context *ctx, const void *data, size_t len);
+void br_sha256_out(const br_sha256_context *ctx, void *out);
+
+typedef struct {
+  const br_hash_class *dig_vtable;
+  unsigned char ksi[64], kso[64];
+} br_hmac_key_context;
+
+typedef struct {
+  br_sha256_context dig; // Only SHA-256 is provided
+  unsigned char kso[64];
+  size_t out_len;
+} br_hmac_context;
+
+void br_hmac_key_init(br_hmac_key_context *kc, const br_hash_class *digest_vtable, const void *key, size_t key_len);
+void br_hmac_init(br_hmac_context *ctx, const br_hmac_key_context *kc, size_t out_len);
+void br_hmac_update(br_hmac_context *ctx, const void *data, size_t len);
+size_t br_hmac_out(const br_hmac_context *ctx, void *out);
+
+typedef uint32_t (*br_chacha20_run)(const void *key, const void *iv, uint32_t cc, void *data, size_t len);
+typedef void (*br_poly1305_run)(const void *key, const void *iv, void *data, size_t len, const void *aad, size_t aad_len, void *tag, br_chacha20_run ichacha,
+  int encrypt);
+
+uint32_t br_chacha20_ct_run(const void *key, const void *iv, uint32_t cc, void *data, size_t len);
+void br_poly1305_ctmul_run(const void *key, const void *iv, void *data, size_t len, const void *aad, size_t aad_len, void *tag, br_chacha20_run ichacha,
+  int encrypt);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __PGMSPACE_H
+#define __PGMSPACE_H
+
+#include <inttypes.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+
+// Host has one address space, flash accessors are plain reads
+
+#define PROGMEM
+#define PGM_P const char *
+#define PGM_VOID_P const void *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_float(addr) (*(const float*)(addr))
+#define pgm_read_double(addr) (*(const double*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#define pgm_read_word_near(addr) pgm_read_word(addr)
+#define pgm_read_dword_near(addr) pgm_read_dword(addr)
+
+#define memcpy_P(dest, src, n) memcpy((dest), (src), (n))
+#define memcmp_P(s1, s2, n) memcmp((s1), (s2), (n))
+#define strlen_P(s) strlen(s)
+#define strnlen_P(s, n) strnlen((s), (n))
+#define strcpy_P(dest, src) strcpy((dest), (src))
+#define strncpy_P(dest, src, n) strncpy((dest), (src), (n))
+#define strcat_P(dest, src) strcat((dest), (src))
+#define strncat_P(dest, src, n) strncat((dest), (src), (n))
+#define strcmp_P(s1, s2) strcmp((s1), (s2))
+#define strncmp_P(s1, s2, n) strncmp((s1), (s2), (n))
+#define strcasecmp_P(s1, s2) strcasecmp((s1), (s2))
+#define strncasecmp_P(s1, s2, n) strncasecmp((s1), (s2), (n))
+#define strchr_P(s, c) strchr((s), (c))
+#define strstr_P(s1, s2) strstr((s1), (s2))
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+
+#endif
@@ -1,10 +1,16 @@
 #ifdef ESP32
 #include <SPIFFS.h>
+#include <esp_system.h>
+#include <mbedtls/chachapoly.h>
+#include <mbedtls/md.h>
 #else
 #include <FS.h>
+#include <bearssl/bearssl.h>
 #endif
 #include "BaseConfig.h"
+#include "ConfigParser.h"
 #include "StrUtils.h"
+#include "Metrics.h"
 
 bool BaseConfig::getParam(uint8_t index, param_t &param) const {
   if (index < _paramCount) {
@@ -17,18 +23,36 @@ bool BaseConfig::getParam(uint8_t index, param_t &param) const {
 }
 
 uint8_t BaseConfig::findParam(const char *name) const {
-  for (uint8_t i = 0; i < _paramCount; ++i) {
-    if (strcasecmp_P(name, (PGM_P)pgm_read_ptr(&_params[i]._name)) == 0)
-      return i;
+  if (buildNameIndex()) {
+    uint16_t hash = nameHash(name, false);
+
+    for (uint8_t i = lowerBound(hash); (i < _paramCount) && (_nameIndex[i].hash == hash); ++i) {
+      if (strcasecmp_P(name, (PGM_P)pgm_read_ptr(&_params[_nameIndex[i].index]._name)) == 0)
+        return _nameIndex[i].index;
+    }
+  } else {
+    for (uint8_t i = 0; i < _paramCount; ++i) {
+      if (strcasecmp_P(name, (PGM_P)pgm_read_ptr(&_params[i]._name)) == 0)
+        return i;
+    }
   }
 
   return ERR_INDEX;
 }
 
 uint8_t BaseConfig::findParam_P(PGM_P name) const {
-  for (uint8_t i = 0; i < _paramCount; ++i) {
-    if (strcasecmp_PP(name, (PGM_P)pgm_read_ptr(&_params[i]._name)) == 0)
-      return i;
+  if (buildNameIndex()) {
+    uint16_t hash = nameHash(name, true);
+
+    for (uint8_t i = lowerBound(hash); (i < _paramCount) && (_nameIndex[i].hash == hash); ++i) {
+      if (strcasecmp_PP(name, (PGM_P)pgm_read_ptr(&_params[_nameIndex[i].index]._name)) == 0)
+        return _nameIndex[i].index;
+    }
+  } else {
+    for (uint8_t i = 0; i < _paramCount; ++i) {
+      if (strcasecmp_PP(name, (PGM_P)pgm_read_ptr(&_params[i]._name)) == 0)
+        return i;
+    }
   }
 
   return ERR_INDEX;
@@ -38,6 +62,26 @@ paramtype_t BaseConfig::paramType(uint8_t index) const {
   if (index < _paramCount) {
     return (paramtype_t)pgm_read_byte(&_params[index]._type);
   }
+
+  return PAR_BOOL;
+}
+
+paramtype_t BaseConfig::itemType(uint8_t index) const {
+  if (index < _paramCount) {
+    return (paramtype_t)pgm_read_byte(&_params[index]._item);
+  }
+
+  return PAR_UI8;
+}
+
+uint16_t BaseConfig::itemCount(uint8_t index) const {
+  if (index < _paramCount) {
+    if ((paramtype_t)pgm_read_byte(&_params[index]._type) == PAR_ARRAY)
+      return pgm_read_word(&_params[index]._size) / paramItemSize((paramtype_t)pgm_read_byte(&_params[index]._item));
+    return 1;
+  }
+
+  return 0;
 }
 
 PGM_P BaseConfig::paramName(uint8_t index) const {
@@ -64,97 +108,574 @@ uint16_t BaseConfig::paramSize(uint8_t index) const {
   return 0;
 }
 
-void BaseConfig::clear() {
-  for (uint8_t i = 0; i < _paramCount; ++i) {
-    void *value = getParamPtr(i);
+bool BaseConfig::getLimits(uint8_t index, paramlimits_t &limits) const {
+  if (index < _paramCount) {
+    const paramlimits_t *ptr = (const paramlimits_t*)pgm_read_ptr(&_params[index]._limits);
 
-    if (value) {
-      uint16_t parsize = pgm_read_word(&_params[i]._size);
+    if (ptr) {
+      memcpy_P(&limits, ptr, sizeof(paramlimits_t));
+      return true;
+    }
+  }
 
-      if (parsize) {
-        paramtype_t partype = (paramtype_t)pgm_read_byte(&_params[i]._type);
+  return false;
+}
 
-        if ((partype == PAR_STR) || (partype == PAR_PSWD)) {
-          memset(value, 0, parsize);
-          if (pgm_read_ptr(&_params[i]._default.asstr))
-            strncpy_P((char*)value, (PGM_P)pgm_read_ptr(&_params[i]._default.asstr), parsize - 1);
-        } else {
-          memcpy_P(value, &_params[i]._default, parsize);
+paramerror_t BaseConfig::checkParam(uint8_t index, const void *value) const {
+  paramlimits_t limits;
+
+  if (! getLimits(index, limits))
+    return PARERR_OK;
+
+  paramtype_t partype = (paramtype_t)pgm_read_byte(&_params[index]._type);
+
+  if (partype == PAR_BOOL)
+    return PARERR_OK;
+  if ((partype == PAR_CHAR) || (partype == PAR_STR) || (partype == PAR_PSWD)) {
+    char str[2];
+    const char *s;
+
+    if (partype == PAR_CHAR) {
+      str[0] = *(const char*)value;
+      str[1] = '\0';
+      s = str;
+    } else
+      s = (const char*)value;
+    if (((! isnan(limits._min)) && (strlen(s) < limits._min)) || ((! isnan(limits._max)) && (strlen(s) > limits._max)))
+      return PARERR_RANGE;
+    if (limits._choices && (! matchChoice_P(s, limits._choices)))
+      return PARERR_CHOICE;
+    if (limits._pattern && (! matchPattern_P(s, limits._pattern)))
+      return PARERR_PATTERN;
+  } else if (partype == PAR_ARRAY) {
+    paramtype_t itemtype = (paramtype_t)pgm_read_byte(&_params[index]._item);
+    uint8_t itemsize = paramItemSize(itemtype);
+    uint16_t parsize = pgm_read_word(&_params[index]._size);
+
+    for (uint16_t pos = 0; pos < parsize; pos += itemsize) { // Limits apply to each item
+      paramerror_t error = checkNumber(limits, itemValue((const uint8_t*)value + pos, itemtype));
+
+      if (error != PARERR_OK)
+        return error;
+    }
+  } else if (partype != PAR_BLOB)
+    return checkNumber(limits, itemValue(value, partype));
+
+  return PARERR_OK;
+}
+
+paramerror_t BaseConfig::checkNumber(const paramlimits_t &limits, double value) {
+  if (((! isnan(limits._min)) && (value < limits._min)) || ((! isnan(limits._max)) && (value > limits._max)))
+    return PARERR_RANGE;
+  if (limits._step > 0) {
+    double steps = (value - (isnan(limits._min) ? 0 : limits._min)) / limits._step;
+
+    if (fabs(steps - round(steps)) > 0.000001)
+      return PARERR_STEP;
+  }
+  if (limits._choices) {
+    PGM_P choices = limits._choices;
+    char c;
+
+    do {
+      char choice[24];
+      uint8_t len = 0;
+
+      while (((c = pgm_read_byte(choices++)) != '\0') && (c != '|')) {
+        if (len < sizeof(choice) - 1)
+          choice[len++] = c;
+      }
+      choice[len] = '\0';
+      if (len && (strtod(choice, NULL) == value))
+        return PARERR_OK;
+    } while (c);
+
+    return PARERR_CHOICE;
+  }
+
+  return PARERR_OK;
+}
+
+bool BaseConfig::setParam(uint8_t index, const char *value) {
+  if (! _updating)
+    require(paramSection(index));
+
+  bool update = (! _updating) && beginUpdate(); // Single param is published on its own
+  bool result = parseParam(index, value) && validateParam(index);
+
+  if (update) {
+    if (result)
+      commitUpdate();
+    else
+      cancelUpdate();
+  }
+
+  return result;
+}
+
+bool BaseConfig::parseParam(uint8_t index, const char *value) {
+  void *ptr = paramPtr(index);
+
+  if (ptr) {
+    uint16_t parsize = pgm_read_word(&_params[index]._size);
+
+    if (parsize) {
+      paramtype_t partype = (paramtype_t)pgm_read_byte(&_params[index]._type);
+      paramerror_t error = PARERR_OK;
+
+      if (partype <= PAR_FLOAT) {
+        error = parseItem(ptr, partype, value);
+      } else if (partype == PAR_CHAR) {
+        *(char*)ptr = *value;
+      } else if (partype == PAR_STR) {
+        memset(ptr, 0, parsize);
+        strncpy((char*)ptr, value, parsize - 1);
+      } else if (partype == PAR_PSWD) {
+        return setPassword(index, value, strlen(value));
+      } else if (partype == PAR_ARRAY) { // Comma separated items, optionally in brackets
+        paramtype_t itemtype = (paramtype_t)pgm_read_byte(&_params[index]._item);
+        uint8_t itemsize = paramItemSize(itemtype);
+        uint16_t count = 0;
+        char item[24];
+
+        memset(ptr, 0, parsize);
+        while ((*value == ' ') || (*value == '['))
+          ++value;
+        while (*value && (*value != ']') && (error == PARERR_OK)) {
+          uint8_t len = 0;
+
+          while (*value && (*value != ',') && (*value != ']')) {
+            if ((*value != ' ') && (len < sizeof(item) - 1))
+              item[len++] = *value;
+            ++value;
+          }
+          item[len] = '\0';
+          if (*value == ',')
+            ++value;
+          if ((count + 1) * itemsize > parsize)
+            error = PARERR_RANGE;
+          else
+            error = parseItem((uint8_t*)ptr + count++ * itemsize, itemtype, item);
         }
+      } else if (partype == PAR_BLOB) {
+        memset(ptr, 0, parsize);
+        if (base64Decode((uint8_t*)ptr, parsize, value) < 0)
+          error = PARERR_FORMAT;
       }
+      if (error != PARERR_OK)
+        return paramError(index, error);
+
+      return true;
     }
   }
+
+  return false;
+}
+
+paramerror_t BaseConfig::parseItem(void *ptr, paramtype_t type, const char *value) {
+  if (type == PAR_BOOL) {
+    *(bool*)ptr = (! strcmp_P(value, PSTR("1"))) || (! strcasecmp_P(value, PSTR("true"))) || (! strcasecmp_P(value, PSTR("on")));
+  } else if ((type >= PAR_I8) && (type <= PAR_UI32)) {
+    char *end;
+    int64_t v = strtoll(value, &end, 10);
+
+    if ((end == value) || *end)
+      return PARERR_FORMAT;
+    if (! setInt(ptr, type, v))
+      return PARERR_RANGE;
+  } else if (type == PAR_FLOAT) {
+    char *end;
+    float v = strtod(value, &end);
+
+    if ((end == value) || *end)
+      return PARERR_FORMAT;
+    *(float*)ptr = v;
+  } else
+    return PARERR_FORMAT;
+
+  return PARERR_OK;
+}
+
+paramerror_t BaseConfig::setItem(void *ptr, paramtype_t type, const mpvalue_t &value) {
+  if (type == PAR_BOOL) {
+    if ((value.kind == mpvalue_t::MP_NIL) || (value.kind >= mpvalue_t::MP_STR))
+      return PARERR_FORMAT;
+    *(bool*)ptr = (value.kind == mpvalue_t::MP_FLOAT) ? (value.f != 0) : (value.i != 0);
+  } else if ((type >= PAR_I8) && (type <= PAR_UI32)) {
+    if ((value.kind != mpvalue_t::MP_INT) && (value.kind != mpvalue_t::MP_BOOL))
+      return PARERR_FORMAT;
+    if (! setInt(ptr, type, value.i))
+      return PARERR_RANGE;
+  } else if (type == PAR_FLOAT) {
+    if ((value.kind == mpvalue_t::MP_NIL) || (value.kind >= mpvalue_t::MP_STR))
+      return PARERR_FORMAT;
+    *(float*)ptr = (value.kind == mpvalue_t::MP_FLOAT) ? value.f : value.i;
+  } else
+    return PARERR_FORMAT;
+
+  return PARERR_OK;
+}
+
+double BaseConfig::itemValue(const void *ptr, paramtype_t type) {
+  if (type == PAR_BOOL)
+    return *(const bool*)ptr;
+  if (type == PAR_I8)
+    return *(const int8_t*)ptr;
+  if (type == PAR_UI8)
+    return *(const uint8_t*)ptr;
+  if (type == PAR_I16)
+    return *(const int16_t*)ptr;
+  if (type == PAR_UI16)
+    return *(const uint16_t*)ptr;
+  if (type == PAR_I32)
+    return *(const int32_t*)ptr;
+  if (type == PAR_UI32)
+    return *(const uint32_t*)ptr;
+
+  return *(const float*)ptr;
+}
+
+uint8_t BaseConfig::sectionCount() const {
+  return _sectionCount ? _sectionCount : 1;
+}
+
+PGM_P BaseConfig::sectionName(uint8_t section) const {
+  if (section < _sectionCount) {
+    return (PGM_P)pgm_read_ptr(&_sections[section]._name);
+  }
+
+  return NULL;
+}
+
+uint8_t BaseConfig::findSection(const char *name) const {
+  for (uint8_t i = 0; i < _sectionCount; ++i) {
+    if (! strcmp_P(name, sectionName(i)))
+      return i;
+  }
+
+  return ERR_INDEX;
+}
+
+uint8_t BaseConfig::paramSection(uint8_t index) const {
+  uint16_t next = 0;
+
+  for (uint8_t i = 0; i < _sectionCount; ++i) {
+    next += pgm_read_byte(&_sections[i]._count);
+    if (index < next)
+      return i;
+  }
+
+  return _sectionCount ? _sectionCount - 1 : 0;
+}
+
+bool BaseConfig::sectionRange(uint8_t section, uint8_t &first, uint8_t &count) const {
+  first = 0;
+  count = _paramCount;
+  if (section == ERR_INDEX) // All params
+    return true;
+  if (! _sectionCount)
+    return (section == 0);
+  if (section >= _sectionCount)
+    return false;
+  for (uint8_t i = 0; i < section; ++i) {
+    first += pgm_read_byte(&_sections[i]._count);
+  }
+  count = pgm_read_byte(&_sections[section]._count);
+
+  return true;
+}
+
+String BaseConfig::sectionFile(uint8_t section) const {
+  if ((! section) || (section >= _sectionCount))
+    return FPSTR(CONFIG_FILE_NAME);
+
+  String result = FPSTR(CONFIG_SECTION_PREFIX);
+
+  result += FPSTR(sectionName(section));
+  result += FPSTR(CONFIG_SECTION_EXT);
+
+  return result;
+}
+
+bool BaseConfig::require(uint8_t section) {
+  if (section >= sectionCount())
+    return false;
+  if (isLoaded(section))
+    return true;
+
+  return load(section);
+}
+
+bool BaseConfig::requireAll() {
+  bool result = true;
+
+  for (uint8_t i = 0; i < sectionCount(); ++i) {
+    if (! require(i))
+      result = false;
+  }
+
+  return result;
+}
+
+void BaseConfig::setSchema(uint16_t version, const parammigration_t *migrations, uint8_t migrationCount) {
+  _schema = version;
+  _migrations = (parammigration_t*)migrations;
+  _migrationCount = migrationCount;
+}
+
+void BaseConfig::clear() {
+  bool update = (! _updating) && beginUpdate();
+
+  for (uint8_t i = 0; i < _paramCount; ++i) {
+    setDefault(i);
+  }
+  if (update)
+    commitUpdate();
+  _loaded = (1 << sectionCount()) - 1;
+  _dirty = _loaded;
 }
 
 bool BaseConfig::load() {
+  bool result = true;
+
+  for (uint8_t i = 0; i < sectionCount(); ++i) {
+    if (! load(i))
+      result = false;
+  }
+
+  return result;
+}
+
+bool BaseConfig::load(uint8_t section) {
+  uint8_t first, count;
+
+  if (! sectionRange(section, first, count))
+    return false;
+
   char mode[2];
 
   mode[0] = 'r';
   mode[1] = '\0';
 
-  File file = SPIFFS.open(FPSTR(CONFIG_FILE_NAME), mode);
+  String fileName = sectionFile(section);
+  bool legacy = false;
+  uint16_t dirty = _dirty;
 
-  if (file) {
-    DynamicJsonDocument jsonDoc(JSON_BUF_SIZE);
-    DeserializationError error = deserializeJson(jsonDoc, file);
+  if (section && (! SPIFFS.exists(fileName))) { // Not yet moved out of single config file
+    fileName = FPSTR(CONFIG_FILE_NAME);
+    legacy = true;
+  }
+  _loaded |= (1 << section); // Not retried on failure
+  if (SPIFFS.exists(fileName)) {
+    File file = SPIFFS.open(fileName, mode);
 
-    file.close();
-    if (! error) {
-      read(jsonDoc);
+    if (file) {
+      ConfigParser parser(this, false, section);
 
-      return true;
+      parser.parse(file);
+      file.close();
+      if (parser.finish()) {
+        _dirty = dirty;
+        if (legacy || parser.migrating())
+          _dirty |= (1 << section); // Written to own file or with current schema on next save
+        return true;
+      }
     }
   }
 
+  bool update = (! _updating) && beginUpdate();
+
+  for (uint8_t i = first; i < first + count; ++i) {
+    setDefault(i);
+  }
+  if (update)
+    commitUpdate();
+  _dirty = dirty;
+
   return false;
 }
 
 bool BaseConfig::save() {
+  METRIC_SCOPE(MET_CONFIG_SAVE);
+
+  for (uint8_t i = 1; i < _sectionCount; ++i) { // Move sections out of single config file before it is rewritten
+    if ((! isLoaded(i)) && (! SPIFFS.exists(sectionFile(i))))
+      load(i);
+  }
+
+  bool result = true;
+
+  for (uint8_t i = 0; i < sectionCount(); ++i) {
+    if ((_dirty >> i) & 1) {
+      if (saveSection(i))
+        _dirty &= ~(1 << i);
+      else
+        result = false;
+    }
+  }
+
+  return result;
+}
+
+bool BaseConfig::saveSection(uint8_t section) {
+  uint8_t first, count;
+
+  if (! sectionRange(section, first, count))
+    return false;
+
+  JsonDocument *jsonDoc = getJsonDoc();
+
+  if (! jsonDoc)
+    return false;
+
   char mode[2];
 
   mode[0] = 'w';
   mode[1] = '\0';
 
-  File file = SPIFFS.open(FPSTR(CONFIG_FILE_NAME), mode);
+  File file = SPIFFS.open(sectionFile(section), mode);
+  bool result = false;
 
   if (file) {
-    DynamicJsonDocument jsonDoc(JSON_BUF_SIZE);
-
-    write(jsonDoc);
-    serializeJson(jsonDoc, file);
+    write(*jsonDoc, first, count);
+    serializeJson(*jsonDoc, file);
     file.close();
-
-    return true;
+    result = true;
   }
+  jsonDoc->clear();
 
-  return false;
+  return result;
 }
 
 String BaseConfig::toString() {
   String result;
-  DynamicJsonDocument jsonDoc(JSON_BUF_SIZE);
+  JsonDocument *jsonDoc = getJsonDoc();
 
-  write(jsonDoc);
-  serializeJsonPretty(jsonDoc, result);
+  if (jsonDoc) {
+    requireAll();
+    result.reserve(jsonLength());
+    write(*jsonDoc, 0, _paramCount);
+    serializeJsonPretty(*jsonDoc, result);
+    jsonDoc->clear();
+  }
 
   return result;
 }
 
 bool BaseConfig::fromString(const String &str) {
-  DynamicJsonDocument jsonDoc(JSON_BUF_SIZE);
-  DeserializationError error = deserializeJson(jsonDoc, str);
+  return fromJson(str.c_str(), str.length());
+}
 
-  if (! error) {
-    read(jsonDoc);
+bool BaseConfig::fromJson(const char *json, size_t length, uint8_t section) {
+  ConfigParser parser(this, true, section);
 
-    return true;
+  parser.parse(json, length);
+
+  return parser.finish();
+}
+
+size_t BaseConfig::exportJson(Print &out) {
+  size_t result = 0;
+  JsonDocument *jsonDoc = getJsonDoc();
+
+  if (jsonDoc) {
+    requireAll();
+    write(*jsonDoc, 0, _paramCount);
+    for (uint8_t i = 0; i < _paramCount; ++i) {
+      if ((pgm_read_byte(&_params[i]._type) == PAR_PSWD) && pgm_read_word(&_params[i]._size) && getParamPtr(i) && *(char*)getParamPtr(i))
+        (*jsonDoc)[FPSTR((PGM_P)pgm_read_ptr(&_params[i]._name))] = FPSTR(PSWD_MASK); // Sealed value is useless on other device
+    }
+    result = serializeJson(*jsonDoc, out);
+    jsonDoc->clear();
   }
 
-  return false;
+  return result;
+}
+
+size_t BaseConfig::jsonCapacity() const {
+  size_t result = JSON_OBJECT_SIZE(_paramCount + 1) + sizeof(CONFIG_SCHEMA_KEY); // With schema
+  bool masked = false;
+
+  for (uint8_t i = 0; i < _paramCount; ++i) {
+    paramtype_t partype = (paramtype_t)pgm_read_byte(&_params[i]._type);
+
+    result += strlen_P((PGM_P)pgm_read_ptr(&_params[i]._name)) + 1; // Key is copied from flash
+    if (partype == PAR_STR)
+      result += pgm_read_word(&_params[i]._size);
+    else if (partype == PAR_PSWD) {
+      result += sealedLength(pgm_read_word(&_params[i]._size)) + 1;
+      if (! masked) { // exportJson() adds mask once, identical strings share one copy
+        result += sizeof(PSWD_MASK);
+        masked = true;
+      }
+    } else if (partype == PAR_ARRAY)
+      result += JSON_ARRAY_SIZE(itemCount(i));
+    else if (partype == PAR_BLOB)
+      result += base64Length(pgm_read_word(&_params[i]._size)) + 1;
+  }
+
+  return result + result / 4; // Slack for pool alignment
 }
 
-void BaseConfig::read(const JsonDocument &doc) {
+size_t BaseConfig::jsonLength() const {
+  static const uint8_t WIDTHS[] PROGMEM = { 5, 4, 3, 6, 5, 11, 10, 15, 4, 2, 2, 2, 2 }; // Worst-case value text width, paramtype_t as index
+
+  size_t result = 4; // "{\n" and "}" plus terminator
+
+  if (_schema)
+    result += strlen_P(CONFIG_SCHEMA_KEY) + 8 + 5;
+
   for (uint8_t i = 0; i < _paramCount; ++i) {
+    paramtype_t partype = (paramtype_t)pgm_read_byte(&_params[i]._type);
+
+    result += strlen_P((PGM_P)pgm_read_ptr(&_params[i]._name)) + 8; // Indent, quotes, colon, space, comma and newline
+    result += pgm_read_byte(&WIDTHS[partype]);
+    if (partype == PAR_STR)
+      result += pgm_read_word(&_params[i]._size) - 1;
+    else if (partype == PAR_PSWD)
+      result += sealedLength(pgm_read_word(&_params[i]._size));
+    else if (partype == PAR_ARRAY) // Pretty printed one item per line
+      result += itemCount(i) * (pgm_read_byte(&WIDTHS[pgm_read_byte(&_params[i]._item)]) + 8);
+    else if (partype == PAR_BLOB)
+      result += base64Length(pgm_read_word(&_params[i]._size));
+  }
+
+  return result;
+}
+
+JsonDocument *BaseConfig::getJsonDoc() {
+  if (! _jsonDoc) {
+    _jsonDoc = new DynamicJsonDocument(jsonCapacity());
+    if (_jsonDoc && (! _jsonDoc->capacity())) { // Allocation of memory pool failed
+      delete _jsonDoc;
+      _jsonDoc = NULL;
+    }
+  }
+
+  return _jsonDoc;
+}
+
+size_t BaseConfig::toMsgPack(Print &out, uint8_t section) {
+  uint8_t first, last;
+  uint8_t count = 0;
+  size_t result;
+
+  if (! sectionRange(section, first, last))
+    return 0;
+  if (section == ERR_INDEX)
+    requireAll();
+  else
+    require(section);
+  last += first;
+  for (uint8_t i = first; i < last; ++i) {
+    if (getParamPtr(i) && pgm_read_word(&_params[i]._size))
+      ++count;
+  }
+  if (count < 16)
+    result = out.write((uint8_t)(MP_FIXMAP | count));
+  else
+    result = mpWriteUInt(out, MP_MAP16, count, sizeof(uint16_t));
+  for (uint8_t i = first; i < last; ++i) {
     void *value = getParamPtr(i);
 
     if (value) {
@@ -163,66 +684,1022 @@ void BaseConfig::read(const JsonDocument &doc) {
       if (parsize) {
         paramtype_t partype = (paramtype_t)pgm_read_byte(&_params[i]._type);
         PGM_P parname = (PGM_P)pgm_read_ptr(&_params[i]._name);
+        uint8_t namelen = strlen_P(parname);
 
-        if (doc.containsKey(FPSTR(parname))) {
-          if (partype == PAR_BOOL)
-            *(bool*)value = doc[FPSTR(parname)].as<bool>();
-          else if (partype == PAR_I8)
-            *(int8_t*)value = doc[FPSTR(parname)].as<int8_t>();
-          else if (partype == PAR_UI8)
-            *(uint8_t*)value = doc[FPSTR(parname)].as<uint8_t>();
-          else if (partype == PAR_I16)
-            *(int16_t*)value = doc[FPSTR(parname)].as<int16_t>();
-          else if (partype == PAR_UI16)
-            *(uint16_t*)value = doc[FPSTR(parname)].as<uint16_t>();
-          else if (partype == PAR_I32)
-            *(int32_t*)value = doc[FPSTR(parname)].as<int32_t>();
-          else if (partype == PAR_UI32)
-            *(uint32_t*)value = doc[FPSTR(parname)].as<uint32_t>();
-          else if (partype == PAR_FLOAT)
-            *(float*)value = doc[FPSTR(parname)].as<float>();
-          else if (partype == PAR_CHAR)
-            *(char*)value = doc[FPSTR(parname)].as<char>();
-          else if ((partype == PAR_STR) || (partype == PAR_PSWD)) {
-            memset(value, 0, parsize);
-            strncpy((char*)value, doc[FPSTR(parname)].as<const char*>(), parsize - 1);
-          }
-        } else {
-          if ((partype == PAR_STR) || (partype == PAR_PSWD)) {
-            memset(value, 0, parsize);
-            if (pgm_read_ptr(&_params[i]._default.asstr))
-              strncpy_P((char*)value, (PGM_P)pgm_read_ptr(&_params[i]._default.asstr), parsize - 1);
-          } else {
-            memcpy_P(value, &_params[i]._default, parsize);
+        result += mpWriteStrHeader(out, namelen);
+        for (uint8_t j = 0; j < namelen; ++j) {
+          result += out.write(pgm_read_byte(&parname[j]));
+        }
+        if (partype <= PAR_FLOAT)
+          result += mpWriteItem(out, partype, value);
+        else if (partype == PAR_CHAR) {
+          result += mpWriteStrHeader(out, *(char*)value ? 1 : 0);
+          if (*(char*)value)
+            result += out.write(*(uint8_t*)value);
+        } else if (partype == PAR_PSWD) { // Write-only
+          if (*(char*)value) {
+            uint8_t len = strlen_P(PSWD_MASK);
+
+            result += mpWriteStrHeader(out, len);
+            for (uint8_t j = 0; j < len; ++j) {
+              result += out.write(pgm_read_byte(&PSWD_MASK[j]));
+            }
+          } else
+            result += mpWriteStrHeader(out, 0);
+        } else if (partype == PAR_STR) {
+          uint16_t len = strnlen((char*)value, parsize);
+
+          result += mpWriteStrHeader(out, len);
+          result += out.write((const uint8_t*)value, len);
+        } else if (partype == PAR_ARRAY) { // Items as one contiguous run of typed values
+          paramtype_t itemtype = (paramtype_t)pgm_read_byte(&_params[i]._item);
+          uint8_t itemsize = paramItemSize(itemtype);
+          uint16_t count = parsize / itemsize;
+
+          if (count < 16)
+            result += out.write((uint8_t)(MP_FIXARRAY | count));
+          else
+            result += mpWriteUInt(out, MP_ARRAY16, count, sizeof(uint16_t));
+          for (uint16_t j = 0; j < count; ++j) {
+            result += mpWriteItem(out, itemtype, (uint8_t*)value + j * itemsize);
           }
+        } else if (partype == PAR_BLOB) {
+          if (parsize <= UINT8_MAX)
+            result += mpWriteUInt(out, MP_BIN8, parsize, sizeof(uint8_t));
+          else
+            result += mpWriteUInt(out, MP_BIN16, parsize, sizeof(uint16_t));
+          result += out.write((const uint8_t*)value, parsize);
         }
       }
     }
   }
+
+  return result;
+}
+
+bool BaseConfig::fromMsgPack(const uint8_t *data, size_t size, uint8_t section) {
+  uint8_t first, last;
+
+  if ((! sectionRange(section, first, last)) || (! beginUpdate()))
+    return false;
+  last += first;
+
+  mpreader_t reader = { data, size, 0 };
+  uint8_t seen[32]; // Bitmap of up to 256 parameters
+  uint32_t count;
+  uint8_t code;
+  bool invalid = false;
+
+  memset(seen, 0, sizeof(seen));
+  if (! mpRead(reader, &code, sizeof(code))) {
+    cancelUpdate();
+    return false;
+  }
+  if ((code & 0xF0) == MP_FIXMAP)
+    count = code & 0x0F;
+  else if (code == MP_MAP16)
+    count = mpReadUInt(reader, sizeof(uint16_t));
+  else {
+    cancelUpdate();
+    return false;
+  }
+  while (count--) {
+    mpvalue_t key, value;
+
+    if ((! mpReadValue(reader, key)) || (key.kind != mpvalue_t::MP_STR)) {
+      cancelUpdate();
+      return false;
+    }
+
+    uint8_t index = ERR_INDEX;
+
+    if (key.len < 32) {
+      char name[32];
+
+      memcpy(name, key.str, key.len);
+      name[key.len] = '\0';
+      index = findParam(name);
+    }
+    if ((index < first) || (index >= last)) { // Unknown or from other section
+      if (! mpSkipValue(reader, 0)) {
+        cancelUpdate();
+        return false;
+      }
+    } else {
+      bool valid;
+
+      if (! mpReadValue(reader, value)) {
+        cancelUpdate();
+        return false;
+      }
+      if (value.kind == mpvalue_t::MP_ARRAY) // Malformed items also end up cancelling the update
+        valid = setArray(index, reader, value.len);
+      else
+        valid = setParam(index, value);
+      if (valid)
+        seen[index / 8] |= (1 << (index % 8));
+      else
+        invalid = true; // Continue to report all rejected params
+    }
+  }
+  if (invalid || (reader.pos != reader.size)) { // Staged values are dropped on error
+    cancelUpdate();
+    return false;
+  }
+  for (uint8_t i = first; i < last; ++i) {
+    if (! (seen[i / 8] & (1 << (i % 8))))
+      setDefault(i);
+  }
+  if (! commitUpdate())
+    return false;
+  setLoaded(first, last - first);
+
+  return true;
 }
 
-void BaseConfig::write(JsonDocument &doc) {
+bool BaseConfig::beginUpdate() {
+  if (_updating || (! buildOffsets()))
+    return false;
+  _errors.clear();
+  if (! _staging) {
+    _staging = (uint8_t*)malloc(_offsets[_paramCount] * 2 + 1); // New and previous values
+    if (! _staging)
+      return false;
+  }
   for (uint8_t i = 0; i < _paramCount; ++i) {
-    void *value = getParamPtr(i);
+    uint16_t size = _offsets[i + 1] - _offsets[i];
 
-    if (value) {
-      uint16_t parsize = pgm_read_word(&_params[i]._size);
+    if (size)
+      memcpy(&_staging[_offsets[i]], getParamPtr(i), size);
+  }
+  _updating = true;
 
-      if (parsize) {
-        paramtype_t partype = (paramtype_t)pgm_read_byte(&_params[i]._type);
-        PGM_P parname = (PGM_P)pgm_read_ptr(&_params[i]._name);
+  return true;
+}
 
-        if (partype == PAR_BOOL)
-          doc[FPSTR(parname)] = *(bool*)value;
-        else if (partype == PAR_I8)
-          doc[FPSTR(parname)] = *(int8_t*)value;
-        else if (partype == PAR_UI8)
-          doc[FPSTR(parname)] = *(uint8_t*)value;
-        else if (partype == PAR_I16)
-          doc[FPSTR(parname)] = *(int16_t*)value;
-        else if (partype == PAR_UI16)
-          doc[FPSTR(parname)] = *(uint16_t*)value;
-        else if (partype == PAR_I32)
+bool BaseConfig::commitUpdate() {
+  if (! _updating)
+    return false;
+
+  uint8_t *prev = &_staging[_offsets[_paramCount]];
+  uint8_t changed[32]; // Bitmap of up to 256 parameters
+
+  memset(changed, 0, sizeof(changed));
+  _updating = false;
+  ++_generation; // Readers retry while generation is odd
+  __sync_synchronize();
+  for (uint8_t i = 0; i < _paramCount; ++i) {
+    uint16_t size = _offsets[i + 1] - _offsets[i];
+
+    if (size) {
+      void *value = getParamPtr(i);
+
+      if (memcmp(value, &_staging[_offsets[i]], size)) {
+        memcpy(&prev[_offsets[i]], value, size);
+        memcpy(value, &_staging[_offsets[i]], size);
+        changed[i / 8] |= (1 << (i % 8));
+        _dirty |= (1 << paramSection(i));
+      }
+    }
+  }
+  __sync_synchronize();
+  ++_generation;
+  for (uint8_t i = 0; i < _paramCount; ++i) {
+    if (changed[i / 8] & (1 << (i % 8)))
+      paramChanged(i, &prev[_offsets[i]], getParamPtr(i));
+  }
+
+  return true;
+}
+
+void BaseConfig::cancelUpdate() {
+  _updating = false;
+}
+
+bool BaseConfig::readParam(uint8_t index, void *dest, uint32_t *generation) {
+  if ((index >= _paramCount) || (! buildOffsets()))
+    return false;
+
+  uint16_t size = _offsets[index + 1] - _offsets[index];
+
+  if (! size)
+    return false;
+
+  const void *value = getParamPtr(index);
+
+  for (uint8_t attempt = 0; attempt < READ_ATTEMPTS; ++attempt) { // Never spin: writer may be the interrupted context
+    uint32_t gen = _generation;
+
+    if (gen & 1)
+      continue;
+    __sync_synchronize();
+    memcpy(dest, value, size);
+    __sync_synchronize();
+    if (_generation == gen) {
+      if (generation)
+        *generation = gen;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+size_t BaseConfig::snapshotSize() {
+  if (! buildOffsets())
+    return 0;
+
+  return _offsets[_paramCount];
+}
+
+bool BaseConfig::snapshot(void *dest, uint32_t *generation) {
+  if (! buildOffsets())
+    return false;
+
+  for (uint8_t attempt = 0; attempt < READ_ATTEMPTS; ++attempt) {
+    uint32_t gen = _generation;
+
+    if (gen & 1)
+      continue;
+    __sync_synchronize();
+    for (uint8_t i = 0; i < _paramCount; ++i) {
+      uint16_t size = _offsets[i + 1] - _offsets[i];
+
+      if (size)
+        memcpy(&((uint8_t*)dest)[_offsets[i]], getParamPtr(i), size);
+    }
+    __sync_synchronize();
+    if (_generation == gen) {
+      if (generation)
+        *generation = gen;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool BaseConfig::restore(const void *src) {
+  if (! beginUpdate())
+    return false;
+  memcpy(_staging, src, _offsets[_paramCount]);
+
+  return commitUpdate();
+}
+
+bool BaseConfig::subscribe(uint8_t index, paramchanged_t callback, void *arg) {
+  if ((index >= _paramCount) || (! callback))
+    return false;
+
+  subscription_t subscription = { callback, arg, NULL, index };
+
+  return _subscriptions.add(subscription) != _subscriptions.ERR_INDEX;
+}
+
+bool BaseConfig::subscribe_P(PGM_P prefix, paramchanged_t callback, void *arg) {
+  if ((! prefix) || (! callback))
+    return false;
+
+  subscription_t subscription = { callback, arg, prefix, ERR_INDEX };
+
+  return _subscriptions.add(subscription) != _subscriptions.ERR_INDEX;
+}
+
+void BaseConfig::unsubscribe(paramchanged_t callback, void *arg) {
+  for (int16_t i = _subscriptions.count() - 1; i >= 0; --i) {
+    if ((_subscriptions[i].callback == callback) && (_subscriptions[i].arg == arg))
+      _subscriptions.remove(i);
+  }
+}
+
+bool BaseConfig::getError(uint8_t i, uint8_t &index, paramerror_t &error) const {
+  if (i < _errors.count()) {
+    index = _errors[i].index;
+    error = _errors[i].error;
+    return true;
+  }
+
+  return false;
+}
+
+PGM_P BaseConfig::errorText(paramerror_t error) {
+  if (error == PARERR_OK)
+    return PSTR("OK");
+  else if (error == PARERR_FORMAT)
+    return PSTR("invalid format");
+  else if (error == PARERR_RANGE)
+    return PSTR("out of range");
+  else if (error == PARERR_STEP)
+    return PSTR("step mismatch");
+  else if (error == PARERR_CHOICE)
+    return PSTR("not allowed");
+
+  return PSTR("pattern mismatch");
+}
+
+void *BaseConfig::paramPtr(uint8_t index) {
+  if (_updating) {
+    if ((index >= _paramCount) || (_offsets[index + 1] == _offsets[index]))
+      return NULL;
+    return &_staging[_offsets[index]];
+  }
+
+  return getParamPtr(index);
+}
+
+void BaseConfig::paramChanged(uint8_t index, const void *oldValue, const void *newValue) {
+  for (uint8_t i = 0; i < _subscriptions.count(); ++i) {
+    const subscription_t &subscription = _subscriptions[i];
+
+    if (subscription.prefix) {
+      if (strncmp_PP(paramName(index), subscription.prefix, strlen_P(subscription.prefix)))
+        continue;
+    } else if (subscription.index != index)
+      continue;
+    subscription.callback(index, oldValue, newValue, subscription.arg);
+  }
+}
+
+bool BaseConfig::validateParam(uint8_t index) {
+  void *value = paramPtr(index);
+
+  if (! value)
+    return false;
+
+  paramerror_t error = checkParam(index, value);
+
+  if (error == PARERR_OK)
+    return true;
+  if (_updating)
+    memcpy(value, getParamPtr(index), pgm_read_word(&_params[index]._size)); // Keep published value
+
+  return paramError(index, error);
+}
+
+bool BaseConfig::paramError(uint8_t index, paramerror_t error) {
+  fielderror_t fielderror = { index, error };
+
+  _errors.add(fielderror); // Silently dropped when full
+
+  return false;
+}
+
+void BaseConfig::setLoaded(uint8_t first, uint8_t count) {
+  for (uint8_t i = 0; i < sectionCount(); ++i) {
+    uint8_t f, c;
+
+    sectionRange(i, f, c);
+    if ((f >= first) && (f + c <= first + count))
+      _loaded |= (1 << i);
+  }
+}
+
+bool BaseConfig::buildOffsets() {
+  if (! _offsets) {
+    _offsets = (uint16_t*)malloc(sizeof(uint16_t) * (_paramCount + 1));
+    if (! _offsets)
+      return false;
+    _offsets[0] = 0;
+    for (uint8_t i = 0; i < _paramCount; ++i) {
+      _offsets[i + 1] = _offsets[i];
+      if (getParamPtr(i))
+        _offsets[i + 1] += pgm_read_word(&_params[i]._size);
+    }
+  }
+
+  return true;
+}
+
+void BaseConfig::setDefault(uint8_t index) {
+  void *value = paramPtr(index);
+
+  if (value) {
+    uint16_t parsize = pgm_read_word(&_params[index]._size);
+
+    if (parsize) {
+      paramtype_t partype = (paramtype_t)pgm_read_byte(&_params[index]._type);
+
+      if ((partype == PAR_STR) || (partype == PAR_PSWD)) {
+        memset(value, 0, parsize);
+        if (pgm_read_ptr(&_params[index]._default.asstr))
+          strncpy_P((char*)value, (PGM_P)pgm_read_ptr(&_params[index]._default.asstr), parsize - 1);
+      } else if ((partype == PAR_ARRAY) || (partype == PAR_BLOB)) {
+        if (pgm_read_ptr(&_params[index]._default.asdata))
+          memcpy_P(value, pgm_read_ptr(&_params[index]._default.asdata), parsize);
+        else
+          memset(value, 0, parsize);
+      } else {
+        memcpy_P(value, &_params[index]._default, parsize);
+      }
+    }
+  }
+}
+
+bool BaseConfig::setParam(uint8_t index, const mpvalue_t &value) {
+  void *ptr = paramPtr(index);
+
+  if (ptr) {
+    uint16_t parsize = pgm_read_word(&_params[index]._size);
+
+    if (parsize) {
+      paramtype_t partype = (paramtype_t)pgm_read_byte(&_params[index]._type);
+      paramerror_t error = PARERR_OK;
+
+      if (value.kind == mpvalue_t::MP_NIL)
+        setDefault(index);
+      else if (partype <= PAR_FLOAT)
+        error = setItem(ptr, partype, value);
+      else if (partype == PAR_CHAR) {
+        if ((value.kind != mpvalue_t::MP_STR) || (value.len > 1))
+          return paramError(index, PARERR_FORMAT);
+        *(char*)ptr = value.len ? *value.str : '\0';
+      } else if ((partype == PAR_STR) || (partype == PAR_PSWD)) {
+        if (value.kind != mpvalue_t::MP_STR)
+          return paramError(index, PARERR_FORMAT);
+        if (partype == PAR_PSWD) {
+          if (! setPassword(index, value.str, value.len))
+            return false;
+        } else {
+          memset(ptr, 0, parsize);
+          memcpy(ptr, value.str, (value.len < parsize) ? value.len : parsize - 1);
+        }
+      } else if (partype == PAR_BLOB) {
+        if (value.kind != mpvalue_t::MP_BIN)
+          return paramError(index, PARERR_FORMAT);
+        if (value.len > parsize)
+          return paramError(index, PARERR_RANGE);
+        memset(ptr, 0, parsize);
+        memcpy(ptr, value.str, value.len);
+      } else
+        error = PARERR_FORMAT; // Arrays are read by setArray()
+      if (error != PARERR_OK)
+        return paramError(index, error);
+
+      return validateParam(index);
+    }
+  }
+
+  return false;
+}
+
+bool BaseConfig::setArray(uint8_t index, mpreader_t &reader, uint16_t count) {
+  void *ptr = paramPtr(index);
+  paramerror_t error = PARERR_OK;
+
+  if ((! ptr) || (pgm_read_byte(&_params[index]._type) != PAR_ARRAY))
+    error = PARERR_FORMAT;
+  else {
+    paramtype_t itemtype = (paramtype_t)pgm_read_byte(&_params[index]._item);
+    uint8_t itemsize = paramItemSize(itemtype);
+    uint16_t parsize = pgm_read_word(&_params[index]._size);
+
+    if (count * itemsize > parsize)
+      error = PARERR_RANGE;
+    else {
+      memset(ptr, 0, parsize);
+      for (uint16_t i = 0; i < count; ++i) {
+        mpvalue_t value;
+
+        if (! mpReadValue(reader, value))
+          return false;
+        if (error == PARERR_OK)
+          error = setItem((uint8_t*)ptr + i * itemsize, itemtype, value);
+      }
+      if (error == PARERR_OK)
+        return validateParam(index);
+      return paramError(index, error);
+    }
+  }
+  while (count--) { // Keep reader in sync
+    if (! mpSkipValue(reader, 1))
+      return false;
+  }
+
+  return paramError(index, error);
+}
+
+uint8_t BaseConfig::migrateName(const char *name, uint16_t version) const {
+  PGM_P current = NULL;
+
+  for (uint8_t i = 0; i < _migrationCount; ++i) {
+    if (pgm_read_word(&_migrations[i]._version) > version) {
+      PGM_P from = (PGM_P)pgm_read_ptr(&_migrations[i]._from);
+
+      if (current ? (! strcasecmp_PP(current, from)) : (! strcasecmp_P(name, from)))
+        current = (PGM_P)pgm_read_ptr(&_migrations[i]._to); // Renamed again by later entries
+    }
+  }
+  if (current)
+    return findParam_P(current);
+
+  return ERR_INDEX;
+}
+
+bool BaseConfig::convertParam(uint8_t index, const char *value) {
+  void *ptr = paramPtr(index);
+
+  if (ptr) {
+    paramtype_t partype = (paramtype_t)pgm_read_byte(&_params[index]._type);
+
+    if (partype > PAR_FLOAT)
+      return parseParam(index, value) && validateParam(index);
+
+    paramerror_t error = convertItem(ptr, partype, value);
+
+    if (error != PARERR_OK)
+      return paramError(index, error);
+
+    return validateParam(index);
+  }
+
+  return false;
+}
+
+paramerror_t BaseConfig::convertItem(void *ptr, paramtype_t type, const char *value) {
+  paramerror_t error = parseItem(ptr, type, value);
+
+  if ((error != PARERR_OK) && (type >= PAR_I8) && (type <= PAR_UI32)) { // Fraction or wider type of older schema
+    static const int32_t RANGES[][2] PROGMEM = { { INT8_MIN, INT8_MAX }, { 0, UINT8_MAX }, { INT16_MIN, INT16_MAX }, { 0, UINT16_MAX },
+      { INT32_MIN, INT32_MAX } }; // (paramtype_t - PAR_I8) as index, PAR_UI32 is clamped below
+
+    char *end;
+    double v = strtod(value, &end);
+
+    if ((end == value) || *end)
+      return PARERR_FORMAT;
+    v = round(v);
+    if (type == PAR_UI32) {
+      if (v < 0)
+        v = 0;
+      else if (v > UINT32_MAX)
+        v = UINT32_MAX;
+    } else {
+      int32_t lo = pgm_read_dword(&RANGES[type - PAR_I8][0]);
+      int32_t hi = pgm_read_dword(&RANGES[type - PAR_I8][1]);
+
+      if (v < lo)
+        v = lo;
+      else if (v > hi)
+        v = hi;
+    }
+    setInt(ptr, type, (int64_t)v);
+    error = PARERR_OK;
+  }
+
+  return error;
+}
+
+static bool chachaPoly(const uint8_t *key, const uint8_t *nonce, PGM_P name, uint8_t *data, size_t len, uint8_t *tag, bool encrypt) {
+  String aad = FPSTR(name); // Binds value to param
+
+#ifdef ESP32
+  mbedtls_chachapoly_context ctx;
+  int err;
+
+  mbedtls_chachapoly_init(&ctx);
+  err = mbedtls_chachapoly_setkey(&ctx, key);
+  if (! err) {
+    if (encrypt)
+      err = mbedtls_chachapoly_encrypt_and_tag(&ctx, len, nonce, (const uint8_t*)aad.c_str(), aad.length(), data, data, tag);
+    else
+      err = mbedtls_chachapoly_auth_decrypt(&ctx, len, nonce, (const uint8_t*)aad.c_str(), aad.length(), tag, data, data);
+  }
+  mbedtls_chachapoly_free(&ctx);
+
+  return ! err;
+#else
+  uint8_t check[16];
+  uint8_t diff = 0;
+
+  br_poly1305_ctmul_run(key, nonce, data, len, aad.c_str(), aad.length(), encrypt ? tag : check, br_chacha20_ct_run, encrypt);
+  if (encrypt)
+    return true;
+  for (uint8_t i = 0; i < sizeof(check); ++i) { // Constant time
+    diff |= check[i] ^ tag[i];
+  }
+  if (diff)
+    memset(data, 0, len);
+
+  return ! diff;
+#endif
+}
+
+void BaseConfig::sealKey(uint8_t *key) {
+  static const char SALT[] PROGMEM = "BaseConfig";
+
+  uint8_t id[8 + sizeof(SALT) - 1];
+
+#ifdef ESP32
+  uint64_t mac = ESP.getEfuseMac();
+
+  memcpy(id, &mac, sizeof(mac));
+#else
+  uint32_t chip = ESP.getChipId();
+  uint32_t flash = ESP.getFlashChipId();
+
+  memcpy(id, &chip, sizeof(chip));
+  memcpy(&id[4], &flash, sizeof(flash));
+#endif
+  memcpy_P(&id[8], SALT, sizeof(SALT) - 1);
+#ifdef ESP32
+  mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), id, sizeof(id), key);
+#else
+  br_sha256_context ctx;
+
+  br_sha256_init(&ctx);
+  br_sha256_update(&ctx, id, sizeof(id));
+  br_sha256_out(&ctx, key);
+#endif
+}
+
+bool BaseConfig::sealPassword(uint8_t index, const char *value, char *sealed) {
+  uint16_t len = pgm_read_word(&_params[index]._size) - 1; // Padded to hide length
+  uint8_t *buf = (uint8_t*)malloc(SEAL_NONCE_SIZE + len + SEAL_TAG_SIZE);
+
+  if (! buf)
+    return false;
+
+  uint8_t key[SEAL_KEY_SIZE];
+  bool result;
+
+#ifdef ESP32
+  esp_fill_random(buf, SEAL_NONCE_SIZE);
+#else
+  ESP.random(buf, SEAL_NONCE_SIZE);
+#endif
+  strncpy((char*)&buf[SEAL_NONCE_SIZE], value, len);
+  sealKey(key);
+  result = chachaPoly(key, buf, (PGM_P)pgm_read_ptr(&_params[index]._name), &buf[SEAL_NONCE_SIZE], len, &buf[SEAL_NONCE_SIZE + len], true);
+  memset(key, 0, sizeof(key));
+  if (result) {
+    strcpy_P(sealed, PSWD_SEALED);
+    base64Encode(&sealed[strlen_P(PSWD_SEALED)], buf, SEAL_NONCE_SIZE + len + SEAL_TAG_SIZE);
+  }
+  free(buf);
+
+  return result;
+}
+
+bool BaseConfig::openPassword(uint8_t index, const char *sealed, char *value) {
+  sealed += strlen_P(PSWD_SEALED);
+
+  size_t size = strlen(sealed) / 4 * 3 + 3;
+  uint8_t *buf = (uint8_t*)malloc(size);
+
+  if (! buf)
+    return false;
+
+  int32_t len = base64Decode(buf, size, sealed) - SEAL_NONCE_SIZE - SEAL_TAG_SIZE;
+  bool result = false;
+
+  if (len >= 0) {
+    uint16_t parsize = pgm_read_word(&_params[index]._size);
+    uint8_t key[SEAL_KEY_SIZE];
+
+    sealKey(key);
+    result = chachaPoly(key, buf, (PGM_P)pgm_read_ptr(&_params[index]._name), &buf[SEAL_NONCE_SIZE], len, &buf[SEAL_NONCE_SIZE + len], false);
+    memset(key, 0, sizeof(key));
+    if (result) {
+      memset(value, 0, parsize);
+      strncpy(value, (char*)&buf[SEAL_NONCE_SIZE], (len < parsize) ? len : parsize - 1); // Param may be resized since sealed
+    }
+    memset(buf, 0, size);
+  }
+  free(buf);
+
+  return result;
+}
+
+bool BaseConfig::setPassword(uint8_t index, const char *value, uint16_t len) {
+  char *ptr = (char*)paramPtr(index);
+  uint16_t parsize = pgm_read_word(&_params[index]._size);
+  uint8_t prefix = strlen_P(PSWD_SEALED);
+
+  if ((len == strlen_P(PSWD_MASK)) && (! strncmp_P(value, PSWD_MASK, len)))
+    return true; // Current value is kept
+  if ((len > prefix) && (! strncmp_P(value, PSWD_SEALED, prefix))) {
+    char *sealed = (char*)malloc(len + 1); // Value of MessagePack is not terminated
+    bool result;
+
+    if (! sealed)
+      return false;
+    memcpy(sealed, value, len);
+    sealed[len] = '\0';
+    result = openPassword(index, sealed, ptr);
+    free(sealed);
+    if (! result)
+      return paramError(index, PARERR_FORMAT); // Other device key or tampered
+
+    return true;
+  }
+  memset(ptr, 0, parsize);
+  memcpy(ptr, value, (len < parsize) ? len : parsize - 1);
+
+  return true;
+}
+
+bool BaseConfig::setInt(void *ptr, paramtype_t partype, int64_t value) {
+  if (partype == PAR_I8) {
+    if ((value < INT8_MIN) || (value > INT8_MAX))
+      return false;
+    *(int8_t*)ptr = value;
+  } else if (partype == PAR_UI8) {
+    if ((value < 0) || (value > UINT8_MAX))
+      return false;
+    *(uint8_t*)ptr = value;
+  } else if (partype == PAR_I16) {
+    if ((value < INT16_MIN) || (value > INT16_MAX))
+      return false;
+    *(int16_t*)ptr = value;
+  } else if (partype == PAR_UI16) {
+    if ((value < 0) || (value > UINT16_MAX))
+      return false;
+    *(uint16_t*)ptr = value;
+  } else if (partype == PAR_I32) {
+    if ((value < INT32_MIN) || (value > INT32_MAX))
+      return false;
+    *(int32_t*)ptr = value;
+  } else if (partype == PAR_UI32) {
+    if ((value < 0) || (value > UINT32_MAX))
+      return false;
+    *(uint32_t*)ptr = value;
+  } else
+    return false;
+
+  return true;
+}
+
+size_t BaseConfig::mpWriteUInt(Print &out, uint8_t code, uint32_t value, uint8_t bytes) {
+  size_t result = out.write(code);
+
+  while (bytes--) {
+    result += out.write((uint8_t)(value >> (bytes * 8)));
+  }
+
+  return result;
+}
+
+size_t BaseConfig::mpWriteInt(Print &out, int32_t value) {
+  if (value >= 0)
+    return mpWriteUnsigned(out, value);
+  if (value >= -32)
+    return out.write((uint8_t)value); // Negative fixint
+  if (value >= INT8_MIN)
+    return mpWriteUInt(out, MP_INT8, value, sizeof(int8_t));
+  if (value >= INT16_MIN)
+    return mpWriteUInt(out, MP_INT16, value, sizeof(int16_t));
+  return mpWriteUInt(out, MP_INT32, value, sizeof(int32_t));
+}
+
+size_t BaseConfig::mpWriteUnsigned(Print &out, uint32_t value) {
+  if (value < 0x80)
+    return out.write((uint8_t)value); // Positive fixint
+  if (value <= UINT8_MAX)
+    return mpWriteUInt(out, MP_UINT8, value, sizeof(uint8_t));
+  if (value <= UINT16_MAX)
+    return mpWriteUInt(out, MP_UINT16, value, sizeof(uint16_t));
+  return mpWriteUInt(out, MP_UINT32, value, sizeof(uint32_t));
+}
+
+size_t BaseConfig::mpWriteStrHeader(Print &out, uint16_t len) {
+  if (len < 32)
+    return out.write((uint8_t)(MP_FIXSTR | len));
+  if (len <= UINT8_MAX)
+    return mpWriteUInt(out, MP_STR8, len, sizeof(uint8_t));
+  return mpWriteUInt(out, MP_STR16, len, sizeof(uint16_t));
+}
+
+size_t BaseConfig::mpWriteItem(Print &out, paramtype_t type, const void *value) {
+  if (type == PAR_BOOL)
+    return out.write(*(const bool*)value ? MP_TRUE : MP_FALSE);
+  if (type == PAR_I8)
+    return mpWriteInt(out, *(const int8_t*)value);
+  if (type == PAR_UI8)
+    return mpWriteUnsigned(out, *(const uint8_t*)value);
+  if (type == PAR_I16)
+    return mpWriteInt(out, *(const int16_t*)value);
+  if (type == PAR_UI16)
+    return mpWriteUnsigned(out, *(const uint16_t*)value);
+  if (type == PAR_I32)
+    return mpWriteInt(out, *(const int32_t*)value);
+  if (type == PAR_UI32)
+    return mpWriteUnsigned(out, *(const uint32_t*)value);
+  if (type == PAR_FLOAT) {
+    uint32_t bits;
+
+    memcpy(&bits, value, sizeof(bits));
+    return mpWriteUInt(out, MP_FLOAT32, bits, sizeof(float));
+  }
+
+  return 0;
+}
+
+bool BaseConfig::mpRead(mpreader_t &reader, void *buf, size_t size) {
+  if (reader.pos + size > reader.size)
+    return false;
+  memcpy(buf, &reader.data[reader.pos], size);
+  reader.pos += size;
+
+  return true;
+}
+
+uint32_t BaseConfig::mpReadUInt(mpreader_t &reader, uint8_t bytes) {
+  uint32_t result = 0;
+  uint8_t b;
+
+  while (bytes--) {
+    if (! mpRead(reader, &b, sizeof(b))) {
+      reader.pos = reader.size + 1; // Mark as broken
+      return 0;
+    }
+    result = (result << 8) | b;
+  }
+
+  return result;
+}
+
+bool BaseConfig::mpReadValue(mpreader_t &reader, mpvalue_t &value) {
+  uint8_t code;
+
+  if (! mpRead(reader, &code, sizeof(code)))
+    return false;
+  value.i = 0;
+  if (code == MP_NIL) {
+    value.kind = mpvalue_t::MP_NIL;
+  } else if ((code == MP_FALSE) || (code == MP_TRUE)) {
+    value.kind = mpvalue_t::MP_BOOL;
+    value.i = (code == MP_TRUE);
+  } else if (code < 0x80) {
+    value.kind = mpvalue_t::MP_INT;
+    value.i = code;
+  } else if (code >= 0xE0) {
+    value.kind = mpvalue_t::MP_INT;
+    value.i = (int8_t)code;
+  } else if ((code >= MP_UINT8) && (code <= MP_UINT32)) {
+    value.kind = mpvalue_t::MP_INT;
+    value.i = mpReadUInt(reader, 1 << (code - MP_UINT8));
+  } else if ((code >= MP_INT8) && (code <= MP_INT32)) {
+    uint8_t bytes = 1 << (code - MP_INT8);
+    uint32_t v = mpReadUInt(reader, bytes);
+
+    value.kind = mpvalue_t::MP_INT;
+    if (bytes == sizeof(int8_t))
+      value.i = (int8_t)v;
+    else if (bytes == sizeof(int16_t))
+      value.i = (int16_t)v;
+    else
+      value.i = (int32_t)v;
+  } else if ((code == MP_UINT64) || (code == MP_INT64)) {
+    uint32_t hi = mpReadUInt(reader, sizeof(uint32_t));
+    uint32_t lo = mpReadUInt(reader, sizeof(uint32_t));
+
+    value.kind = mpvalue_t::MP_INT;
+    value.i = ((int64_t)hi << 32) | lo;
+    if ((code == MP_UINT64) && (value.i < 0))
+      value.i = INT64_MAX; // Out of range for any parameter type
+  } else if (code == MP_FLOAT32) {
+    uint32_t bits = mpReadUInt(reader, sizeof(float));
+
+    value.kind = mpvalue_t::MP_FLOAT;
+    memcpy(&value.f, &bits, sizeof(float));
+  } else if (code == MP_FLOAT64) {
+    uint64_t bits = ((uint64_t)mpReadUInt(reader, sizeof(uint32_t)) << 32);
+    double d;
+
+    bits |= mpReadUInt(reader, sizeof(uint32_t));
+    memcpy(&d, &bits, sizeof(double));
+    value.kind = mpvalue_t::MP_FLOAT;
+    value.f = d;
+  } else if (((code & 0xE0) == MP_FIXSTR) || (code == MP_STR8) || (code == MP_STR16)) {
+    if ((code & 0xE0) == MP_FIXSTR)
+      value.len = code & 0x1F;
+    else
+      value.len = mpReadUInt(reader, (code == MP_STR8) ? sizeof(uint8_t) : sizeof(uint16_t));
+    if (reader.pos + value.len > reader.size)
+      return false;
+    value.kind = mpvalue_t::MP_STR;
+    value.str = (const char*)&reader.data[reader.pos];
+    reader.pos += value.len;
+  } else if ((code == MP_BIN8) || (code == MP_BIN16)) {
+    value.len = mpReadUInt(reader, (code == MP_BIN8) ? sizeof(uint8_t) : sizeof(uint16_t));
+    if (reader.pos + value.len > reader.size)
+      return false;
+    value.kind = mpvalue_t::MP_BIN;
+    value.str = (const char*)&reader.data[reader.pos];
+    reader.pos += value.len;
+  } else if (((code & 0xF0) == MP_FIXARRAY) || (code == MP_ARRAY16)) {
+    value.kind = mpvalue_t::MP_ARRAY;
+    value.len = (code == MP_ARRAY16) ? mpReadUInt(reader, sizeof(uint16_t)) : (code & 0x0F);
+  } else
+    return false;
+
+  return (reader.pos <= reader.size);
+}
+
+bool BaseConfig::mpSkipValue(mpreader_t &reader, uint8_t depth) {
+  uint8_t code;
+  uint32_t count;
+
+  if (depth > 8)
+    return false;
+  if (! mpRead(reader, &code, sizeof(code)))
+    return false;
+  if (((code & 0xF0) == MP_FIXMAP) || ((code & 0xF0) == MP_FIXARRAY) || (code == MP_MAP16) || (code == MP_ARRAY16)) {
+    if ((code == MP_MAP16) || (code == MP_ARRAY16))
+      count = mpReadUInt(reader, sizeof(uint16_t));
+    else
+      count = code & 0x0F;
+    if (((code & 0xF0) == MP_FIXMAP) || (code == MP_MAP16))
+      count *= 2;
+    while (count--) {
+      if (! mpSkipValue(reader, depth + 1))
+        return false;
+    }
+  } else if ((code >= MP_BIN8) && (code <= MP_BIN16)) {
+    reader.pos += mpReadUInt(reader, (code == MP_BIN8) ? sizeof(uint8_t) : sizeof(uint16_t));
+  } else {
+    mpvalue_t value;
+
+    --reader.pos;
+    return mpReadValue(reader, value);
+  }
+
+  return (reader.pos <= reader.size);
+}
+
+uint16_t BaseConfig::nameHash(const char *name, bool progmem) {
+  uint32_t hash = 2166136261UL; // FNV-1a of upper case name
+  char c;
+
+  while ((c = progmem ? pgm_read_byte(name) : *name) != '\0') {
+    hash = (hash ^ (uint8_t)toupper(c)) * 16777619UL;
+    ++name;
+  }
+
+  return (hash >> 16) ^ (hash & 0xFFFF);
+}
+
+bool BaseConfig::buildNameIndex() const {
+  if (! _nameIndex) {
+    _nameIndex = (paramindex_t*)malloc(sizeof(paramindex_t) * _paramCount);
+    if (! _nameIndex)
+      return false;
+    for (uint8_t i = 0; i < _paramCount; ++i) { // Stable insertion sort by hash
+      paramindex_t item;
+      uint8_t j = i;
+
+      item.hash = nameHash((PGM_P)pgm_read_ptr(&_params[i]._name), true);
+      item.index = i;
+      while (j && (_nameIndex[j - 1].hash > item.hash)) {
+        _nameIndex[j] = _nameIndex[j - 1];
+        --j;
+      }
+      _nameIndex[j] = item;
+    }
+  }
+
+  return true;
+}
+
+uint8_t BaseConfig::lowerBound(uint16_t hash) const {
+  uint8_t lo = 0, hi = _paramCount;
+
+  while (lo < hi) {
+    uint8_t mid = (lo + hi) / 2;
+
+    if (_nameIndex[mid].hash < hash)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+void BaseConfig::write(JsonDocument &doc, uint8_t first, uint8_t count) {
+  if (_schema)
+    doc[FPSTR(CONFIG_SCHEMA_KEY)] = _schema;
+  for (uint8_t i = first; i < first + count; ++i) {
+    void *value = getParamPtr(i);
+
+    if (value) {
+      uint16_t parsize = pgm_read_word(&_params[i]._size);
+
+      if (parsize) {
+        paramtype_t partype = (paramtype_t)pgm_read_byte(&_params[i]._type);
+        PGM_P parname = (PGM_P)pgm_read_ptr(&_params[i]._name);
+
+        if (partype == PAR_BOOL)
+          doc[FPSTR(parname)] = *(bool*)value;
+        else if (partype == PAR_I8)
+          doc[FPSTR(parname)] = *(int8_t*)value;
+        else if (partype == PAR_UI8)
+          doc[FPSTR(parname)] = *(uint8_t*)value;
+        else if (partype == PAR_I16)
+          doc[FPSTR(parname)] = *(int16_t*)value;
+        else if (partype == PAR_UI16)
+          doc[FPSTR(parname)] = *(uint16_t*)value;
+        else if (partype == PAR_I32)
           doc[FPSTR(parname)] = *(int32_t*)value;
         else if (partype == PAR_UI32)
           doc[FPSTR(parname)] = *(uint32_t*)value;
@@ -230,8 +1707,44 @@ void BaseConfig::write(JsonDocument &doc) {
           doc[FPSTR(parname)] = *(float*)value;
         else if (partype == PAR_CHAR)
           doc[FPSTR(parname)] = *(char*)value;
-        else if ((partype == PAR_STR) || (partype == PAR_PSWD))
+        else if (partype == PAR_STR)
           doc[FPSTR(parname)] = (char*)value;
+        else if (partype == PAR_PSWD) {
+          if (*(char*)value) {
+            char *sealed = (char*)malloc(sealedLength(parsize) + 1);
+
+            if (sealed) {
+              if (sealPassword(i, (char*)value, sealed))
+                doc[FPSTR(parname)] = sealed; // Not written on failure, never stored in plain text
+              free(sealed);
+            }
+          } else
+            doc[FPSTR(parname)] = (char*)value;
+        } else if (partype == PAR_ARRAY) {
+          paramtype_t itemtype = (paramtype_t)pgm_read_byte(&_params[i]._item);
+          uint8_t itemsize = paramItemSize(itemtype);
+          JsonArray array = doc.createNestedArray(FPSTR(parname));
+
+          for (uint16_t pos = 0; pos < parsize; pos += itemsize) {
+            const uint8_t *item = (const uint8_t*)value + pos;
+
+            if (itemtype == PAR_BOOL)
+              array.add(*(bool*)item);
+            else if (itemtype == PAR_FLOAT)
+              array.add(*(float*)item);
+            else if (itemtype == PAR_UI32)
+              array.add(*(uint32_t*)item);
+            else
+              array.add((int32_t)itemValue(item, itemtype));
+          }
+        } else if (partype == PAR_BLOB) {
+          char *str = (char*)malloc(base64Length(parsize) + 1);
+
+          if (str) {
+            doc[FPSTR(parname)] = base64Encode(str, (const uint8_t*)value, parsize); // Copied to document as char*
+            free(str);
+          }
+        }
       }
     }
   }
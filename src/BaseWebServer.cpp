@@ -1,26 +1,300 @@
 #ifdef ESP32
 #include <SPIFFS.h>
 #include <Update.h>
+#ifdef BUNDLE_KEY
+#include <mbedtls/md.h>
+#endif
 #else
 #include <FS.h>
 #include <WiFiUdp.h>
+#ifdef BUNDLE_KEY
+#include <bearssl/bearssl.h>
+#endif
 #endif
+#include <StreamString.h>
 #include "BaseWebServer.h"
+#include "ConfigParser.h"
 #include "StrUtils.h"
 #include "HtmlHelper.h"
+#include "Metrics.h"
+#include "HeapTrace.h"
+
+#define HTML_CONFIG_PARAM_STR "config"
+static const char HTML_CONFIG_PARAM[] PROGMEM = HTML_CONFIG_PARAM_STR;
+#define HTML_COMPLEX_PARAM_STR "complex"
+static const char HTML_COMPLEX_PARAM[] PROGMEM = HTML_COMPLEX_PARAM_STR;
+static const char HTML_PLAIN_PARAM[] PROGMEM = "plain"; // Raw request body
+static const char HTML_SECTION_PARAM[] PROGMEM = "section";
+
+static const char ACCEPT_HEADER[] PROGMEM = "Accept";
+static const char CONTENT_TYPE_HEADER[] PROGMEM = "Content-Type";
+
+#define JSON_TYPE_PARAM_STR "t"
+static const char JSON_TYPE_PARAM[] PROGMEM = JSON_TYPE_PARAM_STR;
+#define JSON_VALUE_PARAM_STR "v"
+static const char JSON_VALUE_PARAM[] PROGMEM = JSON_VALUE_PARAM_STR;
+#define JSON_DESCR_PARAM_STR "d"
+static const char JSON_DESCR_PARAM[] PROGMEM = JSON_DESCR_PARAM_STR;
+#define JSON_SIZE_PARAM_STR "s"
+static const char JSON_SIZE_PARAM[] PROGMEM = JSON_SIZE_PARAM_STR;
+#define JSON_MIN_PARAM_STR "mn"
+static const char JSON_MIN_PARAM[] PROGMEM = JSON_MIN_PARAM_STR;
+#define JSON_MAX_PARAM_STR "mx"
+static const char JSON_MAX_PARAM[] PROGMEM = JSON_MAX_PARAM_STR;
+#define JSON_STEP_PARAM_STR "st"
+static const char JSON_STEP_PARAM[] PROGMEM = JSON_STEP_PARAM_STR;
+#define JSON_CHOICES_PARAM_STR "c"
+static const char JSON_CHOICES_PARAM[] PROGMEM = JSON_CHOICES_PARAM_STR;
+#define JSON_PATTERN_PARAM_STR "p"
+static const char JSON_PATTERN_PARAM[] PROGMEM = JSON_PATTERN_PARAM_STR;
+#define JSON_ITEM_PARAM_STR "i"
+static const char JSON_ITEM_PARAM[] PROGMEM = JSON_ITEM_PARAM_STR;
+#define JSON_COUNT_PARAM_STR "n"
+static const char JSON_COUNT_PARAM[] PROGMEM = JSON_COUNT_PARAM_STR;
+
+#define JSON_TYPE_BOOL_STR "B"
+#define JSON_TYPE_I8_STR "I1"
+#define JSON_TYPE_UI8_STR "U1"
+#define JSON_TYPE_I16_STR "I2"
+#define JSON_TYPE_UI16_STR "U2"
+#define JSON_TYPE_I32_STR "I4"
+#define JSON_TYPE_UI32_STR "U4"
+#define JSON_TYPE_FLOAT_STR "F"
+#define JSON_TYPE_CHAR_STR "C"
+#define JSON_TYPE_STR_STR "S"
+#define JSON_TYPE_PSWD_STR "P"
+#define JSON_TYPE_ARRAY_STR "A"
+#define JSON_TYPE_BLOB_STR "BL"
+
+static const char JSON_TYPES[][3] PROGMEM = { JSON_TYPE_BOOL_STR, JSON_TYPE_I8_STR, JSON_TYPE_UI8_STR, JSON_TYPE_I16_STR, JSON_TYPE_UI16_STR,
+  JSON_TYPE_I32_STR, JSON_TYPE_UI32_STR, JSON_TYPE_FLOAT_STR, JSON_TYPE_CHAR_STR, JSON_TYPE_STR_STR, JSON_TYPE_PSWD_STR, JSON_TYPE_ARRAY_STR,
+  JSON_TYPE_BLOB_STR }; // paramtype_t as index
+
+#ifdef USE_SSR_SETUP
+#define HTML_FIELDS_PARAM_STR "fields"
+static const char HTML_FIELDS_PARAM[] PROGMEM = HTML_FIELDS_PARAM_STR; // Config posted as separate form fields
+
+static const char HTML_INT_RANGES[][2][12] PROGMEM = { { "-128", "127" }, { "0", "255" }, { "-32768", "32767" }, { "0", "65535" },
+  { "-2147483648", "2147483647" }, { "0", "4294967295" } }; // (paramtype_t - PAR_I8) as index
+#endif
+
+static const char FALSE[] PROGMEM = "false";
+static const char TRUE[] PROGMEM = "true";
 
-static const char HTML_CONFIG_PARAM[] PROGMEM = "config";
-static const char HTML_COMPLEX_PARAM[] PROGMEM = "complex";
+static void printLimit(Print &out, double value, paramtype_t partype) {
+  if (partype == PAR_FLOAT)
+    out.print(value, 6);
+  else if (value < 0)
+    out.print((int32_t)value);
+  else
+    out.print((uint32_t)value); // Integer or string length
+}
 
-static const char JSON_TYPE_PARAM[] PROGMEM = "t";
-static const char JSON_VALUE_PARAM[] PROGMEM = "v";
-static const char JSON_DESCR_PARAM[] PROGMEM = "d";
-static const char JSON_SIZE_PARAM[] PROGMEM = "s";
+static void printItem(Print &out, paramtype_t type, const void *value) {
+  if (type == PAR_BOOL)
+    out.print(FPSTR(*(bool*)value ? TRUE : FALSE));
+  else if (type == PAR_I8)
+    out.print((int16_t)*(int8_t*)value);
+  else if (type == PAR_UI8)
+    out.print(*(uint8_t*)value);
+  else if (type == PAR_I16)
+    out.print(*(int16_t*)value);
+  else if (type == PAR_UI16)
+    out.print(*(uint16_t*)value);
+  else if (type == PAR_I32)
+    out.print(*(int32_t*)value);
+  else if (type == PAR_UI32)
+    out.print(*(uint32_t*)value);
+  else if (type == PAR_FLOAT)
+    out.print(*(float*)value, 6);
+}
 
-static const char JSON_TYPES[][3] PROGMEM = { "B", "I1", "U1", "I2", "U2", "I4", "U4", "F", "C", "S", "P" }; // paramtype_t as index
+static void printArray(Print &out, const BaseConfig *config, uint8_t index, const void *value) { // Comma separated items without brackets
+  paramtype_t itemtype = config->itemType(index);
+  uint8_t itemsize = paramItemSize(itemtype);
 
-static const char FALSE[] PROGMEM = "false";
-static const char TRUE[] PROGMEM = "true";
+  for (uint16_t i = 0; i < config->itemCount(index); ++i) {
+    if (i)
+      out.print(',');
+    printItem(out, itemtype, (const uint8_t*)value + i * itemsize);
+  }
+}
+
+static void printBase64(Print &out, const void *data, uint16_t size) {
+  char buf[65]; // 48 bytes per chunk keeps output free of inner padding
+
+  while (size) {
+    uint16_t len = size < 48 ? size : 48;
+
+    out.print(base64Encode(buf, (const uint8_t*)data, len));
+    data = (const uint8_t*)data + len;
+    size -= len;
+  }
+}
+
+#ifdef BUNDLE_KEY
+static const char BUNDLE_MAGIC[] PROGMEM = "ESPBUNDLE 1";
+static const char BUNDLE_CONFIG[] PROGMEM = "config";
+static const char BUNDLE_FILE[] PROGMEM = "file ";
+static const char BUNDLE_SIG[] PROGMEM = "sig ";
+static const char BUNDLE_TEMP[] PROGMEM = "/bundle.tmp"; // Uploaded bundle until signature is checked
+static const uint8_t BUNDLE_FILES = 32; // Max files in imported bundle
+
+static const uint8_t BUNDLE_LINE = 48; // Bytes of file per base64 line
+
+static String bundleStaged(uint8_t index) { // Imported file until whole bundle is applied
+  String result = FPSTR(BUNDLE_TEMP);
+
+  result += index;
+
+  return result;
+}
+
+class BundleSigner { // HMAC-SHA256 with BUNDLE_KEY over all lines before signature
+public:
+  BundleSigner() {
+#ifdef ESP32
+    mbedtls_md_init(&_ctx);
+    mbedtls_md_setup(&_ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
+    mbedtls_md_hmac_starts(&_ctx, (const uint8_t*)BUNDLE_KEY, strlen(BUNDLE_KEY));
+#else
+    br_hmac_key_init(&_key, &br_sha256_vtable, BUNDLE_KEY, strlen(BUNDLE_KEY));
+    br_hmac_init(&_ctx, &_key, 0);
+#endif
+  }
+  ~BundleSigner() {
+#ifdef ESP32
+    mbedtls_md_free(&_ctx);
+#endif
+  }
+
+  void update(const String &line) {
+#ifdef ESP32
+    mbedtls_md_hmac_update(&_ctx, (const uint8_t*)line.c_str(), line.length());
+#else
+    br_hmac_update(&_ctx, line.c_str(), line.length());
+#endif
+  }
+  String signature() {
+    uint8_t mac[32];
+    char hex[3];
+    String result;
+
+#ifdef ESP32
+    mbedtls_md_hmac_finish(&_ctx, mac);
+#else
+    br_hmac_out(&_ctx, mac);
+#endif
+    result.reserve(sizeof(mac) * 2);
+    for (uint8_t i = 0; i < sizeof(mac); ++i) {
+      result += byteToHex(hex, mac[i]);
+    }
+
+    return result;
+  }
+
+protected:
+#ifdef ESP32
+  mbedtls_md_context_t _ctx;
+#else
+  br_hmac_key_context _key;
+  br_hmac_context _ctx;
+#endif
+};
+
+static File bundleFile;
+static size_t bundleFree; // SPIFFS space left for uploaded bundle
+#endif
+
+#ifdef USE_HEAPTRACE
+static bool routed = false; // Request was dispatched to handler while traced
+
+static const char *methodName(HTTPMethod method) {
+  if (method == HTTP_GET)
+    return "GET";
+  if (method == HTTP_POST)
+    return "POST";
+  if (method == HTTP_DELETE)
+    return "DELETE";
+
+  return "OTHER";
+}
+
+#define HANDLE_SCOPE(metric) METRIC_SCOPE(metric); routed = true
+#else
+#define HANDLE_SCOPE(metric) METRIC_SCOPE(metric)
+#endif
+
+class ResponseWriter : public Print { // Collects output into chunks of response sent with CONTENT_LENGTH_UNKNOWN
+public:
+#ifdef ESP32
+  ResponseWriter(WebServer *http) : _http(http), _length(0) {}
+#else
+  ResponseWriter(ESP8266WebServer *http) : _http(http), _length(0) {}
+#endif
+
+  size_t write(uint8_t c) {
+    if (_length >= sizeof(_buffer))
+      send();
+    _buffer[_length++] = c;
+
+    return 1;
+  }
+  size_t write(const uint8_t *buffer, size_t size) {
+    size_t result = size;
+
+    while (size) {
+      size_t len;
+
+      if (_length >= sizeof(_buffer))
+        send();
+      len = sizeof(_buffer) - _length;
+      if (len > size)
+        len = size;
+      memcpy(&_buffer[_length], buffer, len);
+      _length += len;
+      buffer += len;
+      size -= len;
+    }
+
+    return result;
+  }
+  void begin(uint16_t retcode, PGM_P contentType) {
+    _http->setContentLength(CONTENT_LENGTH_UNKNOWN);
+    _http->send(retcode, FPSTR(contentType), String());
+  }
+  void send() {
+    if (_length) {
+      _http->sendContent(_buffer, _length);
+      _length = 0;
+    }
+  }
+  void end() {
+    send();
+    _http->sendContent(String());
+  }
+
+protected:
+#ifdef ESP32
+  WebServer *_http;
+#else
+  ESP8266WebServer *_http;
+#endif
+  uint16_t _length;
+  char _buffer[256];
+};
+
+static void printJson_P(Print &out, PGM_P s) {
+  char c;
+
+  out.print('"');
+  while ((c = pgm_read_byte(s++))) {
+    if ((c == '"') || (c == '\\'))
+      out.print('\\');
+    out.print(c);
+  }
+  out.print('"');
+}
 
 bool BaseWebServer::_setup() {
 #ifdef ESP32
@@ -31,6 +305,9 @@ bool BaseWebServer::_setup() {
   if (! _http)
     return false;
 
+  static const char *HEADERS[] = { "Accept", "Content-Type" }; // Must be in RAM
+
+  _http->collectHeaders(HEADERS, sizeof(HEADERS) / sizeof(HEADERS[0]));
   setupHandles();
   begin();
 
@@ -38,8 +315,22 @@ bool BaseWebServer::_setup() {
 }
 
 void BaseWebServer::_loop() {
+  METRIC_SCOPE(MET_LOOP);
+
   if (_http) {
+#ifdef USE_HEAPTRACE
+    heaptrace_t trace;
+
+    heapTraceBegin(); // Whole request including body callbacks and response
+    _http->handleClient();
+    heapTraceEnd(trace);
+    if (routed) {
+      routed = false;
+      heapTraceRecord(methodName(_http->method()), _http->uri().c_str(), trace);
+    }
+#else
     _http->handleClient();
+#endif
   }
 }
 
@@ -65,20 +356,32 @@ void BaseWebServer::restart() {
 }
 
 void BaseWebServer::setupHandles() {
-  _http->onNotFound([this]() { this->handleNotFound(); });
-  _http->on(FPSTR(CSS_URI), HTTP_GET, [this]() { this->handleCss(); });
-  _http->on(FPSTR(SCRIPT_URI), HTTP_GET, [this]() { this->handleScript(); });
-  _http->on(FPSTR(ROOT_URI), HTTP_GET, [this]() { this->handleRoot(); });
-  _http->on(FPSTR(SETUP_URI), HTTP_GET, [this]() { this->handleSetup(); });
-  _http->on(FPSTR(CONFIG_URI), HTTP_GET, [this]() { this->handleGetConfig(); });
-  _http->on(FPSTR(CONFIG_URI), HTTP_POST, [this]() { this->handleSetConfig(); });
-  _http->on(FPSTR(CONFIG_URI), HTTP_DELETE, [this]() { this->handleClearConfig(); });
-  _http->on(FPSTR(RESTART_URI), HTTP_GET, [this]() { this->handleRestart(); });
-  _http->on(FPSTR(SPIFFS_URI), HTTP_GET, [this]() { this->handleSPIFFS(); });
-  _http->on(FPSTR(SPIFFS_URI), HTTP_POST, [this]() { this->handleFileUploaded(); }, [this]() { this->handleFileUpload(); });
-  _http->on(FPSTR(SPIFFS_URI), HTTP_DELETE, [this]() { this->handleFileDelete(); });
-  _http->on(FPSTR(FWUPDATE_URI), HTTP_GET, [this]() { this->handleFwUpdate(); });
-  _http->on(FPSTR(FWUPDATE_URI), HTTP_POST, [this]() { this->handleSketchUpdated(); }, [this]() { this->handleSketchUpdate(); });
+  _http->onNotFound([this]() { HANDLE_SCOPE(MET_HTTP_NOTFOUND); this->handleNotFound(); });
+  _http->on(FPSTR(CSS_URI), HTTP_GET, [this]() { HANDLE_SCOPE(MET_HTTP_CSS); this->handleCss(); });
+  _http->on(FPSTR(SCRIPT_URI), HTTP_GET, [this]() { HANDLE_SCOPE(MET_HTTP_SCRIPT); this->handleScript(); });
+  _http->on(FPSTR(ROOT_URI), HTTP_GET, [this]() { HANDLE_SCOPE(MET_HTTP_ROOT); this->handleRoot(); });
+  _http->on(FPSTR(SETUP_URI), HTTP_GET, [this]() { HANDLE_SCOPE(MET_HTTP_SETUP); this->handleSetup(); });
+  _http->on(FPSTR(CONFIG_URI), HTTP_GET, [this]() { HANDLE_SCOPE(MET_HTTP_GETCONFIG); this->handleGetConfig(); });
+  _http->on(FPSTR(CONFIG_URI), HTTP_POST, [this]() { HANDLE_SCOPE(MET_HTTP_SETCONFIG); this->handleSetConfig(); }); // No raw callback, it would swallow url-encoded form body
+  _http->on(FPSTR(API_CONFIG_URI), HTTP_GET, [this]() { HANDLE_SCOPE(MET_HTTP_API_GETCONFIG); this->handleGetConfig(); });
+  _http->on(FPSTR(API_CONFIG_URI), HTTP_POST, [this]() { HANDLE_SCOPE(MET_HTTP_API_SETCONFIG); this->handleSetConfig(); }, [this]() { this->handleConfigBody(); });
+  _http->on(FPSTR(CONFIG_URI), HTTP_DELETE, [this]() { HANDLE_SCOPE(MET_HTTP_CLEARCONFIG); this->handleClearConfig(); });
+  _http->on(FPSTR(RESTART_URI), HTTP_GET, [this]() { HANDLE_SCOPE(MET_HTTP_RESTART); this->handleRestart(); });
+  _http->on(FPSTR(SPIFFS_URI), HTTP_GET, [this]() { HANDLE_SCOPE(MET_HTTP_SPIFFS); this->handleSPIFFS(); });
+  _http->on(FPSTR(SPIFFS_URI), HTTP_POST, [this]() { HANDLE_SCOPE(MET_HTTP_UPLOAD); this->handleFileUploaded(); }, [this]() { this->handleFileUpload(); });
+  _http->on(FPSTR(SPIFFS_URI), HTTP_DELETE, [this]() { HANDLE_SCOPE(MET_HTTP_DELETE); this->handleFileDelete(); });
+  _http->on(FPSTR(FWUPDATE_URI), HTTP_GET, [this]() { HANDLE_SCOPE(MET_HTTP_FWUPDATE); this->handleFwUpdate(); });
+  _http->on(FPSTR(FWUPDATE_URI), HTTP_POST, [this]() { HANDLE_SCOPE(MET_HTTP_SKETCHUPDATE); this->handleSketchUpdated(); }, [this]() { this->handleSketchUpdate(); });
+#ifdef BUNDLE_KEY
+  _http->on(FPSTR(BUNDLE_URI), HTTP_GET, [this]() { HANDLE_SCOPE(MET_HTTP_EXPORT); this->handleExport(); });
+  _http->on(FPSTR(BUNDLE_URI), HTTP_POST, [this]() { HANDLE_SCOPE(MET_HTTP_IMPORT); this->handleImport(); }, [this]() { this->handleBundleBody(); });
+#endif
+#ifdef USE_METRICS
+  _http->on(FPSTR(METRICS_URI), HTTP_GET, [this]() { HANDLE_SCOPE(MET_HTTP_METRICS); this->handleMetrics(); });
+#endif
+#ifdef USE_HEAPTRACE
+  _http->on(FPSTR(HEAPTRACE_URI), HTTP_GET, [this]() { HANDLE_SCOPE(MET_HTTP_HEAPTRACE); this->handleHeapTrace(); });
+#endif
 }
 
 void BaseWebServer::handleNotFound() {
@@ -118,202 +421,170 @@ void BaseWebServer::handleScript() {
     "}\n"
     "return xmlhttp;\n"
     "}\n"
-    "function urlGet(url){\n"
+    "function urlRequest(method,url,payload,callback){\n"
     "var request=getXmlHttpRequest();\n"
-    "request.open('GET',url,false);\n"
-    "request.send(null);\n"
-    "if(request.status==200)\n"
-    "return request.responseText;\n"
-    "return null;\n"
+    "var async=typeof callback=='function';\n"
+    "request.open(method,url,async);\n"
+    "if(async){\n"
+    "request.onreadystatechange=function(){\n"
+    "if(request.readyState==4)\n"
+    "callback(request.status==200?request.responseText:null,request.status);\n"
+    "};\n"
     "}\n"
-    "function urlPost(url,payload){\n"
-    "var request=getXmlHttpRequest();\n"
-    "request.open('POST',url,false);\n"
     "request.send(payload);\n"
+    "if(!async){\n"
     "if(request.status==200)\n"
     "return request.responseText;\n"
     "return null;\n"
     "}\n"
-    "function urlDelete(url){\n"
-    "var request=getXmlHttpRequest();\n"
-    "request.open('DELETE',url,false);\n"
-    "request.send(null);\n"
-    "if(request.status==200)\n"
-    "return request.responseText;\n"
-    "return null;\n"
+    "}\n"
+    "function urlGet(url,callback){\n"
+    "return urlRequest('GET',url,null,callback);\n"
+    "}\n"
+    "function urlPost(url,payload,callback){\n"
+    "return urlRequest('POST',url,payload,callback);\n"
+    "}\n"
+    "function urlDelete(url,payload,callback){\n"
+    "return urlRequest('DELETE',url,payload,callback);\n"
     "}"));
 }
 
 void BaseWebServer::handleRoot() {
+  static const char PAGE[] PROGMEM = HTML_PAGE_START_STR
+    HTML_TITLE_STR("Web Application")
+    "{{css}}"
+    HTML_HEAD_END_STR
+    HTML_BODY_START_STR
+    "<button onclick=\"location.href='" SETUP_URI_STR "'\">Setup</button>\n"
+    "<button onclick=\"location.href='" RESTART_URI_STR "'\">Restart!</button>\n"
+    HTML_PAGE_END_STR;
+
   if (! beforeHandle())
     return;
 
-  String page = FPSTR(HTML_PAGE_START);
-
-  page += tag_P(PSTR("title"), F("Web Application"), true);
-  page += getCss();
-  page += FPSTR(HTML_HEAD_END);
-  page += FPSTR(HTML_BODY_START);
-  page += F("<button onclick=\"location.href='");
-  page += FPSTR(SETUP_URI);
-  page += F("'\">Setup</button>\n"
-    "<button onclick=\"location.href='");
-  page += FPSTR(RESTART_URI);
-  page += F("'\">Restart!</button>\n");
-  page += FPSTR(HTML_PAGE_END);
-  _http->send(200, FPSTR(TEXT_HTML), page);
+  sendTemplate(PAGE);
 }
 
 void BaseWebServer::handleSetup() {
   if (! beforeHandle())
     return;
 
-  static const char ISINT_PARAM[] PROGMEM = "isInt";
-  static const char ISFLOAT_PARAM[] PROGMEM = "isFloat";
-
-  String page = FPSTR(HTML_PAGE_START);
-
-  page += tag_P(PSTR("title"), F("Edit config"), true);
-  page += F("<script type=\"");
-  page += FPSTR(APPLICATION_JAVASCRIPT);
-  page += F("\" src=\"");
-  page += FPSTR(SCRIPT_URI);
-  page += F("\"></script>\n");
-  page += F("<script type=\"");
-  page += FPSTR(APPLICATION_JAVASCRIPT);
-  page += F("\">\n"
+#ifdef USE_SSR_SETUP
+  handleSetupForm();
+#else
+  static const char PAGE[] PROGMEM = HTML_PAGE_START_STR
+    HTML_TITLE_STR("Edit config")
+    "<script type=\"" APPLICATION_JAVASCRIPT_STR "\" src=\"" SCRIPT_URI_STR "\"></script>\n"
+    "<script type=\"" APPLICATION_JAVASCRIPT_STR "\">\n"
     "function load(form){\n"
+    "urlGet('" CONFIG_URI_STR "?" HTML_COMPLEX_PARAM_STR "&dummy='+Date.now(),function(text){\n"
     "try{\n"
-    "var config=JSON.parse(urlGet('");
-  page += FPSTR(CONFIG_URI);
-  page += '?';
-  page += FPSTR(HTML_COMPLEX_PARAM);
-  page += F("&dummy='+Date.now()));\n"
+    "if(text===null)\n"
+    "throw new Error('Config not loaded');\n"
+    "var config=JSON.parse(text);\n"
     "var table, tr, td, elem;\n"
     "table=document.getElementById('table');\n"
     "for(var name in config){\n"
     "tr=table.insertRow(-1);\n"
     "td=tr.insertCell(0);\n"
     "td.align='right';\n"
-    "if(config[name].");
-  page += FPSTR(JSON_DESCR_PARAM);
-  page += F(")\n"
-    "elem=document.createTextNode(config[name].");
-  page += FPSTR(JSON_DESCR_PARAM);
-  page += F(");\n"
+    "if(config[name]." JSON_DESCR_PARAM_STR ")\n"
+    "elem=document.createTextNode(config[name]." JSON_DESCR_PARAM_STR ");\n"
     "else\n"
     "elem=document.createTextNode(name);\n"
     "td.appendChild(elem);\n"
     "td=tr.insertCell(1);\n"
     "elem=document.createElement('input');\n"
     "elem.name=name;\n"
-    "if(config[name].");
-  page += FPSTR(JSON_TYPE_PARAM);
-  page += F("=='");
-  page += FPSTR(JSON_TYPES[PAR_BOOL]);
-  page += F("'){\n"
+    "if(config[name]." JSON_TYPE_PARAM_STR "=='" JSON_TYPE_BOOL_STR "'){\n"
     "elem.type='checkbox';\n"
-    "elem.checked=config[name].");
-  page += FPSTR(JSON_VALUE_PARAM);
-  page += F(";\n"
-    "}else if(config[name].");
-  page += FPSTR(JSON_TYPE_PARAM);
-  page += F("=='");
-  page += FPSTR(JSON_TYPES[PAR_PSWD]);
-  page += F("'){\n"
+    "elem.checked=config[name]." JSON_VALUE_PARAM_STR ";\n"
+    "}else if(config[name]." JSON_TYPE_PARAM_STR "=='" JSON_TYPE_PSWD_STR "'){\n"
     "elem.type='password';\n"
-    "elem.value=config[name].");
-  page += FPSTR(JSON_VALUE_PARAM);
-  page += F(";\n"
-    "elem.size=config[name].");
-  page += FPSTR(JSON_SIZE_PARAM);
-  page += F("-1;\n"
+    "elem.value=config[name]." JSON_VALUE_PARAM_STR ";\n"
+    "elem.size=config[name]." JSON_SIZE_PARAM_STR "-1;\n"
     "elem.maxLength=elem.size;\n"
     "}else{\n"
     "elem.type='text';\n"
-    "elem.value=config[name].");
-  page += FPSTR(JSON_VALUE_PARAM);
-  page += F(";\n"
-    "switch(config[name].");
-  page += FPSTR(JSON_TYPE_PARAM);
-  page += F("){\n"
-    "case '");
-  page += FPSTR(JSON_TYPES[PAR_FLOAT]);
-  page += F("':\n"
+    "elem.value=config[name]." JSON_VALUE_PARAM_STR ";\n"
+    "switch(config[name]." JSON_TYPE_PARAM_STR "){\n"
+    "case '" JSON_TYPE_FLOAT_STR "':\n"
     "elem.size=15;\n"
-    "elem.");
-  page += FPSTR(ISFLOAT_PARAM);
-  page += F("=true;\n"
+    "elem.isFloat=true;\n"
     "break;\n"
-    "case '");
-  page += FPSTR(JSON_TYPES[PAR_I8]);
-  page += F("':\n"
+    "case '" JSON_TYPE_I8_STR "':\n"
     "elem.size=4;\n"
-    "elem.");
-  page += FPSTR(ISINT_PARAM);
-  page += F("=true;\n"
+    "elem.isInt=true;\n"
     "break;\n"
-    "case '");
-  page += FPSTR(JSON_TYPES[PAR_UI8]);
-  page += F("':\n"
+    "case '" JSON_TYPE_UI8_STR "':\n"
     "elem.size=3;\n"
-    "elem.");
-  page += FPSTR(ISINT_PARAM);
-  page += F("=true;\n"
+    "elem.isInt=true;\n"
     "break;\n"
-    "case '");
-  page += FPSTR(JSON_TYPES[PAR_I16]);
-  page += F("':\n"
+    "case '" JSON_TYPE_I16_STR "':\n"
     "elem.size=6;\n"
-    "elem.");
-  page += FPSTR(ISINT_PARAM);
-  page += F("=true;\n"
+    "elem.isInt=true;\n"
     "break;\n"
-    "case '");
-  page += FPSTR(JSON_TYPES[PAR_UI16]);
-  page += F("':\n"
+    "case '" JSON_TYPE_UI16_STR "':\n"
     "elem.size=5;\n"
-    "elem.");
-  page += FPSTR(ISINT_PARAM);
-  page += F("=true;\n"
+    "elem.isInt=true;\n"
     "break;\n"
-    "case '");
-  page += FPSTR(JSON_TYPES[PAR_I32]);
-  page += F("':\n"
+    "case '" JSON_TYPE_I32_STR "':\n"
     "elem.size=11;\n"
-    "elem.");
-  page += FPSTR(ISINT_PARAM);
-  page += F("=true;\n"
+    "elem.isInt=true;\n"
     "break;\n"
-    "case '");
-  page += FPSTR(JSON_TYPES[PAR_UI32]);
-  page += F("':\n"
+    "case '" JSON_TYPE_UI32_STR "':\n"
     "elem.size=10;\n"
-    "elem.");
-  page += FPSTR(ISINT_PARAM);
-  page += F("=true;\n"
+    "elem.isInt=true;\n"
     "break;\n"
-    "case '");
-  page += FPSTR(JSON_TYPES[PAR_CHAR]);
-  page += F("':\n"
+    "case '" JSON_TYPE_CHAR_STR "':\n"
     "elem.size=1;\n"
     "break;\n"
+    "case '" JSON_TYPE_ARRAY_STR "':\n"
+    "elem.value=config[name]." JSON_VALUE_PARAM_STR ".join(',');\n"
+    "elem.size=config[name]." JSON_COUNT_PARAM_STR "*12;\n"
+    "elem.isArray=true;\n"
+    "break;\n"
+    "case '" JSON_TYPE_BLOB_STR "':\n"
+    "elem.size=Math.ceil(config[name]." JSON_SIZE_PARAM_STR "/3)*4;\n"
+    "break;\n"
     "default:\n"
-    "elem.size=config[name].");
-  page += FPSTR(JSON_SIZE_PARAM);
-  page += F("-1;\n"
+    "elem.size=config[name]." JSON_SIZE_PARAM_STR "-1;\n"
     "}\n"
     "elem.maxLength=elem.size;\n"
     "}\n"
+    "var c=config[name];\n"
+    "if((elem.type!='checkbox')&&(!elem.isArray)){\n"
+    "var num=elem.isInt||elem.isFloat;\n"
+    "if(num&&((c." JSON_MIN_PARAM_STR "!==undefined)||(c." JSON_MAX_PARAM_STR "!==undefined))){\n"
+    "elem.type='number';\n"
+    "elem.step=elem.isInt?1:'any';\n"
+    "}\n"
+    "if(c." JSON_MIN_PARAM_STR "!==undefined){\n"
+    "if(num)\n"
+    "elem.min=c." JSON_MIN_PARAM_STR ";\n"
+    "else\n"
+    "elem.minLength=c." JSON_MIN_PARAM_STR ";\n"
+    "}\n"
+    "if(c." JSON_MAX_PARAM_STR "!==undefined){\n"
+    "if(num)\n"
+    "elem.max=c." JSON_MAX_PARAM_STR ";\n"
+    "else\n"
+    "elem.maxLength=c." JSON_MAX_PARAM_STR ";\n"
+    "}\n"
+    "if(c." JSON_STEP_PARAM_STR "!==undefined)\n"
+    "elem.step=c." JSON_STEP_PARAM_STR ";\n"
+    "if(c." JSON_CHOICES_PARAM_STR "!==undefined)\n"
+    "elem.pattern=c." JSON_CHOICES_PARAM_STR ";\n"
+    "if(c." JSON_PATTERN_PARAM_STR "!==undefined)\n"
+    "elem.pattern=c." JSON_PATTERN_PARAM_STR ";\n"
+    "}\n"
     "td.appendChild(elem);\n"
     "}\n"
-    "return true;\n"
     "}catch(e){\n"
     "alert('Exception '+e.name+': '+e.message);\n"
-    "return false;\n"
     "}\n"
+    "});\n"
     "}\n"
-
     "function store(form){\n"
     "try{\n"
     "var config={};\n"
@@ -324,54 +595,182 @@ void BaseWebServer::handleSetup() {
     "if(elements[j].type=='checkbox'){\n"
     "config[elements[j].name]=elements[j].checked;\n"
     "elements[j].disabled=true;\n"
-    "}else if((elements[j].type=='text')||(elements[j].type=='password')){\n"
-    "if(elements[j].");
-  page += FPSTR(ISFLOAT_PARAM);
-  page += F(")\n"
+    "}else if((elements[j].type=='text')||(elements[j].type=='password')||(elements[j].type=='number')){\n"
+    "if(elements[j].isFloat)\n"
     "config[elements[j].name]=parseFloat(elements[j].value);\n"
-    "else if(elements[j].");
-  page += FPSTR(ISINT_PARAM);
-  page += F(")\n"
+    "else if(elements[j].isInt)\n"
     "config[elements[j].name]=parseInt(elements[j].value);\n"
+    "else if(elements[j].isArray)\n"
+    "config[elements[j].name]=JSON.parse('['+elements[j].value+']');\n"
     "else\n"
     "config[elements[j].name]=elements[j].value;\n"
     "elements[j].disabled=true;\n"
     "}\n"
     "}\n"
     "}\n"
-    "form.");
-  page += FPSTR(HTML_CONFIG_PARAM);
-  page += F(".value=JSON.stringify(config);\n"
+    "form." HTML_CONFIG_PARAM_STR ".value=JSON.stringify(config);\n"
     "return true;\n"
     "}catch(e){\n"
     "alert('Exception '+e.name+': '+e.message);\n"
     "return false;\n"
     "}\n"
     "}\n"
-    "</script>\n");
-  page += getCss();
-  page += FPSTR(HTML_HEAD_END);
-  page += F("<body onload=\"load(form)\">\n"
-    "<form name=\"form\" action=\"");
-  page += FPSTR(CONFIG_URI);
-  page += F("\" method=\"POST\" onsubmit=\"store(this)\">\n"
+    "</script>\n"
+    "{{css}}"
+    HTML_HEAD_END_STR
+    "<body onload=\"load(form)\">\n"
+    "<form name=\"form\" action=\"" CONFIG_URI_STR "\" method=\"POST\" onsubmit=\"store(this)\">\n"
     "<b>Configuration:</b>\n"
     "<table id=\"table\" cols=2>\n"
     "</table>\n"
-    "<input type=\"hidden\" name=\"");
-  page += FPSTR(HTML_CONFIG_PARAM);
-  page += F("\">\n"
+    "<input type=\"hidden\" name=\"" HTML_CONFIG_PARAM_STR "\">\n"
     "<input type=\"submit\" value=\"Store\">\n"
-    "<input type=\"button\" value=\"Clear\" onclick=\"if(urlDelete('");
-  page += FPSTR(CONFIG_URI);
-  page += F("')!==null) location.reload()\">\n"
-    "<input type=\"button\" value=\"Restart!\" onclick=\"location.href='");
-  page += FPSTR(RESTART_URI);
-  page += F("'\">\n");
-  page += FPSTR(HTML_PAGE_END);
-  _http->send(200, FPSTR(TEXT_HTML), page);
+    "<input type=\"button\" value=\"Clear\" onclick=\"urlDelete('" CONFIG_URI_STR "',null,function(text){if(text!==null) location.reload();})\">\n"
+    "<input type=\"button\" value=\"Restart!\" onclick=\"location.href='" RESTART_URI_STR "'\">\n"
+    HTML_PAGE_END_STR;
+
+  sendTemplate(PAGE);
+#endif
 }
 
+#ifdef USE_SSR_SETUP
+void BaseWebServer::handleSetupForm() {
+  static const char PAGE_START[] PROGMEM = HTML_PAGE_START_STR
+    HTML_TITLE_STR("Edit config")
+    "<script type=\"" APPLICATION_JAVASCRIPT_STR "\" src=\"" SCRIPT_URI_STR "\"></script>\n"
+    "{{css}}"
+    HTML_HEAD_END_STR
+    HTML_BODY_START_STR
+    "<form name=\"form\" action=\"" CONFIG_URI_STR "\" method=\"POST\">\n"
+    "<b>Configuration:</b>\n"
+    "<table id=\"table\" cols=2>\n";
+  static const char PAGE_END[] PROGMEM = "</table>\n"
+    "<input type=\"hidden\" name=\"" HTML_FIELDS_PARAM_STR "\">\n"
+    "<input type=\"submit\" value=\"Store\">\n"
+    "<input type=\"button\" value=\"Clear\" onclick=\"urlDelete('" CONFIG_URI_STR "',null,function(text){if(text!==null) location.reload();})\">\n"
+    "<input type=\"button\" value=\"Restart!\" onclick=\"location.href='" RESTART_URI_STR "'\">\n"
+    "</form>\n"
+    HTML_PAGE_END_STR;
+
+  ResponseWriter response(_http);
+  HtmlWriter html(response);
+
+  _config->requireAll(); // Store posts every field back, unloaded sections must not show defaults
+
+  response.begin(200, TEXT_HTML);
+  renderTemplate(html, PAGE_START, templateCallback, this);
+
+  for (uint8_t i = 0; i < _config->paramCount(); ++i) {
+    void *value = _config->getParamPtr(i);
+
+    if (value) {
+      uint16_t parsize = _config->paramSize(i);
+
+      if (parsize) {
+        paramtype_t partype = _config->paramType(i);
+        PGM_P descr = _config->paramDescr(i);
+        paramlimits_t limits;
+
+        if (! _config->getLimits(i, limits)) {
+          limits._min = NAN;
+          limits._max = NAN;
+          limits._step = 0;
+          limits._choices = NULL;
+          limits._pattern = NULL;
+        }
+        html.print(F("<tr><td align=\"right\">"));
+        if (descr)
+          html.print(FPSTR(descr));
+        else
+          html.print(FPSTR(_config->paramName(i)));
+        html.print(F("</td><td><input name=\""));
+        html.print(FPSTR(_config->paramName(i)));
+        if (partype == PAR_BOOL) {
+          html.print(F("\" type=\"checkbox\" value=\"1\""));
+          if (*(bool*)value)
+            html.print(F(" checked"));
+        } else {
+          html.print(F("\" type=\""));
+          if ((partype >= PAR_I8) && (partype <= PAR_FLOAT)) {
+            html.print(F("number"));
+            if ((! isnan(limits._min)) || (partype != PAR_FLOAT)) {
+              html.print(F("\" min=\""));
+              if (! isnan(limits._min))
+                printLimit(html, limits._min, partype);
+              else
+                html.print(FPSTR(HTML_INT_RANGES[partype - PAR_I8][0]));
+            }
+            if ((! isnan(limits._max)) || (partype != PAR_FLOAT)) {
+              html.print(F("\" max=\""));
+              if (! isnan(limits._max))
+                printLimit(html, limits._max, partype);
+              else
+                html.print(FPSTR(HTML_INT_RANGES[partype - PAR_I8][1]));
+            }
+            html.print(F("\" step=\""));
+            if (limits._step > 0)
+              printLimit(html, limits._step, PAR_FLOAT);
+            else if (partype != PAR_FLOAT)
+              html.print('1');
+            else
+              html.print(F("any"));
+          } else {
+            if (partype == PAR_PSWD)
+              html.print(F("password"));
+            else
+              html.print(F("text"));
+            if (partype == PAR_ARRAY) // Item limits are checked on submit
+              limits._min = limits._max = NAN;
+            if (! isnan(limits._min)) {
+              html.print(F("\" minlength=\""));
+              printLimit(html, limits._min, partype);
+            }
+            html.print(F("\" maxlength=\""));
+            if (partype == PAR_CHAR)
+              html.print('1');
+            else if (partype == PAR_ARRAY)
+              html.print(_config->itemCount(i) * 12);
+            else if (partype == PAR_BLOB)
+              html.print(base64Length(parsize));
+            else if ((! isnan(limits._max)) && (limits._max < parsize - 1))
+              printLimit(html, limits._max, partype);
+            else
+              html.print(parsize - 1);
+          }
+          if (limits._pattern || limits._choices) {
+            html.print(F("\" pattern=\""));
+            html.escape_P(limits._pattern ? limits._pattern : limits._choices);
+          }
+          html.print(F("\" value=\""));
+          if ((partype >= PAR_I8) && (partype <= PAR_FLOAT))
+            printItem(html, partype, value);
+          else if (partype == PAR_CHAR) {
+            char str[2];
+
+            str[0] = *(char*)value;
+            str[1] = '\0';
+            html.escape(str);
+          } else if (partype == PAR_ARRAY)
+            printArray(html, _config, i, value);
+          else if (partype == PAR_BLOB)
+            printBase64(html, value, parsize);
+          else if (partype == PAR_PSWD) { // Write-only
+            if (*(char*)value)
+              html.print(FPSTR(PSWD_MASK));
+          } else
+            html.escape((char*)value);
+          html.print('"');
+        }
+        html.print(F("></td></tr>\n"));
+      }
+    }
+  }
+
+  renderTemplate(html, PAGE_END);
+  response.end();
+}
+#endif
+
 void BaseWebServer::handleGetConfig() {
   if (! beforeHandle())
     return;
@@ -381,10 +780,34 @@ void BaseWebServer::handleGetConfig() {
   static const char QUOTE_COLON[] PROGMEM = "\":";
   static const char QUOTE_COLON_QUOTE[] PROGMEM = "\":\"";
 
+  uint8_t section, first, count;
+
+  if (! getSection(section)) {
+    _http->send_P(404, TEXT_PLAIN, PSTR("Unknown section!"));
+    return;
+  }
+  if (_http->header(FPSTR(ACCEPT_HEADER)).indexOf(FPSTR(MSGPACK_SUBTYPE)) >= 0) {
+    StreamString body;
+
+    _config->toMsgPack(body, section);
+    _http->send(200, FPSTR(APPLICATION_MSGPACK), body);
+    return;
+  }
+
   bool complex = _http->hasArg(FPSTR(HTML_COMPLEX_PARAM));
-  String page = F("{");
 
-  for (uint8_t i = 0; i < _config->paramCount(); ++i) {
+  if (section == BaseConfig::ERR_INDEX)
+    _config->requireAll();
+  else
+    _config->require(section);
+  _config->sectionRange(section, first, count);
+
+  ResponseWriter json(_http);
+  bool comma = false;
+
+  json.begin(200, APPLICATION_JSON);
+  json.print('{');
+  for (uint8_t i = first; i < first + count; ++i) {
     void *value = _config->getParamPtr(i);
 
     if (value) {
@@ -393,133 +816,367 @@ void BaseWebServer::handleGetConfig() {
       if (parsize) {
         paramtype_t partype = _config->paramType(i);
 
-        if (page.length() > 1) // Not first
-          page += FPSTR(COMMA_QUOTE);
-        else
-          page += '"';
-        page += FPSTR(_config->paramName(i));
-        page += FPSTR(QUOTE_COLON);
+        if (comma)
+          json.print(FPSTR(COMMA_QUOTE));
+        else {
+          json.print('"');
+          comma = true;
+        }
+        json.print(FPSTR(_config->paramName(i)));
+        json.print(FPSTR(QUOTE_COLON));
         if (complex) {
-          page += F("{\"");
-          page += FPSTR(JSON_TYPE_PARAM);
-          page += FPSTR(QUOTE_COLON_QUOTE);
-          page += FPSTR(JSON_TYPES[partype]);
-          page += FPSTR(QUOTE_COMMA_QUOTE);
-          page += FPSTR(JSON_VALUE_PARAM);
-          page += FPSTR(QUOTE_COLON);
+          json.print(F("{\""));
+          json.print(FPSTR(JSON_TYPE_PARAM));
+          json.print(FPSTR(QUOTE_COLON_QUOTE));
+          json.print(FPSTR(JSON_TYPES[partype]));
+          json.print(FPSTR(QUOTE_COMMA_QUOTE));
+          json.print(FPSTR(JSON_VALUE_PARAM));
+          json.print(FPSTR(QUOTE_COLON));
         }
-        if ((partype == PAR_CHAR) || (partype == PAR_STR) || (partype == PAR_PSWD)) {
-          page += '"';
+        if (partype == PAR_ARRAY) {
+          json.print('[');
+          printArray(json, _config, i, value);
+          json.print(']');
+        } else if (partype == PAR_BLOB) {
+          json.print('"');
+          printBase64(json, value, parsize);
+          json.print('"');
+        } else if ((partype == PAR_CHAR) || (partype == PAR_STR) || (partype == PAR_PSWD)) {
+          json.print('"');
           if (partype == PAR_CHAR)
-            page += *(char*)value;
-          else
-            page += (char*)value;
-          page += '"';
-        } else {
-          if (partype == PAR_BOOL) {
-            if (*(bool*)value)
-              page += FPSTR(TRUE);
-            else
-              page += FPSTR(FALSE);
-          } else if (partype == PAR_I8)
-            page += String(*(int8_t*)value);
-          else if (partype == PAR_UI8)
-            page += String(*(uint8_t*)value);
-          else if (partype == PAR_I16)
-            page += String(*(int16_t*)value);
-          else if (partype == PAR_UI16)
-            page += String(*(uint16_t*)value);
-          else if (partype == PAR_I32)
-            page += String(*(int32_t*)value);
-          else if (partype == PAR_UI32)
-            page += String(*(uint32_t*)value);
-          else if (partype == PAR_FLOAT)
-            page += String(*(float*)value);
-        }
+            json.print(*(char*)value);
+          else if (partype == PAR_PSWD) { // Write-only
+            if (*(char*)value)
+              json.print(FPSTR(PSWD_MASK));
+          } else
+            json.print((char*)value);
+          json.print('"');
+        } else if (partype == PAR_FLOAT)
+          json.print(*(float*)value); // Two decimals, unlike array items
+        else
+          printItem(json, partype, value);
         if (complex) {
           PGM_P descr = _config->paramDescr(i);
 
           if (descr) {
-            page += FPSTR(COMMA_QUOTE);
-            page += FPSTR(JSON_DESCR_PARAM);
-            page += FPSTR(QUOTE_COLON_QUOTE);
-            page += FPSTR(descr);
-            page += '"';
+            json.print(FPSTR(COMMA_QUOTE));
+            json.print(FPSTR(JSON_DESCR_PARAM));
+            json.print(FPSTR(QUOTE_COLON_QUOTE));
+            json.print(FPSTR(descr));
+            json.print('"');
           }
-          if ((partype == PAR_STR) || (partype == PAR_PSWD)) {
-            page += FPSTR(COMMA_QUOTE);
-            page += FPSTR(JSON_SIZE_PARAM);
-            page += FPSTR(QUOTE_COLON);
-            page += String(parsize);
+          if ((partype == PAR_STR) || (partype == PAR_PSWD) || (partype == PAR_BLOB)) {
+            json.print(FPSTR(COMMA_QUOTE));
+            json.print(FPSTR(JSON_SIZE_PARAM));
+            json.print(FPSTR(QUOTE_COLON));
+            json.print(parsize);
+          } else if (partype == PAR_ARRAY) {
+            json.print(FPSTR(COMMA_QUOTE));
+            json.print(FPSTR(JSON_ITEM_PARAM));
+            json.print(FPSTR(QUOTE_COLON_QUOTE));
+            json.print(FPSTR(JSON_TYPES[_config->itemType(i)]));
+            json.print(FPSTR(QUOTE_COMMA_QUOTE));
+            json.print(FPSTR(JSON_COUNT_PARAM));
+            json.print(FPSTR(QUOTE_COLON));
+            json.print(_config->itemCount(i));
           }
-          page += '}';
+
+          paramlimits_t limits;
+
+          if (_config->getLimits(i, limits)) {
+            if (! isnan(limits._min)) {
+              json.print(FPSTR(COMMA_QUOTE));
+              json.print(FPSTR(JSON_MIN_PARAM));
+              json.print(FPSTR(QUOTE_COLON));
+              printLimit(json, limits._min, partype);
+            }
+            if (! isnan(limits._max)) {
+              json.print(FPSTR(COMMA_QUOTE));
+              json.print(FPSTR(JSON_MAX_PARAM));
+              json.print(FPSTR(QUOTE_COLON));
+              printLimit(json, limits._max, partype);
+            }
+            if (limits._step > 0) {
+              json.print(FPSTR(COMMA_QUOTE));
+              json.print(FPSTR(JSON_STEP_PARAM));
+              json.print(FPSTR(QUOTE_COLON));
+              printLimit(json, limits._step, PAR_FLOAT);
+            }
+            if (limits._choices) {
+              json.print(FPSTR(COMMA_QUOTE));
+              json.print(FPSTR(JSON_CHOICES_PARAM));
+              json.print(FPSTR(QUOTE_COLON));
+              printJson_P(json, limits._choices);
+            }
+            if (limits._pattern) {
+              json.print(FPSTR(COMMA_QUOTE));
+              json.print(FPSTR(JSON_PATTERN_PARAM));
+              json.print(FPSTR(QUOTE_COLON));
+              printJson_P(json, limits._pattern);
+            }
+          }
+          json.print('}');
         }
       }
     }
   }
-  page += '}';
-  _http->send(200, FPSTR(APPLICATION_JSON), page);
+  json.print('}');
+  json.end();
 }
 
 void BaseWebServer::handleSetConfig() {
-  if (! beforeHandle())
+  if (! beforeHandle()) {
+    freeBody();
     return;
+  }
+
+  if (_bodyStatus)
+    return handleSetConfigBody();
+
+  static const char PAGE_START[] PROGMEM = HTML_PAGE_START_STR
+    HTML_TITLE_STR("Store config")
+    "<meta http-equiv=\"refresh\" content=\"2;URL=" SETUP_URI_STR "\">\n"
+    HTML_HEAD_END_STR
+    HTML_BODY_START_STR;
 
   uint16_t retcode = 400;
-  String page = FPSTR(HTML_PAGE_START);
-
-  page += tag_P(PSTR("title"), F("Store config"), true);
-  page += F("<meta http-equiv=\"refresh\" content=\"2;URL=");
-  page += FPSTR(SETUP_URI);
-  page += F("\">\n");
-  page += FPSTR(HTML_HEAD_END);
-  page += FPSTR(HTML_BODY_START);
-  if (_http->hasArg(FPSTR(HTML_CONFIG_PARAM))) {
-    if (_config->fromString(_http->arg(FPSTR(HTML_CONFIG_PARAM)))) {
+  PGM_P message;
+  bool parsed = false;
+
+  if (_http->hasArg(FPSTR(HTML_CONFIG_PARAM))
+#ifdef USE_SSR_SETUP
+    || _http->hasArg(FPSTR(HTML_FIELDS_PARAM))
+#endif
+    ) {
+#ifdef USE_SSR_SETUP
+    if (! _http->hasArg(FPSTR(HTML_CONFIG_PARAM))) {
+      _config->requireAll(); // Form holds all fields
+
+      bool update = _config->beginUpdate(); // Publish all fields at once
+
+      parsed = true;
+      for (uint8_t i = 0; i < _config->paramCount(); ++i) {
+        String parname = FPSTR(_config->paramName(i));
+
+        if (_config->paramType(i) == PAR_BOOL) // Unchecked checkbox is not posted
+          parsed &= _config->setParam(i, _http->hasArg(parname) ? "1" : "0");
+        else if (_http->hasArg(parname))
+          parsed &= _config->setParam(i, _http->arg(parname).c_str());
+      }
+      if (update) {
+        if (parsed)
+          _config->commitUpdate();
+        else
+          _config->cancelUpdate();
+      }
+    } else
+#endif
+    {
+      uint8_t section;
+      const String &arg = _http->arg(FPSTR(HTML_CONFIG_PARAM));
+
+      parsed = getSection(section) && _config->fromJson(arg.c_str(), arg.length(), section);
+    }
+    if (parsed) {
       if (_config->save()) {
         retcode = 200;
-        page += F("OK\n");
+        message = PSTR("OK\n");
         Serial.println(F("Config updated successfully"));
       } else {
-        page += F("Store error!\n");
+        message = PSTR("Store error!\n");
         Serial.println(F("Error updating config!"));
       }
     } else {
-      page += F("Parse error!\n");
+      message = PSTR("Parse error!\n");
       Serial.println(F("Error parsing config!"));
     }
   } else {
-    page += F("Missing parameter!\n");
+    message = PSTR("Missing parameter!\n");
     Serial.println(F("Missing parameter!"));
   }
-  page += FPSTR(HTML_PAGE_END);
-  _http->send(retcode, FPSTR(TEXT_HTML), page);
+
+  ResponseWriter response(_http);
+
+  response.begin(retcode, TEXT_HTML);
+  renderTemplate(response, PAGE_START);
+  response.print(FPSTR(message));
+  if (! parsed) {
+    for (uint8_t i = 0; i < _config->errorCount(); ++i) {
+      uint8_t index;
+      paramerror_t error;
+
+      _config->getError(i, index, error);
+      response.print(F("<br>\n"));
+      response.print(FPSTR(_config->paramName(index)));
+      response.print(F(": "));
+      response.print(FPSTR(BaseConfig::errorText(error)));
+      response.print('\n');
+    }
+  }
+  response.print(FPSTR(HTML_PAGE_END));
+  response.end();
 }
 
+void BaseWebServer::handleSetConfigBody() {
+  uint16_t retcode = _bodyStatus;
+  PGM_P message;
+
+  if (retcode == 200) {
+    bool parsed;
+
+    uint8_t section;
+
+    if (_bodyType == BODY_MSGPACK)
+      parsed = getSection(section) && _config->fromMsgPack(_body.data(), _bodyLength, section);
+    else
+      parsed = _parser->finish();
+    if (! parsed)
+      retcode = 400;
+    else if (! _config->save())
+      retcode = 500;
+  }
+  freeBody();
+  if (retcode == 200)
+    message = PSTR("OK");
+  else if (retcode == 400)
+    message = PSTR("Parse error!");
+  else if (retcode == 404)
+    message = PSTR("Unknown section!");
+  else if (retcode == 413)
+    message = PSTR("Config too large!");
+  else if (retcode == 415)
+    message = PSTR("Unsupported content type!");
+  else if (retcode == 500)
+    message = PSTR("Store error!");
+  else
+    message = PSTR("Out of memory!");
+#ifdef USE_SERIAL
+  Serial.print(F("Config body: "));
+  Serial.println(FPSTR(message));
+#endif
+  if ((retcode == 400) && _config->errorCount()) { // Rejected params as { "name": "reason" }
+    ResponseWriter json(_http);
+
+    json.begin(retcode, APPLICATION_JSON);
+    json.print('{');
+    for (uint8_t i = 0; i < _config->errorCount(); ++i) {
+      uint8_t index;
+      paramerror_t error;
+
+      _config->getError(i, index, error);
+      if (i)
+        json.print(',');
+      printJson_P(json, _config->paramName(index));
+      json.print(':');
+      printJson_P(json, BaseConfig::errorText(error));
+    }
+    json.print('}');
+    json.end();
+    return;
+  }
+  if (retcode == 503) // Scratch buffer or parser may be free again soon
+    _http->sendHeader(F("Retry-After"), F("1"));
+  _http->send_P(retcode, TEXT_PLAIN, message);
+}
+
+void BaseWebServer::handleConfigBody() {
+  if (_http->header(FPSTR(CONTENT_TYPE_HEADER)).startsWith(F("multipart/"))) // Not a raw body
+    return;
+
+  HTTPRaw &raw = _http->raw();
+
+  if (raw.status == RAW_START) {
+    size_t length = _http->clientContentLength();
+
+    String contentType = _http->header(FPSTR(CONTENT_TYPE_HEADER));
+    uint8_t section;
+
+    freeBody();
+    if (contentType.indexOf(FPSTR(MSGPACK_SUBTYPE)) >= 0)
+      _bodyType = BODY_MSGPACK;
+    else if (contentType.startsWith(FPSTR(APPLICATION_JSON)))
+      _bodyType = BODY_JSON;
+    else
+      _bodyStatus = 415;
+    if (_bodyStatus)
+      return;
+    if (! getSection(section))
+      _bodyStatus = 404;
+    else if (length > MAX_BODY_SIZE)
+      _bodyStatus = 413;
+    else if (_bodyType == BODY_JSON) { // Parsed on the fly, no body buffer
+      if (! (_parser = new ConfigParser(_config, true, section)))
+        _bodyStatus = 503;
+    } else if (! _body.acquire(length + 1))
+      _bodyStatus = 503;
+    if (! _bodyStatus)
+      _bodyStatus = 200;
+  } else if (raw.status == RAW_WRITE) {
+    if (_bodyStatus == 200) {
+      if (_bodyLength + raw.currentSize > _http->clientContentLength())
+        _bodyStatus = 413;
+      else {
+        if (_parser)
+          _parser->parse((const char*)raw.buf, raw.currentSize);
+        else
+          memcpy(&_body.data()[_bodyLength], raw.buf, raw.currentSize);
+        _bodyLength += raw.currentSize;
+      }
+    }
+  } else if (raw.status == RAW_ABORTED) {
+    freeBody();
+  }
+}
+
+bool BaseWebServer::getSection(uint8_t &section) {
+  section = BaseConfig::ERR_INDEX; // All sections
+  if (_http->hasArg(FPSTR(HTML_SECTION_PARAM))) {
+    section = _config->findSection(_http->arg(FPSTR(HTML_SECTION_PARAM)).c_str());
+    if (section == BaseConfig::ERR_INDEX)
+      return false;
+  }
+
+  return true;
+}
+
+void BaseWebServer::freeBody() {
+  _body.release();
+  if (_parser) {
+    delete _parser;
+    _parser = NULL;
+  }
+  _bodyLength = 0;
+  _bodyStatus = 0;
+}
+
+#define CLEAR_PAGE_STR(message) HTML_PAGE_START_STR \
+  HTML_TITLE_STR("Clear config") \
+  "<meta http-equiv=\"refresh\" content=\"2;URL=" SETUP_URI_STR "\">\n" \
+  HTML_HEAD_END_STR \
+  HTML_BODY_START_STR \
+  message \
+  HTML_PAGE_END_STR
+
 void BaseWebServer::handleClearConfig() {
+  static const char PAGE_OK[] PROGMEM = CLEAR_PAGE_STR("OK\n");
+  static const char PAGE_ERROR[] PROGMEM = CLEAR_PAGE_STR("Clear error!\n");
+
   if (! beforeHandle())
     return;
 
   uint16_t retcode = 400;
-  String page = FPSTR(HTML_PAGE_START);
-
-  page += tag_P(PSTR("title"), F("Clear config"), true);
-  page += F("<meta http-equiv=\"refresh\" content=\"2;URL=");
-  page += FPSTR(SETUP_URI);
-  page += F("\">\n");
-  page += FPSTR(HTML_HEAD_END);
-  page += FPSTR(HTML_BODY_START);
+  PGM_P page;
+
   _config->clear();
   if (_config->save()) {
     retcode = 200;
-    page += F("OK\n");
+    page = PAGE_OK;
     Serial.println(F("Config cleared successfully"));
   } else {
-    page += F("Clear error!\n");
+    page = PAGE_ERROR;
     Serial.println(F("Error clearing config!"));
   }
-  page += FPSTR(HTML_PAGE_END);
-  _http->send(retcode, FPSTR(TEXT_HTML), page);
+  sendTemplate(page, retcode);
 }
 
 void BaseWebServer::handleRestart() {
@@ -533,20 +1190,10 @@ void BaseWebServer::handleRestart() {
 }
 
 void BaseWebServer::handleSPIFFS() {
-  if (! beforeHandle())
-    return;
-
-  String page = FPSTR(HTML_PAGE_START);
-
-  page += tag_P(PSTR("title"), F("SPIFFS"), true);
-  page += F("<script type=\"");
-  page += FPSTR(APPLICATION_JAVASCRIPT);
-  page += F("\" src=\"");
-  page += FPSTR(SCRIPT_URI);
-  page += F("\"></script>\n");
-  page += F("<script type=\"");
-  page += FPSTR(APPLICATION_JAVASCRIPT);
-  page += F("\">\n"
+  static const char PAGE[] PROGMEM = HTML_PAGE_START_STR
+    HTML_TITLE_STR("SPIFFS")
+    "<script type=\"" APPLICATION_JAVASCRIPT_STR "\" src=\"" SCRIPT_URI_STR "\"></script>\n"
+    "<script type=\"" APPLICATION_JAVASCRIPT_STR "\">\n"
     "function getSelectedCount(){\n"
     "var inputs=document.getElementsByTagName('input');\n"
     "var result=0;\n"
@@ -563,24 +1210,44 @@ void BaseWebServer::handleSPIFFS() {
     "}\n"
     "function deleteSelected(){\n"
     "var inputs=document.getElementsByTagName('input');\n"
+    "var files=[];\n"
     "for(var i=0;i<inputs.length;++i){\n"
     "if(inputs[i].type=='checkbox'){\n"
     "if(inputs[i].checked)\n"
-    "if(urlDelete('");
-  page += FPSTR(SPIFFS_URI);
-  page += F("?filename=/'+encodeURIComponent(inputs[i].value)+'&dummy='+Date.now())===null)\n"
-    "alert('Error!');\n"
+    "files.push('/'+inputs[i].value);\n"
     "}\n"
     "}\n"
+    "urlDelete('" SPIFFS_URI_STR "?dummy='+Date.now(),JSON.stringify(files),function(text){\n"
+    "if(text===null)\n"
+    "alert('Error!');\n"
     "location.reload(true);\n"
+    "});\n"
     "}\n"
-    "</script>\n");
-  page += getCss();
-  page += FPSTR(HTML_HEAD_END);
-  page += FPSTR(HTML_BODY_START);
-  page += F("<form method=\"POST\" action=\"\" enctype=\"multipart/form-data\" onsubmit=\"if(document.getElementsByName('upload')[0].files.length==0){alert('No file to upload!');return false;}\">\n"
+    "</script>\n"
+    "{{css}}"
+    HTML_HEAD_END_STR
+    HTML_BODY_START_STR
+    "<form method=\"POST\" action=\"\" enctype=\"multipart/form-data\" onsubmit=\"if(document.getElementsByName('upload')[0].files.length==0){alert('No file to upload!');return false;}\">\n"
     "<h3>SPIFFS</h3>\n"
-    "<p>\n");
+    "<p>\n"
+    "{{files}} file(s)\n"
+    "<p>\n"
+    "<input type=\"button\" name=\"delete\" value=\"Delete\" onclick=\"if(confirm('Are you sure to delete selected file(s)?')) deleteSelected()\" disabled>\n"
+    "<p>\n"
+    "Upload new file:<br/>\n"
+    "<input type=\"file\" name=\"upload\">\n"
+    "<input type=\"submit\" value=\"Upload\">\n"
+    "</form>\n"
+    HTML_PAGE_END_STR;
+
+  if (! beforeHandle())
+    return;
+
+  sendTemplate(PAGE);
+}
+
+void BaseWebServer::printFiles(Print &out) { // Table of files followed by their count
+  HtmlWriter html(out);
 
 #ifdef ESP32
   File dir = SPIFFS.open(FPSTR(ROOT_URI));
@@ -596,7 +1263,7 @@ void BaseWebServer::handleSPIFFS() {
 //  if (dir.isDirectory()) {
   {
 #endif
-    page += F("<table cols=2>\n");
+    html.print(F("<table cols=2>\n"));
 #ifdef ESP32
     while (file = dir.openNextFile()) {
 #else
@@ -615,31 +1282,21 @@ void BaseWebServer::handleSPIFFS() {
 #endif
       if (fileName.startsWith(FPSTR(ROOT_URI)))
         fileName = fileName.substring(1);
-      page += F("<tr><td><input type=\"checkbox\" name=\"file");
-      page += String(cnt);
-      page += F("\" value=\"");
-      page += fileName;
-      page += F("\" onchange=\"updateSelected()\"><a href=\"/");
-      page += fileName;
-      page += F("\" download>");
-      page += fileName;
-      page += F("</a></td><td>");
-      page += String(fileSize);
-      page += F("</td></tr>\n");
+      html.print(F("<tr><td><input type=\"checkbox\" name=\"file"));
+      html.print(cnt);
+      html.print(F("\" value=\""));
+      html.escape(fileName.c_str());
+      html.print(F("\" onchange=\"updateSelected()\"><a href=\"/"));
+      html.escape(fileName.c_str());
+      html.print(F("\" download>"));
+      html.escape(fileName.c_str());
+      html.print(F("</a></td><td>"));
+      html.print(fileSize);
+      html.print(F("</td></tr>\n"));
     }
-    page += F("</table>\n");
+    html.print(F("</table>\n"));
   }
-  page += String(cnt);
-  page += F(" file(s)\n"
-    "<p>\n"
-    "<input type=\"button\" name=\"delete\" value=\"Delete\" onclick=\"if(confirm('Are you sure to delete selected file(s)?')) deleteSelected()\" disabled>\n"
-    "<p>\n"
-    "Upload new file:<br/>\n"
-    "<input type=\"file\" name=\"upload\">\n"
-    "<input type=\"submit\" value=\"Upload\">\n"
-    "</form>\n");
-  page += FPSTR(HTML_PAGE_END);
-  _http->send(200, FPSTR(TEXT_HTML), page);
+  html.print(cnt);
 }
 
 void BaseWebServer::handleFileUploaded() {
@@ -681,6 +1338,9 @@ void BaseWebServer::handleFileDelete() {
   if (! beforeHandle())
     return;
 
+  if (_http->hasArg(FPSTR(HTML_PLAIN_PARAM)))
+    return handleFilesDelete();
+
   if (! _http->args())
     return _http->send_P(500, TEXT_PLAIN, PSTR("BAD ARGS"));
 
@@ -693,23 +1353,359 @@ void BaseWebServer::handleFileDelete() {
   _http->send_P(200, TEXT_PLAIN, PSTR("OK"));
 }
 
-void BaseWebServer::handleFwUpdate() {
+void BaseWebServer::handleFilesDelete() {
+  String body = _http->arg(FPSTR(HTML_PLAIN_PARAM));
+  uint16_t count = 1;
+
+  for (uint16_t i = 0; i < body.length(); ++i) {
+    if (body[i] == ',')
+      ++count;
+  }
+
+  DynamicJsonDocument jsonDoc(JSON_ARRAY_SIZE(count));
+
+  if (deserializeJson(jsonDoc, (char*)body.c_str()) || (! jsonDoc.is<JsonArray>())) // Zero-copy parsing in place
+    return _http->send_P(400, TEXT_PLAIN, PSTR("BAD LIST"));
+
+  JsonArrayConst files = jsonDoc.as<JsonArrayConst>();
+  uint16_t total = 0;
+  uint16_t missing = 0;
+
+  for (JsonVariantConst file : files) { // Iterated, index access walks linked slots from start
+    String path = file.as<const char*>();
+
+    ++total;
+
+    if (! path.startsWith(FPSTR(ROOT_URI)))
+      path = '/' + path;
+    if ((path == FPSTR(ROOT_URI)) || (! SPIFFS.exists(path)) || (! SPIFFS.remove(path)))
+      ++missing;
+  }
+  if (missing) {
+    String &page = _page.begin(40);
+
+    page += String(missing);
+    page += F(" of ");
+    page += String(total);
+    page += F(" file(s) not deleted!");
+    _http->send(404, FPSTR(TEXT_PLAIN), page);
+    _page.end();
+  } else
+    _http->send_P(200, TEXT_PLAIN, PSTR("OK"));
+}
+
+#ifdef BUNDLE_KEY
+void BaseWebServer::handleExport() {
   if (! beforeHandle())
     return;
 
-  String page = FPSTR(HTML_PAGE_START);
+  static const char FILE_ARG[] PROGMEM = "file";
+
+  char mode[2];
+
+  mode[0] = 'r';
+  mode[1] = '\0';
+  for (uint8_t i = 0; i < _http->args(); ++i) { // Check chosen files before streaming
+    if (_http->argName(i) != FPSTR(FILE_ARG))
+      continue;
+    if (isConfigFile(_http->arg(i)))
+      return _http->send_P(400, TEXT_PLAIN, PSTR("Config is bundled as values!"));
+    if (! SPIFFS.exists(_http->arg(i)))
+      return _http->send_P(404, TEXT_PLAIN, PSTR("File not found!"));
+  }
+
+  BundleSigner signer;
+  StreamString json;
+
+  _config->exportJson(json);
+  _http->sendHeader(F("Content-Disposition"), F("attachment; filename=\"bundle.txt\""));
+  _http->setContentLength(CONTENT_LENGTH_UNKNOWN);
+  _http->send(200, FPSTR(TEXT_PLAIN), String());
+
+  String &page = _page.begin(512 + BUNDLE_LINE / 3 * 4 + 1); // Chunk is sent after line crossing 512 chars
+
+  page = FPSTR(BUNDLE_MAGIC);
+  page += '\n';
+  page += FPSTR(BUNDLE_CONFIG);
+  page += '\n';
+  signer.update(page);
+  _http->sendContent(page);
+  json += '\n'; // Serialized without newlines
+  signer.update(json);
+  _http->sendContent(json);
+  for (uint8_t i = 0; i < _http->args(); ++i) {
+    if (_http->argName(i) != FPSTR(FILE_ARG))
+      continue;
+
+    File file = SPIFFS.open(_http->arg(i), mode);
+
+    if (! file)
+      continue;
+    page = FPSTR(BUNDLE_FILE);
+    page += _http->arg(i);
+    page += ' ';
+    page += String(file.size());
+    page += '\n';
+
+    uint8_t buf[BUNDLE_LINE];
+    char line[BUNDLE_LINE / 3 * 4 + 1];
+    size_t len;
+
+    while ((len = file.read(buf, sizeof(buf))) > 0) {
+      page += base64Encode(line, buf, len);
+      page += '\n';
+      if (page.length() >= 512) {
+        signer.update(page);
+        _http->sendContent(page);
+        page.remove(0);
+      }
+    }
+    file.close();
+    signer.update(page);
+    _http->sendContent(page);
+  }
+  page = FPSTR(BUNDLE_SIG);
+  page += signer.signature();
+  page += '\n';
+  _http->sendContent(page);
+  _http->sendContent(String());
+  _page.end();
+}
+
+void BaseWebServer::handleImport() {
+  if (bundleFile)
+    bundleFile.close();
+  if (! beforeHandle()) {
+    SPIFFS.remove(FPSTR(BUNDLE_TEMP));
+    freeBody();
+    return;
+  }
+
+  uint16_t retcode = _bodyStatus ? _bodyStatus : 400;
+  PGM_P message;
+
+  if (retcode == 200) {
+    char mode[2];
+
+    mode[0] = 'r';
+    mode[1] = '\0';
 
-  page += tag_P(PSTR("title"), F("Sketch Update"), true);
-  page += getCss();
-  page += FPSTR(HTML_HEAD_END);
-  page += FPSTR(HTML_BODY_START);
-  page += F("<form method=\"POST\" action=\"\" enctype=\"multipart/form-data\" onsubmit=\"if(document.getElementsByName('update')[0].files.length==0){alert('No file to update!');return false;}\">\n"
+    File file = SPIFFS.open(FPSTR(BUNDLE_TEMP), mode);
+
+    if (file) {
+      retcode = importBundle(file);
+      file.close();
+    } else
+      retcode = 500;
+  }
+  SPIFFS.remove(FPSTR(BUNDLE_TEMP));
+  freeBody();
+  if (retcode == 200)
+    message = PSTR("OK");
+  else if (retcode == 400)
+    message = PSTR("Bad bundle!");
+  else if (retcode == 403)
+    message = PSTR("Wrong signature!");
+  else if (retcode == 413)
+    message = PSTR("Bundle too large!");
+  else
+    message = PSTR("Store error!");
+#ifdef USE_SERIAL
+  Serial.print(F("Bundle import: "));
+  Serial.println(FPSTR(message));
+#endif
+  _http->send_P(retcode, TEXT_PLAIN, message);
+}
+
+void BaseWebServer::handleBundleBody() {
+  if (_http->header(FPSTR(CONTENT_TYPE_HEADER)).startsWith(F("multipart/"))) // Not a raw body
+    return;
+
+  HTTPRaw &raw = _http->raw();
+
+  if (raw.status == RAW_START) {
+    FSInfo info;
+    char mode[2];
+
+    mode[0] = 'w';
+    mode[1] = '\0';
+    freeBody();
+#ifdef USE_AUTHORIZATION
+    if (! isAuthorized()) { // Nothing is stored for unknown client, handleImport() asks for credentials
+      _bodyStatus = 401;
+      return;
+    }
+#endif
+    bundleFree = SPIFFS.info(info) && (info.totalBytes > info.usedBytes) ? info.totalBytes - info.usedBytes : 0;
+    if (_http->clientContentLength() > bundleFree) {
+      _bodyStatus = 413;
+      return;
+    }
+    bundleFile = SPIFFS.open(FPSTR(BUNDLE_TEMP), mode);
+    _bodyStatus = bundleFile ? 200 : 500;
+  } else if (raw.status == RAW_WRITE) {
+    if (_bodyStatus != 200)
+      return;
+    if (_bodyLength + raw.currentSize > bundleFree) { // Body longer than announced fits no more
+      bundleFile.close();
+      SPIFFS.remove(FPSTR(BUNDLE_TEMP));
+      _bodyStatus = 413;
+    } else if (bundleFile.write(raw.buf, raw.currentSize) != raw.currentSize)
+      _bodyStatus = 500;
+    else
+      _bodyLength += raw.currentSize;
+  } else if (raw.status == RAW_ABORTED) {
+    bundleFile.close();
+    SPIFFS.remove(FPSTR(BUNDLE_TEMP));
+    freeBody();
+  }
+}
+
+uint16_t BaseWebServer::importBundle(File &file) {
+  BundleSigner signer;
+  String line;
+  bool signature = false;
+
+  while (file.available()) { // Nothing is applied before whole bundle is verified
+    line = file.readStringUntil('\n');
+    if (line.startsWith(FPSTR(BUNDLE_SIG))) {
+      String expected = signer.signature();
+      uint8_t diff = line.length() - strlen_P(BUNDLE_SIG) != expected.length();
+
+      for (uint8_t i = 0; i < expected.length(); ++i) { // Every byte is compared, time does not depend on first mismatch
+        diff |= expected[i] ^ line[strlen_P(BUNDLE_SIG) + i];
+      }
+      if (diff)
+        return 403;
+      signature = true;
+      break;
+    }
+    line += '\n';
+    signer.update(line);
+  }
+  if (! signature)
+    return 403;
+  file.seek(0);
+  if (file.readStringUntil('\n') != FPSTR(BUNDLE_MAGIC))
+    return 400;
+
+  String config;
+  String paths; // Targets of staged files, one per line
+  uint8_t staged = 0;
+  uint16_t result = 200;
+  char mode[2];
+
+  mode[0] = 'w';
+  mode[1] = '\0';
+  while ((result == 200) && file.available()) { // Files are staged, config is kept until all are written
+    line = file.readStringUntil('\n');
+    if (line == FPSTR(BUNDLE_CONFIG))
+      config = file.readStringUntil('\n');
+    else if (line.startsWith(FPSTR(BUNDLE_FILE))) {
+      int16_t space = line.lastIndexOf(' ');
+      String path = line.substring(strlen_P(BUNDLE_FILE), space);
+      int32_t size = line.substring(space + 1).toInt();
+
+      if ((space <= (int16_t)strlen_P(BUNDLE_FILE)) || (! path.startsWith(FPSTR(ROOT_URI))) || path.startsWith(FPSTR(BUNDLE_TEMP)) ||
+        isConfigFile(path) || (staged == BUNDLE_FILES)) {
+        result = 400;
+        break;
+      }
+
+      File target = SPIFFS.open(bundleStaged(staged), mode);
+
+      if (! target) {
+        result = 500;
+        break;
+      }
+      ++staged;
+      while (size > 0) {
+        uint8_t buf[BUNDLE_LINE];
+        int32_t len = base64Decode(buf, sizeof(buf), file.readStringUntil('\n').c_str());
+
+        if (len <= 0) {
+          result = 400;
+          break;
+        }
+        if (target.write(buf, len) != (size_t)len) {
+          result = 500;
+          break;
+        }
+        size -= len;
+      }
+      target.close();
+      paths += path;
+      paths += '\n';
+    } else if (line.startsWith(FPSTR(BUNDLE_SIG)))
+      break;
+    else
+      result = 400;
+  }
+  uint8_t *prev = NULL; // Config before import, while it may need to go back
+
+  if ((result == 200) && config.length()) {
+    prev = (uint8_t*)malloc(_config->snapshotSize());
+    if ((! prev) || (! _config->snapshot(prev)))
+      result = 500;
+    else if (! _config->fromJson(config.c_str(), config.length())) // Schema of exporting firmware is migrated
+      result = 400;
+    else if (! _config->save()) {
+      _config->restore(prev);
+      _config->save();
+      result = 500;
+    }
+  }
+  if (result == 200) {
+    for (uint8_t i = 0; (result == 200) && (i < staged); ++i) { // Targets are replaced only now
+      int16_t end = paths.indexOf('\n');
+      String path = paths.substring(0, end);
+
+      paths.remove(0, end + 1);
+      SPIFFS.remove(path);
+      if (! SPIFFS.rename(bundleStaged(i), path)) { // Config goes back, files renamed before stay replaced
+        if (prev) {
+          _config->restore(prev);
+          _config->save();
+        }
+        result = 500;
+      }
+    }
+  }
+  if (prev)
+    free(prev);
+  while (staged) // Not renamed on failure
+    SPIFFS.remove(bundleStaged(--staged));
+
+  return result;
+}
+
+bool BaseWebServer::isConfigFile(const String &path) const {
+  for (uint8_t i = 0; i < _config->sectionCount(); ++i) {
+    if (path == _config->sectionFile(i))
+      return true;
+  }
+
+  return false;
+}
+#endif
+
+void BaseWebServer::handleFwUpdate() {
+  static const char PAGE[] PROGMEM = HTML_PAGE_START_STR
+    HTML_TITLE_STR("Sketch Update")
+    "{{css}}"
+    HTML_HEAD_END_STR
+    HTML_BODY_START_STR
+    "<form method=\"POST\" action=\"\" enctype=\"multipart/form-data\" onsubmit=\"if(document.getElementsByName('update')[0].files.length==0){alert('No file to update!');return false;}\">\n"
     "Select compiled sketch to upload:<br/>\n"
     "<input type=\"file\" name=\"upload\">\n"
     "<input type=\"submit\" value=\"Update\">\n"
-    "</form>\n");
-  page += FPSTR(HTML_PAGE_END);
-  _http->send(200, FPSTR(TEXT_HTML), page);
+    "</form>\n"
+    HTML_PAGE_END_STR;
+
+  if (! beforeHandle())
+    return;
+
+  sendTemplate(PAGE);
 }
 
 void BaseWebServer::handleSketchUpdated() {
@@ -782,14 +1778,89 @@ void BaseWebServer::handleSketchUpdate() {
   yield();
 }
 
+#ifdef USE_METRICS
+void BaseWebServer::handleMetrics() {
+  if (! beforeHandle())
+    return;
+
+  bool json = _http->hasArg(F("json")) || (_http->header(FPSTR(ACCEPT_HEADER)).indexOf(FPSTR(APPLICATION_JSON)) >= 0);
+  String &page = _page.begin(640);
+
+  _http->setContentLength(CONTENT_LENGTH_UNKNOWN);
+  if (json) {
+    _http->send(200, FPSTR(APPLICATION_JSON), String());
+    page += '{';
+    heapToJson(page);
+    page += F(",\"metrics\":[");
+  } else {
+    _http->send(200, F("text/plain; version=0.0.4"), String()); // Prometheus exposition format
+    heapToPrometheus(page);
+  }
+  for (uint8_t i = 0; i < METRIC_COUNT; ++i) {
+    if (json)
+      metricToJson(page, i);
+    else
+      metricToPrometheus(page, i);
+    if (page.length() >= 512) { // Whole report is too large for single string
+      _http->sendContent(page);
+      page.remove(0);
+    }
+  }
+  if (json)
+    page += F("]}");
+  _http->sendContent(page);
+  _http->sendContent(String());
+  _page.end();
+}
+#endif
+
+#ifdef USE_HEAPTRACE
+void BaseWebServer::handleHeapTrace() { // [{"t":ms,"r":"GET /","a":allocs,"f":frees,"b":bytes,"p":peak,"h":retained},...] newest first
+  if (! beforeHandle())
+    return;
+
+  String &page = _page.begin(HEAPTRACE_HISTORY * (HEAPTRACE_ROUTE + 90) + 3);
+  const heaprequest_t *request;
+
+  page += '[';
+  for (uint8_t i = 0; (request = heapTraceRequest(i)) != NULL; ++i) {
+    if (i)
+      page += ',';
+    page += F("{\"t\":");
+    page += String(request->time);
+    page += F(",\"r\":\"");
+    page += request->route;
+    page += F("\",\"a\":");
+    page += String(request->trace.allocs);
+    page += F(",\"f\":");
+    page += String(request->trace.frees);
+    page += F(",\"b\":");
+    page += String(request->trace.bytes);
+    page += F(",\"p\":");
+    page += String(request->trace.peak);
+    page += F(",\"h\":");
+    page += String(request->trace.retained);
+    page += '}';
+  }
+  page += ']';
+  _http->send(200, FPSTR(APPLICATION_JSON), page);
+  _page.end();
+}
+#endif
+
 #ifdef USE_AUTHORIZATION
-bool BaseWebServer::checkAuthorization() {
+bool BaseWebServer::isAuthorized() {
   char user[sizeof(AUTH_USER)];
   char pswd[sizeof(AUTH_PSWD)];
 
   strcpy_P(user, PSTR(AUTH_USER));
   strcpy_P(pswd, PSTR(AUTH_PSWD));
-  if (! _http->authenticate(user, pswd)) {
+
+  return _http->authenticate(user, pswd);
+}
+
+bool BaseWebServer::checkAuthorization() {
+  if (! isAuthorized()) {
     _http->requestAuthentication();
 
     return false;
@@ -859,3 +1930,22 @@ String BaseWebServer::getCss() {
 
   return result;
 }
+
+void BaseWebServer::templateValue(Print &out, const char *name) {
+  if (! strcmp_P(name, PSTR("css")))
+    out.print(getCss());
+  else if (! strcmp_P(name, PSTR("files")))
+    printFiles(out);
+}
+
+void BaseWebServer::sendTemplate(PGM_P tmpl, uint16_t retcode) {
+  ResponseWriter response(_http);
+
+  response.begin(retcode, TEXT_HTML);
+  renderTemplate(response, tmpl, templateCallback, this);
+  response.end();
+}
+
+void BaseWebServer::templateCallback(Print &out, const char *name, void *arg) {
+  ((BaseWebServer*)arg)->templateValue(out, name);
+}
@@ -0,0 +1,358 @@
+#include "Customization.h"
+
+#ifdef USE_BENCHMARK
+#ifdef ESP32
+#include <SPIFFS.h>
+#else
+#include <FS.h>
+#endif
+#include "Benchmark.h"
+#include "BaseConfig.h"
+#include "HeapTrace.h"
+#include "StrUtils.h"
+
+static const uint8_t BENCH_ITERATIONS = 10;
+static const uint8_t BENCH_COUNTS[] PROGMEM = { 5, 25, 100, 250 };
+static const uint8_t BENCH_STRSIZES[] PROGMEM = { 16, 64 };
+
+static const char BENCH_SECTION[] PROGMEM = "bench"; // Saved to own file, "/config.json" is untouched
+
+enum benchpath_t : uint8_t { BENCH_SAVE, BENCH_LOAD, BENCH_TOSTRING, BENCH_FROMSTRING, BENCH_TOMSGPACK, BENCH_PATHS };
+
+static const char BENCH_NAMES[BENCH_PATHS][11] PROGMEM = { "save", "load", "toString", "fromString", "toMsgPack" };
+
+class BenchConfig : public BaseConfig { // Params of rotating types in RAM, all in section 1
+public:
+  static BenchConfig *create(uint8_t count, uint8_t strSize);
+  ~BenchConfig() {
+    free(_table);
+    free(_names);
+    free(_values);
+    free(_valueOffsets);
+  }
+
+  void *getParamPtr(uint8_t index) {
+    if (index < _paramCount)
+      return &_values[_valueOffsets[index]];
+
+    return NULL;
+  }
+
+  void touch() {
+    _dirty = 1 << 1;
+  }
+
+  void fillPasswords() { // Longest value, empty ones are not sealed
+    for (uint8_t i = 0; i < _paramCount; ++i) {
+      if (_table[i]._type == PAR_PSWD) {
+        memset(getParamPtr(i), 'x', _table[i]._size - 1);
+        ((char*)getParamPtr(i))[_table[i]._size - 1] = '\0';
+      }
+    }
+  }
+
+  bool checkPasswords() { // All opened by load
+    for (uint8_t i = 0; i < _paramCount; ++i) {
+      if ((_table[i]._type == PAR_PSWD) && (strlen((const char*)getParamPtr(i)) != _table[i]._size - 1U))
+        return false;
+    }
+
+    return true;
+  }
+
+  size_t sealedSize(uint8_t index) const {
+    return sealedLength(_table[index]._size) + 1;
+  }
+  bool seal(uint8_t index, char *sealed) {
+    return sealPassword(index, (const char*)getParamPtr(index), sealed);
+  }
+  bool open(uint8_t index, const char *sealed) {
+    return openPassword(index, sealed, (char*)getParamPtr(index));
+  }
+
+protected:
+  BenchConfig(param_t *table, uint8_t count, char *names, uint8_t *values, uint16_t *valueOffsets) : BaseConfig(table, count, _benchSections, 2),
+    _table(table), _names(names), _values(values), _valueOffsets(valueOffsets) {
+    _benchSections[0]._name = EMPTYSTR;
+    _benchSections[0]._count = 0;
+    _benchSections[1]._name = BENCH_SECTION;
+    _benchSections[1]._count = count;
+  }
+
+  param_t *_table;
+  char *_names;
+  uint8_t *_values;
+  uint16_t *_valueOffsets;
+  paramsection_t _benchSections[2];
+};
+
+BenchConfig *BenchConfig::create(uint8_t count, uint8_t strSize) {
+  static const paramtype_t TYPES[] PROGMEM = { PAR_BOOL, PAR_I16, PAR_UI32, PAR_FLOAT, PAR_STR, PAR_PSWD };
+
+  param_t *table = (param_t*)malloc(sizeof(param_t) * count);
+  char *names = (char*)malloc(count * 5);
+  uint16_t *valueOffsets = (uint16_t*)malloc(sizeof(uint16_t) * count);
+  uint16_t size = 0;
+
+  if (table && names && valueOffsets) {
+    memset(table, 0, sizeof(param_t) * count);
+    for (uint8_t i = 0; i < count; ++i) {
+      table[i]._type = (paramtype_t)pgm_read_byte(&TYPES[i % sizeof(TYPES)]);
+      table[i]._item = table[i]._type;
+      table[i]._name = &names[i * 5];
+      sprintf_P(&names[i * 5], PSTR("p%03u"), i);
+      table[i]._size = ((table[i]._type == PAR_STR) || (table[i]._type == PAR_PSWD)) ? strSize : paramItemSize(table[i]._type);
+      valueOffsets[i] = size;
+      size += (table[i]._size + 3) & ~3; // Aligned for direct access
+    }
+
+    uint8_t *values = (uint8_t*)malloc(size);
+
+    if (values) {
+      BenchConfig *result = new BenchConfig(table, count, names, values, valueOffsets);
+
+      if (result)
+        return result;
+      free(values);
+    }
+  }
+  if (table)
+    free(table);
+  if (names)
+    free(names);
+  if (valueOffsets)
+    free(valueOffsets);
+
+  return NULL;
+}
+
+class NullPrint : public Print {
+public:
+  size_t write(uint8_t) {
+    return 1;
+  }
+  size_t write(const uint8_t *, size_t size) {
+    return size;
+  }
+};
+
+static bool runPath(BenchConfig *config, benchpath_t path, String &json) {
+  if (path == BENCH_SAVE) {
+    config->touch();
+    return config->save();
+  }
+  if (path == BENCH_LOAD)
+    return config->load(1);
+  if (path == BENCH_TOSTRING) {
+    json = config->toString();
+    return json.length() > 0;
+  }
+  if (path == BENCH_FROMSTRING)
+    return config->fromString(json);
+  if (path == BENCH_TOMSGPACK) {
+    NullPrint out;
+
+    return config->toMsgPack(out) > 0;
+  }
+
+  return false;
+}
+
+static void printPrefix(Print &out, PGM_P path, uint8_t count, uint8_t strSize) {
+  out.print(F("BENCH,"));
+  out.print(FPSTR(path));
+  out.print(',');
+  out.print(count);
+  out.print(',');
+  out.print(strSize);
+}
+
+static void benchmark(Print &out, uint8_t count, uint8_t strSize) {
+  BenchConfig *config = BenchConfig::create(count, strSize);
+
+  if (! config) {
+    printPrefix(out, PSTR("create"), count, strSize);
+    out.println(F(",OOM"));
+    return;
+  }
+  config->clear();
+  config->fillPasswords(); // Sealed by save, opened by load
+  config->touch(); // Not section 0 in "/config.json"
+
+  String json;
+
+  for (uint8_t path = 0; path < BENCH_PATHS; ++path) {
+    uint64_t cycles = 0;
+    uint32_t allocs = 0;
+    uint32_t bytes = 0;
+    uint32_t peak = 0;
+    bool ok = true;
+
+    runPath(config, (benchpath_t)path, json); // Warm up lazily built indexes and pools
+    for (uint8_t i = 0; ok && (i < BENCH_ITERATIONS); ++i) {
+      heaptrace_t trace;
+      uint32_t start;
+
+      if (path == BENCH_TOSTRING)
+        json = String(); // Not measured as realloc of previous result
+      yield();
+      heapTraceBegin();
+      start = ESP.getCycleCount();
+      ok = runPath(config, (benchpath_t)path, json);
+      cycles += ESP.getCycleCount() - start;
+      heapTraceEnd(trace);
+      allocs += trace.allocs;
+      bytes += trace.bytes;
+      if (trace.peak > peak)
+        peak = trace.peak;
+    }
+    if (path == BENCH_LOAD)
+      ok = ok && config->checkPasswords();
+    printPrefix(out, BENCH_NAMES[path], count, strSize);
+    if (ok) {
+      out.print(',');
+      out.print((uint32_t)(cycles * 1000 / ESP.getCpuFreqMHz() / BENCH_ITERATIONS));
+      out.print(',');
+      out.print(allocs / BENCH_ITERATIONS);
+      out.print(',');
+      out.print(bytes / BENCH_ITERATIONS);
+      out.print(',');
+      out.println(peak);
+    } else
+      out.println(F(",FAIL"));
+  }
+  delete config;
+  SPIFFS.remove(String(FPSTR(CONFIG_SECTION_PREFIX)) + FPSTR(BENCH_SECTION) + FPSTR(CONFIG_SECTION_EXT));
+}
+
+static const uint8_t BENCH_SEAL_ITERATIONS = 100;
+static const uint8_t BENCH_SEAL_INDEX = 5; // First PAR_PSWD of bench table
+
+static void benchmarkSeal(Print &out, uint8_t strSize) {
+  BenchConfig *config = BenchConfig::create(BENCH_SEAL_INDEX + 1, strSize);
+  char *sealed = config ? (char*)malloc(config->sealedSize(BENCH_SEAL_INDEX)) : NULL;
+  uint32_t sealCycles = 0, openCycles = 0;
+  bool ok = sealed != NULL;
+
+  if (config) {
+    config->clear();
+    config->fillPasswords();
+  }
+  for (uint8_t i = 0; ok && (i < BENCH_SEAL_ITERATIONS); ++i) {
+    uint32_t start;
+
+    yield();
+    start = ESP.getCycleCount();
+    ok = config->seal(BENCH_SEAL_INDEX, sealed);
+    sealCycles += ESP.getCycleCount() - start;
+    *(char*)config->getParamPtr(BENCH_SEAL_INDEX) = '\0';
+    start = ESP.getCycleCount();
+    ok = ok && config->open(BENCH_SEAL_INDEX, sealed);
+    openCycles += ESP.getCycleCount() - start;
+    ok = ok && (strlen((char*)config->getParamPtr(BENCH_SEAL_INDEX)) == strSize - 1U);
+  }
+  printPrefix(out, PSTR("seal"), 1, strSize);
+  if (ok) {
+    out.print(',');
+    out.println((uint32_t)((uint64_t)sealCycles * 1000 / ESP.getCpuFreqMHz() / BENCH_SEAL_ITERATIONS));
+  } else
+    out.println(sealed ? F(",FAIL") : F(",OOM"));
+  printPrefix(out, PSTR("open"), 1, strSize);
+  if (ok) {
+    out.print(',');
+    out.println((uint32_t)((uint64_t)openCycles * 1000 / ESP.getCpuFreqMHz() / BENCH_SEAL_ITERATIONS));
+  } else
+    out.println(sealed ? F(",FAIL") : F(",OOM"));
+  if (sealed)
+    free(sealed);
+  if (config)
+    delete config;
+}
+
+#define BENCH_TEXT "The quick brown fox jumps over the lazy dog and naps in the sun."
+
+static const uint16_t BENCH_STR_ITERATIONS = 1000;
+static const uint8_t BENCH_STR_LENGTHS[] PROGMEM = { 8, 32, 64 };
+
+static const char BENCH_STR_ALIGNED[] PROGMEM = BENCH_TEXT;
+static const char BENCH_STR_SHIFTED[] PROGMEM = "_" BENCH_TEXT; // Text is misaligned by 1
+
+enum benchstr_t : uint8_t { BENCH_STRCMP, BENCH_STRCMP_BYTES, BENCH_STRCASECMP, BENCH_STRCASECMP_BYTES, BENCH_STR_PATHS };
+
+static const char BENCH_STR_NAMES[BENCH_STR_PATHS][20] PROGMEM = { "strcmp_PP", "strcmp_PP/bytes", "strcasecmp_PP", "strcasecmp_PP/bytes" };
+
+static int8_t strcmpBytes_PP(PGM_P s1, PGM_P s2) { // Former byte at a time implementation as reference
+  char c1, c2;
+
+  do {
+    c1 = pgm_read_byte(s1++);
+    c2 = pgm_read_byte(s2++);
+  } while ((c1 == c2) && (c1 != '\0'));
+
+  return (c1 - c2);
+}
+
+static int8_t strcasecmpBytes_PP(PGM_P s1, PGM_P s2) {
+  char c1, c2;
+
+  do {
+    c1 = toupper(pgm_read_byte(s1++));
+    c2 = toupper(pgm_read_byte(s2++));
+  } while ((c1 == c2) && (c1 != '\0'));
+
+  return (c1 - c2);
+}
+
+static int8_t runStrPath(benchstr_t path, PGM_P s1, PGM_P s2) {
+  if (path == BENCH_STRCMP)
+    return strcmp_PP(s1, s2);
+  if (path == BENCH_STRCMP_BYTES)
+    return strcmpBytes_PP(s1, s2);
+  if (path == BENCH_STRCASECMP)
+    return strcasecmp_PP(s1, s2);
+
+  return strcasecmpBytes_PP(s1, s2);
+}
+
+static void benchmarkStrings(Print &out, uint8_t length, uint8_t offset) {
+  PGM_P s1 = &BENCH_STR_ALIGNED[sizeof(BENCH_STR_ALIGNED) - 1 - length];
+  PGM_P s2 = offset ? &BENCH_STR_SHIFTED[sizeof(BENCH_STR_SHIFTED) - 1 - length] : s1;
+
+  for (uint8_t path = 0; path < BENCH_STR_PATHS; ++path) {
+    uint32_t cycles;
+    int16_t result = 0;
+
+    yield();
+    cycles = ESP.getCycleCount();
+    for (uint16_t i = 0; i < BENCH_STR_ITERATIONS; ++i) {
+      result += runStrPath((benchstr_t)path, s1, s2);
+    }
+    cycles = ESP.getCycleCount() - cycles;
+    printPrefix(out, BENCH_STR_NAMES[path], offset, length);
+    if (! result) {
+      out.print(',');
+      out.println((uint32_t)((uint64_t)cycles * 1000 / ESP.getCpuFreqMHz() / BENCH_STR_ITERATIONS));
+    } else
+      out.println(F(",FAIL"));
+  }
+}
+
+void runBenchmarks(Print &out) {
+  out.println(F("BENCH,path,params,strsize,ns/op,allocs/op,bytes/op,peak"));
+  for (uint8_t i = 0; i < sizeof(BENCH_COUNTS); ++i) {
+    for (uint8_t j = 0; j < sizeof(BENCH_STRSIZES); ++j) {
+      benchmark(out, pgm_read_byte(&BENCH_COUNTS[i]), pgm_read_byte(&BENCH_STRSIZES[j]));
+    }
+  }
+  out.println(F("BENCH,path,passwords,strsize,ns/op"));
+  for (uint8_t i = 0; i < sizeof(BENCH_STRSIZES); ++i) {
+    benchmarkSeal(out, pgm_read_byte(&BENCH_STRSIZES[i]));
+  }
+  out.println(F("BENCH,path,offset,strlen,ns/op"));
+  for (uint8_t i = 0; i < sizeof(BENCH_STR_LENGTHS); ++i) {
+    for (uint8_t offset = 0; offset < 2; ++offset) {
+      benchmarkStrings(out, pgm_read_byte(&BENCH_STR_LENGTHS[i]), offset);
+    }
+  }
+}
+#endif
@@ -6,43 +6,43 @@
 #include "CaptivePortal.h"
 #include "StrUtils.h"
 #include "HtmlHelper.h"
+#include "ChannelScore.h"
 
-static uint8_t wifiFindFreeChannel() {
-  int32_t levels[MAX_WIFI_CHANNEL];
-  int8_t nets, i;
+static const uint32_t CHANNEL_CACHE_MAGIC = 0x43500000; // "CP" and channel in low byte
 
-  memset(levels, 0, sizeof(levels));
-  WiFi.disconnect();
-  nets = WiFi.scanNetworks(false, true);
-  for (i = 0; i < nets; ++i) {
-    uint8_t channel = WiFi.channel(i);
-    int32_t rssi = WiFi.RSSI(i);
+#ifdef ESP32
+RTC_NOINIT_ATTR static uint32_t channelCache[2]; // Survives reset, checked by magic
+#endif
 
-    if ((! levels[channel - 1]) || (levels[channel - 1] < rssi))
-      levels[channel - 1] = rssi;
-  }
-  WiFi.scanDelete();
+static uint8_t cachedChannel() {
+  uint32_t cache[2];
 
-  nets = 0; // First channel
-  int32_t minlevel = levels[nets] + levels[nets + 1] / 2;
-
-  if (minlevel) {
-    for (i = 1; i < MAX_WIFI_CHANNEL; ++i) {
-      int32_t level = levels[i] + levels[i - 1] / 2;
-
-      if (i < MAX_WIFI_CHANNEL - 1)
-        level += levels[i + 1] / 2;
-      if (! level) { // Free channel
-        nets = i;
-        break;
-      } else if (level < minlevel) {
-        minlevel = level;
-        nets = i;
-      }
-    }
+#ifdef ESP32
+  memcpy(cache, channelCache, sizeof(cache));
+#else
+  if (! ESP.rtcUserMemoryRead(CP_RTC_BLOCK, cache, sizeof(cache)))
+    return 0;
+#endif
+  if (((cache[0] & 0xFFFFFF00) == CHANNEL_CACHE_MAGIC) && (cache[1] == ~cache[0])) {
+    uint8_t channel = cache[0];
+
+    if ((channel >= 1) && (channel <= MAX_WIFI_CHANNEL))
+      return channel;
   }
 
-  return (nets + 1);
+  return 0;
+}
+
+static void cacheChannel(uint8_t channel) {
+  uint32_t cache[2];
+
+  cache[0] = CHANNEL_CACHE_MAGIC | channel;
+  cache[1] = ~cache[0];
+#ifdef ESP32
+  memcpy(channelCache, cache, sizeof(cache));
+#else
+  ESP.rtcUserMemoryWrite(CP_RTC_BLOCK, cache, sizeof(cache));
+#endif
 }
 
 bool CaptivePortal::_setup() {
@@ -84,12 +84,21 @@ void CaptivePortal::_loop() {
 }
 
 bool CaptivePortal::exec(uint16_t duration) {
+  bool survey;
+
   {
     String _ssid = ssid();
     String _pswd = password();
-    uint8_t _channel = channel();
-
-    WiFi.mode(WIFI_AP);
+    uint8_t _channel;
+
+    _surveyChannel = false;
+    _channel = channel();
+    survey = autoChannel();
+    if (survey) { // Station interface scans while AP is already up
+      WiFi.mode(WIFI_AP_STA);
+      WiFi.disconnect();
+    } else
+      WiFi.mode(WIFI_AP);
 #ifdef USE_SERIAL
     Serial.print(F("AP \""));
     Serial.print(_ssid);
@@ -106,6 +115,7 @@ bool CaptivePortal::exec(uint16_t duration) {
 
       return false;
     }
+    _apChannel = _channel;
   }
 #ifdef USE_SERIAL
   Serial.print(F("successfully (IP: "));
@@ -130,8 +140,13 @@ bool CaptivePortal::exec(uint16_t duration) {
 
     uint32_t start = millis();
 
+    _scanning = survey && (WiFi.scanNetworks(true, true) == WIFI_SCAN_RUNNING);
+    if (survey && (! _scanning))
+      WiFi.enableSTA(false);
     while ((! duration) || (millis() - start < duration * 1000)) {
       _loop();
+      if (_scanning)
+        checkSurvey();
       if (WiFi.softAPgetStationNum()) {
         start = millis();
 #ifdef USE_LED
@@ -148,6 +163,10 @@ bool CaptivePortal::exec(uint16_t duration) {
 #ifdef USE_LED
     _led->setMode(LED_OFF);
 #endif
+    if (_scanning) { // Portal closed before survey completed
+      WiFi.scanDelete();
+      _scanning = false;
+    }
     _http->close();
     delete _http;
     _http = NULL;
@@ -217,7 +236,56 @@ String CaptivePortal::password() const {
 }
 
 uint8_t CaptivePortal::channel() const {
-  return wifiFindFreeChannel();
+  uint8_t result = cachedChannel();
+
+  _surveyChannel = true;
+
+  return result ? result : 1;
+}
+
+void CaptivePortal::checkSurvey() {
+  int8_t nets = WiFi.scanComplete();
+
+  if (nets == WIFI_SCAN_RUNNING)
+    return;
+  _scanning = false;
+
+  uint8_t best = 0;
+
+  if (nets >= 0) {
+    wifinet_t *list = nets ? (wifinet_t*)malloc(sizeof(wifinet_t) * nets) : NULL;
+
+    if (list || (! nets)) {
+      for (int8_t i = 0; i < nets; ++i) {
+        list[i].channel = WiFi.channel(i);
+        list[i].rssi = WiFi.RSSI(i);
+      }
+      best = bestChannel(list, nets, MAX_WIFI_CHANNEL);
+      if (list)
+        free(list);
+      cacheChannel(best);
+    }
+  }
+  WiFi.scanDelete();
+  WiFi.enableSTA(false);
+#ifdef USE_SERIAL
+  Serial.print(F("Channel survey of "));
+  Serial.print(nets);
+  Serial.print(F(" network(s): "));
+  if (best)
+    Serial.println(best);
+  else
+    Serial.println(F("FAIL!"));
+#endif
+  if (best && (best != _apChannel) && (! WiFi.softAPgetStationNum())) { // Connected clients would be dropped, better channel is used next time
+    if (WiFi.softAP(ssid().c_str(), password().c_str(), best)) {
+      _apChannel = best;
+#ifdef USE_SERIAL
+      Serial.print(F("AP moved to channel "));
+      Serial.println(best);
+#endif
+    }
+  }
 }
 
 #ifdef USE_LED
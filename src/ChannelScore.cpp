@@ -0,0 +1,55 @@
+#include <math.h>
+#include "ChannelScore.h"
+
+static const uint8_t OVERLAP_DISTANCE = 6; // Channels this far apart do not interfere
+
+// Share of power leaking into channel n steps apart, from overlap of 802.11b spectral masks
+static const float OVERLAP[OVERLAP_DISTANCE] PROGMEM = { 1.0, 0.7272, 0.2714, 0.0375, 0.0054, 0.0008 };
+
+static float channelPower(const wifinet_t *nets, uint8_t count, uint8_t channel) { // mW, dBm can not be summed
+  float result = 0;
+
+  for (uint8_t i = 0; i < count; ++i) {
+    uint8_t distance = nets[i].channel > channel ? nets[i].channel - channel : channel - nets[i].channel;
+
+    if (distance < OVERLAP_DISTANCE)
+      result += powf(10, nets[i].rssi / 10.0) * pgm_read_float(&OVERLAP[distance]);
+  }
+
+  return result;
+}
+
+static bool preferredChannel(uint8_t channel) { // Not overlapping each other
+  return (channel == 1) || (channel == 6) || (channel == 11);
+}
+
+int8_t channelInterference(const wifinet_t *nets, uint8_t count, uint8_t channel) {
+  float power = channelPower(nets, count, channel);
+
+  if (power > 0) {
+    float dbm = roundf(10 * log10f(power));
+
+    if (dbm > 127)
+      return 127;
+    if (dbm > CHANNEL_QUIET)
+      return dbm;
+  }
+
+  return CHANNEL_QUIET;
+}
+
+uint8_t bestChannel(const wifinet_t *nets, uint8_t count, uint8_t maxChannel) { // Levels are whole dB, only equal ones tie
+  uint8_t result = 1;
+  int8_t minLevel = channelInterference(nets, count, result);
+
+  for (uint8_t channel = 2; channel <= maxChannel; ++channel) {
+    int8_t level = channelInterference(nets, count, channel);
+
+    if ((level < minLevel) || ((level == minLevel) && preferredChannel(channel) && (! preferredChannel(result)))) {
+      minLevel = level;
+      result = channel;
+    }
+  }
+
+  return result;
+}
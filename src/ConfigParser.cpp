@@ -0,0 +1,497 @@
+#include "ConfigParser.h"
+
+ConfigParser::ConfigParser(BaseConfig *config, bool strict, uint8_t section) : _config(config), _target(NULL), _capacity(0), _length(0), _unicode(0), _index(BaseConfig::ERR_INDEX), _depth(0), _escape(0),
+  _invalid(0), _overflow(false), _inString(false), _blob(false), _secret(false), _schemaKey(false), _strict(strict), _state(PS_START), _error(PARSE_OK) {
+  memset(_seen, 0, sizeof(_seen));
+  _version = strict ? _config->_schema : 0; // Unversioned update is current, unversioned file is oldest
+  if (! _config->sectionRange(section, _first, _count)) {
+    _active = false;
+    _error = PARSE_UPDATE;
+    return;
+  }
+  _active = _config->beginUpdate(); // Values are staged and published by finish()
+  if (! _active)
+    _error = PARSE_UPDATE;
+}
+
+ConfigParser::~ConfigParser() {
+  if (_secret)
+    freeSecret();
+  if (_active)
+    _config->cancelUpdate();
+}
+
+bool ConfigParser::parse(char c) {
+  bool again;
+
+  if (_error != PARSE_OK)
+    return false;
+  do {
+    again = false;
+    switch (_state) {
+      case PS_START:
+        if (c == '{')
+          _state = PS_KEY_OR_END;
+        else if (! isSpace(c))
+          return fail();
+        break;
+      case PS_KEY_OR_END:
+      case PS_KEY_START:
+        if (c == '"') {
+          _length = 0;
+          _overflow = false;
+          _state = PS_KEY;
+        } else if ((c == '}') && (_state == PS_KEY_OR_END))
+          _state = PS_DONE;
+        else if (! isSpace(c))
+          return fail();
+        break;
+      case PS_KEY:
+        if (_escape) {
+          if (! parseEscape(c))
+            return fail();
+        } else if (c == '\\')
+          _escape = 1;
+        else if (c == '"') {
+          keyComplete();
+          _state = PS_COLON;
+        } else
+          putChar(c);
+        break;
+      case PS_COLON:
+        if (c == ':')
+          _state = PS_VALUE;
+        else if (! isSpace(c))
+          return fail();
+        break;
+      case PS_VALUE:
+        _length = 0;
+        _overflow = false;
+        _target = NULL;
+        if (c == '"') {
+          if (_index != BaseConfig::ERR_INDEX) {
+            paramtype_t partype = _config->paramType(_index);
+
+            if (partype == PAR_STR) { // Written in place while parsing
+              _target = (char*)_config->paramPtr(_index);
+              _capacity = _config->paramSize(_index);
+              memset(_target, 0, _capacity);
+            } else if (partype == PAR_PSWD) { // Plain, masked or sealed, see BaseConfig::setPassword()
+              _capacity = BaseConfig::sealedLength(_config->paramSize(_index)) + 1;
+              _target = (char*)malloc(_capacity);
+              if (_target) {
+                memset(_target, 0, _capacity);
+                _secret = true;
+              }
+            } else if (partype == PAR_BLOB) { // Base64 decoded in place while parsing
+              memset(_config->paramPtr(_index), 0, _config->paramSize(_index));
+              _quad = 0;
+              _quadLen = 0;
+              _blob = true;
+            }
+          }
+          _state = PS_STRING;
+        } else if ((c == '-') || ((c >= '0') && (c <= '9'))) {
+          putChar(c);
+          _state = PS_NUMBER;
+        } else if ((c == 't') || (c == 'f') || (c == 'n')) {
+          putChar(c);
+          _state = PS_LITERAL;
+        } else if ((c == '[') && (_index != BaseConfig::ERR_INDEX) && (_config->paramType(_index) == PAR_ARRAY)) {
+          memset(_config->paramPtr(_index), 0, _config->paramSize(_index));
+          _item = 0;
+          _state = PS_ARRAY;
+        } else if ((c == '{') || (c == '[')) {
+          if (_index != BaseConfig::ERR_INDEX) {
+            _config->paramError(_index, PARERR_FORMAT);
+            ++_invalid;
+          }
+          _depth = 1;
+          _inString = false;
+          _state = PS_SKIP;
+        } else if (! isSpace(c))
+          return fail();
+        break;
+      case PS_STRING:
+        if (_escape) {
+          if (! parseEscape(c))
+            return fail();
+        } else if (c == '\\')
+          _escape = 1;
+        else if (c == '"') {
+          valueComplete(true);
+          _state = PS_AFTER_VALUE;
+        } else
+          putChar(c);
+        break;
+      case PS_NUMBER:
+      case PS_LITERAL:
+        if (((_state == PS_NUMBER) && (((c >= '0') && (c <= '9')) || (c == '.') || (c == 'e') || (c == 'E') || (c == '+') || (c == '-'))) ||
+          ((_state == PS_LITERAL) && (c >= 'a') && (c <= 'z'))) {
+          putChar(c);
+        } else {
+          _text[_length] = '\0';
+          if ((_state == PS_LITERAL) && (strcmp_P(_text, PSTR("true")) && strcmp_P(_text, PSTR("false")) && strcmp_P(_text, PSTR("null"))))
+            return fail();
+          valueComplete(false);
+          _state = PS_AFTER_VALUE;
+          again = true; // Terminating char belongs to next token
+        }
+        break;
+      case PS_ARRAY:
+        if ((c == ',') || (c == ']')) {
+          if ((c == ',') || _length || _item)
+            itemComplete();
+          if (c == ']') {
+            arrayComplete();
+            _state = PS_AFTER_VALUE;
+          }
+        } else if ((c == '"') || (c == '{') || (c == '[')) { // Only flat arrays of numbers or literals
+          if (_index != BaseConfig::ERR_INDEX) {
+            _config->paramError(_index, PARERR_FORMAT);
+            ++_invalid;
+          }
+          _depth = (c == '"') ? 1 : 2;
+          _inString = (c == '"');
+          _state = PS_SKIP;
+        } else if (! isSpace(c))
+          putChar(c);
+        break;
+      case PS_SKIP:
+        if (_inString) {
+          if (_escape)
+            _escape = 0;
+          else if (c == '\\')
+            _escape = 1;
+          else if (c == '"')
+            _inString = false;
+        } else if (c == '"')
+          _inString = true;
+        else if ((c == '{') || (c == '['))
+          ++_depth;
+        else if ((c == '}') || (c == ']')) {
+          if (! --_depth)
+            _state = PS_AFTER_VALUE;
+        }
+        break;
+      case PS_AFTER_VALUE:
+        if (c == ',')
+          _state = PS_KEY_START;
+        else if (c == '}')
+          _state = PS_DONE;
+        else if (! isSpace(c))
+          return fail();
+        break;
+      case PS_DONE:
+        if ((c != '\0') && (! isSpace(c)))
+          return fail();
+        break;
+    }
+  } while (again);
+
+  return true;
+}
+
+bool ConfigParser::parse(const char *data, size_t length) {
+  while (length--) {
+    if (! parse(*data++))
+      return false;
+  }
+
+  return true;
+}
+
+bool ConfigParser::parse(Stream &stream) {
+  char buf[64];
+  size_t len;
+
+  while ((len = stream.readBytes(buf, sizeof(buf))) > 0) {
+    if (! parse(buf, len))
+      return false;
+  }
+
+  return true;
+}
+
+bool ConfigParser::finish() {
+  if (! _active)
+    return false;
+  _active = false;
+  if ((_error == PARSE_OK) && (_state != PS_DONE))
+    _error = PARSE_INCOMPLETE;
+  if ((_error == PARSE_OK) && _strict && _invalid)
+    _error = PARSE_INVALID;
+  if (_error != PARSE_OK) {
+    _config->cancelUpdate();
+
+    return false;
+  }
+  for (uint8_t i = _first; i < _first + _count; ++i) {
+    if (! (_seen[i / 8] & (1 << (i % 8))))
+      _config->setDefault(i);
+  }
+  if (! _config->commitUpdate())
+    return false;
+  _config->setLoaded(_first, _count);
+
+  return true;
+}
+
+bool ConfigParser::parseEscape(char c) {
+  if (_escape == 1) {
+    _escape = 0;
+    if ((c == '"') || (c == '\\') || (c == '/'))
+      putChar(c);
+    else if (c == 'b')
+      putChar('\b');
+    else if (c == 'f')
+      putChar('\f');
+    else if (c == 'n')
+      putChar('\n');
+    else if (c == 'r')
+      putChar('\r');
+    else if (c == 't')
+      putChar('\t');
+    else if (c == 'u') {
+      _unicode = 0;
+      _escape = 2;
+    } else
+      return false;
+  } else {
+    uint8_t digit;
+
+    if ((c >= '0') && (c <= '9'))
+      digit = c - '0';
+    else if ((c >= 'a') && (c <= 'f'))
+      digit = c - 'a' + 10;
+    else if ((c >= 'A') && (c <= 'F'))
+      digit = c - 'A' + 10;
+    else
+      return false;
+    _unicode = (_unicode << 4) | digit;
+    if (++_escape > 5) {
+      _escape = 0;
+      putUnicode(_unicode);
+    }
+  }
+
+  return true;
+}
+
+void ConfigParser::keyComplete() {
+  _index = BaseConfig::ERR_INDEX;
+  _schemaKey = false;
+  if (! _overflow) {
+    _key[_length] = '\0';
+    if (! strcmp_P(_key, CONFIG_SCHEMA_KEY)) {
+      _schemaKey = true;
+      return;
+    }
+    if (migrating())
+      _index = _config->migrateName(_key, _version);
+    if (_index == BaseConfig::ERR_INDEX)
+      _index = _config->findParam(_key);
+    if ((_index != BaseConfig::ERR_INDEX) && ((_index < _first) || (_index >= _first + _count) ||
+      (! _config->getParamPtr(_index)) || (! _config->paramSize(_index))))
+      _index = BaseConfig::ERR_INDEX;
+  }
+}
+
+void ConfigParser::putChar(char c) {
+  if (_state == PS_KEY) {
+    if (_length < MAX_KEY_LENGTH - 1)
+      _key[_length++] = c;
+    else
+      _overflow = true;
+  } else if (_target) {
+    if (_length < _capacity - 1)
+      _target[_length++] = c; // Silently truncated as before
+  } else if (_blob) {
+    putBase64(c);
+  } else if ((_index != BaseConfig::ERR_INDEX) || _schemaKey) {
+    if (_length < MAX_TEXT_LENGTH - 1)
+      _text[_length++] = c;
+    else
+      _overflow = true;
+  } else if (_state == PS_LITERAL) { // Literal must be validated even for unknown key
+    if (_length < MAX_TEXT_LENGTH - 1)
+      _text[_length++] = c;
+  }
+}
+
+void ConfigParser::putBase64(char c) {
+  int8_t v = base64Value(c);
+
+  if (c == '=') { // Padding, trailing bits are dropped by blobComplete()
+    return;
+  } else if ((v < 0) || (_quadLen > 3)) {
+    _overflow = true;
+    return;
+  }
+  _quad = (_quad << 6) | v;
+  if (++_quadLen == 4) {
+    putByte(_quad >> 16);
+    putByte(_quad >> 8);
+    putByte(_quad);
+    _quad = 0;
+    _quadLen = 0;
+  }
+}
+
+void ConfigParser::putByte(uint8_t b) {
+  if (_length < _config->paramSize(_index))
+    ((uint8_t*)_config->paramPtr(_index))[_length++] = b;
+  else
+    _overflow = true;
+}
+
+void ConfigParser::putUnicode(uint16_t code) {
+  if (code < 0x80)
+    putChar(code);
+  else if (code < 0x800) {
+    putChar(0xC0 | (code >> 6));
+    putChar(0x80 | (code & 0x3F));
+  } else {
+    putChar(0xE0 | (code >> 12));
+    putChar(0x80 | ((code >> 6) & 0x3F));
+    putChar(0x80 | (code & 0x3F));
+  }
+}
+
+void ConfigParser::valueComplete(bool quoted) {
+  if (_schemaKey) {
+    _schemaKey = false;
+    _text[_length] = '\0';
+    if ((! quoted) && (! _overflow))
+      _version = strtoul(_text, NULL, 10);
+    return;
+  }
+  if (_index == BaseConfig::ERR_INDEX) {
+    _blob = false;
+    return;
+  }
+  if (_blob) {
+    _blob = false;
+    blobComplete();
+    return;
+  }
+  if (_target) {
+    bool valid = true;
+
+    if (_secret) {
+      valid = _config->setPassword(_index, _target, _length);
+      freeSecret();
+    }
+    _target = NULL;
+    if (valid && _config->validateParam(_index))
+      markSeen();
+    else
+      ++_invalid;
+    return;
+  }
+
+  paramtype_t partype = _config->paramType(_index);
+  void *value = _config->paramPtr(_index);
+  bool valid;
+
+  if (_overflow) {
+    _config->paramError(_index, PARERR_FORMAT);
+    ++_invalid;
+    return;
+  }
+  _text[_length] = '\0';
+  if ((! quoted) && (! strcmp_P(_text, PSTR("null")))) {
+    _config->setDefault(_index);
+    valid = true;
+  } else if ((partype == PAR_STR) || (partype == PAR_PSWD)) { // Number or literal to string
+    memset(value, 0, _config->paramSize(_index));
+    strncpy((char*)value, _text, _config->paramSize(_index) - 1);
+    valid = _config->validateParam(_index);
+  } else if (partype == PAR_CHAR) {
+    if (quoted)
+      *(char*)value = _text[0];
+    else
+      *(char*)value = strtol(_text, NULL, 10); // Stored as char code
+    valid = _config->validateParam(_index);
+  } else if ((partype == PAR_ARRAY) || (partype == PAR_BLOB)) { // Scalar where array or base64 string expected
+    valid = _config->paramError(_index, PARERR_FORMAT);
+  } else if ((partype == PAR_BOOL) && (! quoted) && (_state == PS_NUMBER)) {
+    *(bool*)value = (strtod(_text, NULL) != 0);
+    valid = true;
+  } else if (migrating()) // Retyped param, value is rounded or clamped to fit
+    valid = _config->convertParam(_index, _text);
+  else
+    valid = _config->setParam(_index, _text);
+  if (valid)
+    markSeen();
+  else
+    ++_invalid; // Keeps default unless strict
+}
+
+void ConfigParser::itemComplete() {
+  if (_index == BaseConfig::ERR_INDEX) // Unknown key or already failed item
+    return;
+
+  paramtype_t itemtype = _config->itemType(_index);
+  uint8_t itemsize = paramItemSize(itemtype);
+  paramerror_t error;
+
+  _text[_length] = '\0';
+  if (_overflow || (! _length))
+    error = PARERR_FORMAT;
+  else if (_item >= _config->itemCount(_index))
+    error = migrating() ? PARERR_OK : PARERR_RANGE; // Extra items of shrunk array are dropped
+  else if (migrating())
+    error = BaseConfig::convertItem((uint8_t*)_config->paramPtr(_index) + _item++ * itemsize, itemtype, _text);
+  else
+    error = BaseConfig::parseItem((uint8_t*)_config->paramPtr(_index) + _item++ * itemsize, itemtype, _text);
+  _length = 0;
+  _overflow = false;
+  if (error != PARERR_OK) {
+    _config->paramError(_index, error);
+    ++_invalid;
+    _index = BaseConfig::ERR_INDEX; // Rest of array is ignored
+  }
+}
+
+void ConfigParser::arrayComplete() {
+  if (_index == BaseConfig::ERR_INDEX)
+    return;
+  if (_config->validateParam(_index))
+    markSeen();
+  else
+    ++_invalid;
+}
+
+void ConfigParser::blobComplete() {
+  if ((! _overflow) && (_quadLen == 1))
+    _overflow = true;
+  if ((! _overflow) && _quadLen) { // 2 or 3 chars encode 1 or 2 bytes
+    _quad <<= 6 * (4 - _quadLen);
+    putByte(_quad >> 16);
+    if (_quadLen == 3)
+      putByte(_quad >> 8);
+  }
+  if (_overflow) {
+    _config->paramError(_index, PARERR_FORMAT);
+    ++_invalid;
+  } else
+    markSeen();
+}
+
+void ConfigParser::freeSecret() {
+  memset(_target, 0, _capacity);
+  free(_target);
+  _target = NULL;
+  _secret = false;
+}
+
+void ConfigParser::markSeen() {
+  _seen[_index / 8] |= (1 << (_index % 8));
+}
+
+bool ConfigParser::fail() {
+  _error = PARSE_SYNTAX;
+
+  return false;
+}
@@ -0,0 +1,107 @@
+#include <Arduino.h>
+#include "Customization.h"
+#include "HeapTrace.h"
+
+#ifdef USE_HEAPTRACE
+static heaptrace_t current;
+static uint32_t startFree;
+static uint32_t minFree;
+static bool tracing = false;
+static heaprequest_t history[HEAPTRACE_HISTORY];
+static uint8_t historyNext = 0;
+static uint8_t historyCount = 0;
+
+static void traceAlloc(size_t size) {
+  if (tracing) {
+    uint32_t free = ESP.getFreeHeap();
+
+    ++current.allocs;
+    current.bytes += size;
+    if (free < minFree)
+      minFree = free;
+  }
+}
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size) {
+  void *result = __real_malloc(size);
+
+  if (result)
+    traceAlloc(size);
+
+  return result;
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  void *result = __real_calloc(count, size);
+
+  if (result)
+    traceAlloc(count * size);
+
+  return result;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  void *result = __real_realloc(ptr, size);
+
+  if (result && size)
+    traceAlloc(size);
+
+  return result;
+}
+
+void __wrap_free(void *ptr) {
+  __real_free(ptr);
+  if (tracing && ptr)
+    ++current.frees;
+}
+}
+
+void heapTraceBegin() {
+  memset(&current, 0, sizeof(current));
+  startFree = ESP.getFreeHeap();
+  minFree = startFree;
+  tracing = true;
+}
+
+void heapTraceEnd(heaptrace_t &trace) {
+  tracing = false;
+  current.peak = startFree - minFree;
+  current.retained = (int32_t)startFree - (int32_t)ESP.getFreeHeap();
+  trace = current;
+}
+
+void heapTraceRecord(const char *method, const char *uri, const heaptrace_t &trace) {
+  heaprequest_t &request = history[historyNext];
+
+  request.time = millis();
+  request.trace = trace;
+  snprintf_P(request.route, sizeof(request.route), PSTR("%s %s"), method, uri);
+  for (char *c = request.route; *c; ++c) { // Safe to output as JSON string
+    if ((*c < ' ') || (*c == '"') || (*c == '\\'))
+      *c = '_';
+  }
+  if (++historyNext >= HEAPTRACE_HISTORY)
+    historyNext = 0;
+  if (historyCount < HEAPTRACE_HISTORY)
+    ++historyCount;
+}
+
+const heaprequest_t *heapTraceRequest(uint8_t index) {
+  if (index >= historyCount)
+    return NULL;
+
+  return &history[(historyNext + HEAPTRACE_HISTORY - 1 - index) % HEAPTRACE_HISTORY];
+}
+#else
+void heapTraceBegin() {}
+
+void heapTraceEnd(heaptrace_t &trace) {
+  memset(&trace, 0, sizeof(trace));
+}
+#endif
@@ -1,169 +1,346 @@
+#include <StreamString.h>
 #include "HtmlHelper.h"
 
-String tagOpen(const String &tagName, const String &tagOptions, bool nl) {
-  String result;
+void HtmlWriter::tagOpen(const char *tagName, const char *tagOptions, bool nl) {
+  write('<');
+  print(tagName);
+  write(' ');
+  print(tagOptions);
+  write('>');
+  if (nl)
+    write('\n');
+}
+
+void HtmlWriter::tagOpen(const char *tagName, bool nl) {
+  write('<');
+  print(tagName);
+  write('>');
+  if (nl)
+    write('\n');
+}
+
+void HtmlWriter::tagClose(const char *tagName, bool nl) {
+  print(F("</"));
+  print(tagName);
+  write('>');
+  if (nl)
+    write('\n');
+}
+
+void HtmlWriter::tag(const char *tagName, const char *tagOptions, const char *tagValue, bool nl) {
+  tagOpen(tagName, tagOptions);
+  print(tagValue);
+  tagClose(tagName, nl);
+}
+
+void HtmlWriter::tag(const char *tagName, const char *tagValue, bool nl) {
+  tagOpen(tagName);
+  print(tagValue);
+  tagClose(tagName, nl);
+}
+
+void HtmlWriter::tag(const char *tagName, bool nl) {
+  write('<');
+  print(tagName);
+  print(F("/>"));
+  if (nl)
+    write('\n');
+}
+
+void HtmlWriter::tagOpen_P(PGM_P tagName, const char *tagOptions, bool nl) {
+  write('<');
+  print(FPSTR(tagName));
+  write(' ');
+  print(tagOptions);
+  write('>');
+  if (nl)
+    write('\n');
+}
+
+void HtmlWriter::tagOpen_P(PGM_P tagName, const __FlashStringHelper *tagOptions, bool nl) {
+  write('<');
+  print(FPSTR(tagName));
+  write(' ');
+  print(tagOptions);
+  write('>');
+  if (nl)
+    write('\n');
+}
+
+void HtmlWriter::tagOpen_P(PGM_P tagName, bool nl) {
+  write('<');
+  print(FPSTR(tagName));
+  write('>');
+  if (nl)
+    write('\n');
+}
+
+void HtmlWriter::tagClose_P(PGM_P tagName, bool nl) {
+  print(F("</"));
+  print(FPSTR(tagName));
+  write('>');
+  if (nl)
+    write('\n');
+}
+
+void HtmlWriter::tag_P(PGM_P tagName, const char *tagOptions, const char *tagValue, bool nl) {
+  tagOpen_P(tagName, tagOptions);
+  print(tagValue);
+  tagClose_P(tagName, nl);
+}
 
-  result = '<';
-  result += tagName;
-  result += ' ';
-  result += tagOptions;
-  result += '>';
+void HtmlWriter::tag_P(PGM_P tagName, const char *tagValue, bool nl) {
+  tagOpen_P(tagName);
+  print(tagValue);
+  tagClose_P(tagName, nl);
+}
+
+void HtmlWriter::tag_P(PGM_P tagName, const __FlashStringHelper *tagValue, bool nl) {
+  tagOpen_P(tagName);
+  print(tagValue);
+  tagClose_P(tagName, nl);
+}
+
+void HtmlWriter::tag_P(PGM_P tagName, bool nl) {
+  write('<');
+  print(FPSTR(tagName));
+  print(F("/>"));
   if (nl)
-    result += '\n';
+    write('\n');
+}
+
+void HtmlWriter::attr(const char *attrName, const char *attrValue) {
+  write(' ');
+  print(attrName);
+  print(F("=\""));
+  escape(attrValue);
+  write('"');
+}
+
+void HtmlWriter::attr_P(PGM_P attrName, const char *attrValue) {
+  write(' ');
+  print(FPSTR(attrName));
+  print(F("=\""));
+  escape(attrValue);
+  write('"');
+}
+
+void HtmlWriter::escape(const char *str) {
+  while (*str) {
+    escape(*str++);
+  }
+}
+
+void HtmlWriter::escape_P(PGM_P str) {
+  char c;
+
+  while ((c = pgm_read_byte(str++))) {
+    escape(c);
+  }
+}
+
+void HtmlWriter::escape(char c) {
+  if (c == '&')
+    print(F("&amp;"));
+  else if (c == '<')
+    print(F("&lt;"));
+  else if (c == '>')
+    print(F("&gt;"));
+  else if (c == '"')
+    print(F("&quot;"));
+  else if (c == '\'')
+    print(F("&#39;"));
+  else
+    write(c);
+}
+
+static const uint8_t TEMPLATE_BUFFER = 64;
+
+static void templateChar(Print &out, char *buf, uint8_t &len, char c) {
+  if (len >= TEMPLATE_BUFFER) {
+    out.write((const uint8_t*)buf, len);
+    len = 0;
+  }
+  buf[len++] = c;
+}
+
+void renderTemplate(Print &out, PGM_P tmpl, templatecb_t callback, void *arg) {
+  enum : uint8_t { TS_TEXT, TS_OPEN, TS_NAME, TS_CLOSE };
+
+  const uint32_t *word = (const uint32_t*)((uintptr_t)tmpl & ~3); // Flash is read by aligned words only
+  uint8_t skip = (uintptr_t)tmpl & 3;
+  char buf[TEMPLATE_BUFFER];
+  char name[TEMPLATE_NAME_LENGTH + 1];
+  uint8_t len = 0;
+  uint8_t nameLen = 0;
+  uint8_t state = TS_TEXT;
+
+  for (;;) {
+    uint32_t data = pgm_read_dword(word++) >> (skip * 8);
+
+    for (uint8_t i = skip; i < 4; ++i, data >>= 8) {
+      char c = data & 0xFF;
+
+      if (! c) {
+        if (state == TS_OPEN)
+          templateChar(out, buf, len, '{');
+        if (len)
+          out.write((const uint8_t*)buf, len);
+        return;
+      }
+      if (state == TS_TEXT) {
+        if (c == '{')
+          state = TS_OPEN;
+        else
+          templateChar(out, buf, len, c);
+      } else if (state == TS_OPEN) {
+        if (c == '{') {
+          state = TS_NAME;
+          nameLen = 0;
+        } else {
+          state = TS_TEXT;
+          templateChar(out, buf, len, '{');
+          templateChar(out, buf, len, c);
+        }
+      } else if (c == '}') {
+        if (state == TS_CLOSE) {
+          if (len) {
+            out.write((const uint8_t*)buf, len);
+            len = 0;
+          }
+          name[nameLen] = '\0';
+          if (callback)
+            callback(out, name, arg);
+          state = TS_TEXT;
+        } else
+          state = TS_CLOSE;
+      } else if (nameLen < TEMPLATE_NAME_LENGTH) {
+        name[nameLen++] = c;
+        state = TS_NAME;
+      }
+    }
+    skip = 0;
+  }
+}
+
+String tagOpen(const String &tagName, const String &tagOptions, bool nl) {
+  StreamString result;
+
+  HtmlWriter(result).tagOpen(tagName.c_str(), tagOptions.c_str(), nl);
 
   return result;
 }
 
 String tagOpen(const String &tagName, bool nl) {
-  String result;
+  StreamString result;
 
-  result = '<';
-  result += tagName;
-  result += '>';
-  if (nl)
-    result += '\n';
+  HtmlWriter(result).tagOpen(tagName.c_str(), nl);
 
   return result;
 }
 
 String tagClose(const String &tagName, bool nl) {
-  String result;
+  StreamString result;
 
-  result = F("</");
-  result += tagName;
-  result += '>';
-  if (nl)
-    result += '\n';
+  HtmlWriter(result).tagClose(tagName.c_str(), nl);
 
   return result;
 }
 
 String tag(const String &tagName, const String &tagOptions, const String &tagValue, bool nl) {
-  String result;
-
-  result = '<';
-  result += tagName;
-  result += ' ';
-  result += tagOptions;
-  result += '>';
-  result += tagValue;
-  result += F("</");
-  result += tagName;
-  result += '>';
-  if (nl)
-    result += '\n';
+  StreamString result;
+
+  HtmlWriter(result).tag(tagName.c_str(), tagOptions.c_str(), tagValue.c_str(), nl);
 
   return result;
 }
 
 String tag(const String &tagName, const String &tagValue, bool nl) {
-  String result;
-
-  result = '<';
-  result += tagName;
-  result += '>';
-  result += tagValue;
-  result += F("</");
-  result += tagName;
-  result += '>';
-  if (nl)
-    result += '\n';
+  StreamString result;
+
+  HtmlWriter(result).tag(tagName.c_str(), tagValue.c_str(), nl);
 
   return result;
 }
 
 String tag(const String &tagName, bool nl) {
-  String result;
+  StreamString result;
 
-  result = '<';
-  result += tagName;
-  result += F("/>");
-  if (nl)
-    result += '\n';
+  HtmlWriter(result).tag(tagName.c_str(), nl);
 
   return result;
 }
 
 String tagOpen_P(PGM_P tagName, const String &tagOptions, bool nl) {
-  String result;
+  StreamString result;
 
-  result = '<';
-  result += FPSTR(tagName);
-  result += ' ';
-  result += tagOptions;
-  result += '>';
-  if (nl)
-    result += '\n';
+  HtmlWriter(result).tagOpen_P(tagName, tagOptions.c_str(), nl);
 
   return result;
 }
 
 String tagOpen_P(PGM_P tagName, bool nl) {
-  String result;
+  StreamString result;
 
-  result = '<';
-  result += FPSTR(tagName);
-  result += '>';
-  if (nl)
-    result += '\n';
+  HtmlWriter(result).tagOpen_P(tagName, nl);
 
   return result;
 }
 
 String tagClose_P(PGM_P tagName, bool nl) {
-  String result;
+  StreamString result;
 
-  result = F("</");
-  result += FPSTR(tagName);
-  result += '>';
-  if (nl)
-    result += '\n';
+  HtmlWriter(result).tagClose_P(tagName, nl);
 
   return result;
 }
 
 String tag_P(PGM_P tagName, const String &tagOptions, const String &tagValue, bool nl) {
-  String result;
-
-  result = '<';
-  result += FPSTR(tagName);
-  result += ' ';
-  result += tagOptions;
-  result += '>';
-  result += tagValue;
-  result += F("</");
-  result += FPSTR(tagName);
-  result += '>';
-  if (nl)
-    result += '\n';
+  StreamString result;
+
+  HtmlWriter(result).tag_P(tagName, tagOptions.c_str(), tagValue.c_str(), nl);
 
   return result;
 }
 
 String tag_P(PGM_P tagName, const String &tagValue, bool nl) {
-  String result;
-
-  result = '<';
-  result += FPSTR(tagName);
-  result += '>';
-  result += tagValue;
-  result += F("</");
-  result += FPSTR(tagName);
-  result += '>';
-  if (nl)
-    result += '\n';
+  StreamString result;
+
+  HtmlWriter(result).tag_P(tagName, tagValue.c_str(), nl);
 
   return result;
 }
 
 String tag_P(PGM_P tagName, bool nl) {
-  String result;
+  StreamString result;
 
-  result = '<';
-  result += FPSTR(tagName);
-  result += F("/>");
-  if (nl)
-    result += '\n';
+  HtmlWriter(result).tag_P(tagName, nl);
 
   return result;
 }
+
+String escapeHtml(const char *str) {
+  StreamString result;
+
+  HtmlWriter(result).escape(str);
+
+  return result;
+}
+
+String &PageBuilder::begin(size_t capacity) {
+  _page.remove(0);
+  if ((capacity > _capacity) && _page.reserve(capacity))
+    _capacity = capacity;
+
+  return _page;
+}
+
+void PageBuilder::end() {
+  if (_page.length() > _capacity) // Grew over estimate
+    _capacity = _page.length();
+  if (_capacity > KEEP_CAPACITY) {
+    _page = String();
+    _capacity = 0;
+  } else
+    _page.remove(0);
+}
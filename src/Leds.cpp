@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #include "Leds.h"
+#include "Metrics.h"
 
 #ifdef ONE_LED
 Led::Led(uint8_t pin, bool level) {
@@ -11,6 +12,8 @@ Led::Led(uint8_t pin, bool level) {
 }
 
 void Led::update(bool force) {
+  METRIC_SCOPE(MET_LED_UPDATE);
+
   if (force || (_item.mode > LED_ON)) {
     if (_item.mode == LED_OFF) {
       off();
@@ -125,6 +128,8 @@ ledmode_t Leds::getMode(uint8_t index) const {
   if (_items && (index < _count)) {
     return _items[index].mode;
   }
+
+  return LED_OFF;
 }
 
 void Leds::setMode(uint8_t index, ledmode_t mode) {
@@ -135,6 +140,8 @@ void Leds::setMode(uint8_t index, ledmode_t mode) {
 }
 
 void Leds::update(uint8_t index, bool force) {
+  METRIC_SCOPE(MET_LED_UPDATE);
+
   if (_items) {
     uint8_t i;
 
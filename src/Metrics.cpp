@@ -0,0 +1,220 @@
+#include "Metrics.h"
+
+#ifdef USE_METRICS
+struct __packed histogram_t {
+  uint32_t buckets[METRIC_BUCKETS + 1]; // Not cumulative
+  uint64_t sum; // us
+  uint32_t count;
+  uint32_t max; // us
+};
+
+static const uint32_t BUCKET_BOUNDS[METRIC_BUCKETS] PROGMEM = { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000 }; // us
+static const char BUCKET_LABELS[METRIC_BUCKETS][8] PROGMEM = { "0.0001", "0.00025", "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "1" }; // seconds
+
+static const char METRIC_NAMES[MET_HTTP_FIRST + 1][26] PROGMEM = { "loop_duration", "led_update_duration", "config_save_duration", "http_request_duration" };
+static const char HTTP_ROUTES[METRIC_COUNT - MET_HTTP_FIRST][2][12] PROGMEM = { { "GET", "*" }, { "GET", "/styles.css" },
+  { "GET", "/script.js" }, { "GET", "/" }, { "GET", "/setup" }, { "GET", "/config" }, { "POST", "/config" }, { "GET", "/api/config" },
+  { "POST", "/api/config" }, { "DELETE", "/config" }, { "GET", "/restart" }, { "GET", "/spiffs" }, { "POST", "/spiffs" },
+  { "DELETE", "/spiffs" }, { "GET", "/fwupdate" }, { "POST", "/fwupdate" }, { "GET", "/bundle" }, { "POST", "/bundle" },
+  { "GET", "/metrics" }, { "GET", "/heaptrace" } }; // (metric_t - MET_HTTP_FIRST) as index
+
+static histogram_t histograms[METRIC_COUNT];
+static uint32_t minFreeHeap = 0xFFFFFFFF;
+
+void metricObserve(uint8_t metric, uint32_t us) {
+  if (metric >= METRIC_COUNT)
+    return;
+
+  histogram_t &h = histograms[metric];
+  uint8_t bucket = 0;
+
+  while ((bucket < METRIC_BUCKETS) && (us > pgm_read_dword(&BUCKET_BOUNDS[bucket])))
+    ++bucket;
+  ++h.buckets[bucket];
+  h.sum += us;
+  ++h.count;
+  if (us > h.max)
+    h.max = us;
+  if (metric >= MET_HTTP_FIRST) { // Sampled after handlers only, free heap is not free to query on every loop
+    uint32_t free = ESP.getFreeHeap();
+
+    if (free < minFreeHeap)
+      minFreeHeap = free;
+  }
+}
+
+void metricsReset() {
+  memset(histograms, 0, sizeof(histograms));
+  minFreeHeap = 0xFFFFFFFF;
+}
+
+static void appendSeconds(String &str, uint64_t us) { // Fixed point, float has too few digits for sums
+  char frac[8];
+
+  str += String((uint32_t)(us / 1000000));
+  sprintf_P(frac, PSTR(".%06u"), (uint32_t)(us % 1000000));
+  str += frac;
+}
+
+static void appendName(String &str, uint8_t metric, PGM_P suffix) {
+  str += F("esp_");
+  str += FPSTR(METRIC_NAMES[metric < MET_HTTP_FIRST ? metric : MET_HTTP_FIRST]);
+  str += F("_seconds");
+  str += FPSTR(suffix);
+}
+
+static void appendLabels(String &str, uint8_t metric, PGM_P le) {
+  bool route = metric >= MET_HTTP_FIRST;
+
+  if ((! route) && (! le))
+    return;
+  str += '{';
+  if (route) {
+    str += F("method=\"");
+    str += FPSTR(HTTP_ROUTES[metric - MET_HTTP_FIRST][0]);
+    str += F("\",route=\"");
+    str += FPSTR(HTTP_ROUTES[metric - MET_HTTP_FIRST][1]);
+    str += '"';
+    if (le)
+      str += ',';
+  }
+  if (le) {
+    str += F("le=\"");
+    str += FPSTR(le);
+    str += '"';
+  }
+  str += '}';
+}
+
+bool metricToPrometheus(String &str, uint8_t metric) {
+  if (metric >= METRIC_COUNT)
+    return false;
+
+  const histogram_t &h = histograms[metric];
+
+  if (metric <= MET_HTTP_FIRST) { // First of family
+    str += F("# TYPE ");
+    appendName(str, metric, PSTR(""));
+    str += F(" histogram\n");
+  }
+  if ((metric >= MET_HTTP_FIRST) && (! h.count))
+    return false;
+
+  uint32_t cumulative = 0;
+
+  for (uint8_t i = 0; i <= METRIC_BUCKETS; ++i) {
+    cumulative += h.buckets[i];
+    appendName(str, metric, PSTR("_bucket"));
+    appendLabels(str, metric, i < METRIC_BUCKETS ? BUCKET_LABELS[i] : PSTR("+Inf"));
+    str += ' ';
+    str += String(cumulative);
+    str += '\n';
+  }
+  appendName(str, metric, PSTR("_sum"));
+  appendLabels(str, metric, NULL);
+  str += ' ';
+  appendSeconds(str, h.sum);
+  str += '\n';
+  appendName(str, metric, PSTR("_count"));
+  appendLabels(str, metric, NULL);
+  str += ' ';
+  str += String(h.count);
+  str += '\n';
+
+  return true;
+}
+
+bool metricToJson(String &str, uint8_t metric) { // {"n":"...","c":count,"s":sum,"mx":max,"b":[...]}, times in us
+  if (metric >= METRIC_COUNT)
+    return false;
+
+  const histogram_t &h = histograms[metric];
+
+  if ((metric >= MET_HTTP_FIRST) && (! h.count))
+    return false;
+  if (metric) // MET_LOOP is always first
+    str += ',';
+  str += F("{\"n\":\"");
+  if (metric < MET_HTTP_FIRST) {
+    str += FPSTR(METRIC_NAMES[metric]);
+  } else {
+    str += FPSTR(HTTP_ROUTES[metric - MET_HTTP_FIRST][0]);
+    str += ' ';
+    str += FPSTR(HTTP_ROUTES[metric - MET_HTTP_FIRST][1]);
+  }
+  str += F("\",\"c\":");
+  str += String(h.count);
+  str += F(",\"s\":");
+  if (h.sum >= 1000000) {
+    char buf[22];
+
+    sprintf_P(buf, PSTR("%u%06u"), (uint32_t)(h.sum / 1000000), (uint32_t)(h.sum % 1000000));
+    str += buf;
+  } else {
+    str += String((uint32_t)h.sum);
+  }
+  str += F(",\"mx\":");
+  str += String(h.max);
+  str += F(",\"b\":[");
+  for (uint8_t i = 0; i <= METRIC_BUCKETS; ++i) {
+    if (i)
+      str += ',';
+    str += String(h.buckets[i]);
+  }
+  str += F("]}");
+
+  return true;
+}
+
+static void getHeap(uint32_t &free, uint32_t &block, uint8_t &frag) {
+  free = ESP.getFreeHeap();
+#ifdef ESP32
+  block = ESP.getMaxAllocHeap();
+  frag = free ? 100 - block * 100 / free : 0;
+#else
+  block = ESP.getMaxFreeBlockSize();
+  frag = ESP.getHeapFragmentation();
+#endif
+}
+
+void heapToPrometheus(String &str) {
+  uint32_t free, block;
+  uint8_t frag;
+
+  getHeap(free, block, frag);
+  str += F("# TYPE esp_heap_free_bytes gauge\n"
+    "esp_heap_free_bytes ");
+  str += String(free);
+  str += F("\n# TYPE esp_heap_min_free_bytes gauge\n"
+    "esp_heap_min_free_bytes ");
+  str += String(minFreeHeap < free ? minFreeHeap : free);
+  str += F("\n# TYPE esp_heap_max_block_bytes gauge\n"
+    "esp_heap_max_block_bytes ");
+  str += String(block);
+  str += F("\n# TYPE esp_heap_fragmentation_percent gauge\n"
+    "esp_heap_fragmentation_percent ");
+  str += String(frag);
+  str += F("\n# TYPE esp_uptime_seconds counter\n"
+    "esp_uptime_seconds ");
+  str += String(millis() / 1000);
+  str += '\n';
+}
+
+void heapToJson(String &str) { // "uptime":...,"heap":{...}
+  uint32_t free, block;
+  uint8_t frag;
+
+  getHeap(free, block, frag);
+  str += F("\"uptime\":");
+  str += String(millis() / 1000);
+  str += F(",\"heap\":{\"free\":");
+  str += String(free);
+  str += F(",\"min\":");
+  str += String(minFreeHeap < free ? minFreeHeap : free);
+  str += F(",\"block\":");
+  str += String(block);
+  str += F(",\"frag\":");
+  str += String(frag);
+  str += '}';
+}
+#endif
@@ -0,0 +1,45 @@
+#include <Arduino.h>
+#include "Customization.h"
+#include "ScratchPool.h"
+
+#ifdef USE_SCRATCH_POOL
+static uint8_t *buffers[SCRATCH_COUNT];
+static uint8_t used = 0; // Bitmap of checked out buffers
+
+bool scratchBegin() {
+  for (uint8_t i = 0; i < SCRATCH_COUNT; ++i) {
+    if (! buffers[i]) {
+      buffers[i] = (uint8_t*)malloc(SCRATCH_SIZE);
+      if (! buffers[i])
+        return false;
+    }
+  }
+
+  return true;
+}
+
+void *scratchAcquire(size_t size) {
+  if (size <= SCRATCH_SIZE) {
+    for (uint8_t i = 0; i < SCRATCH_COUNT; ++i) {
+      if (buffers[i] && (! (used & (1 << i)))) {
+        used |= 1 << i;
+        return buffers[i];
+      }
+    }
+  }
+#ifdef USE_SERIAL
+  Serial.println(F("Scratch pool exhausted!"));
+#endif
+
+  return NULL;
+}
+
+void scratchRelease(void *buf) {
+  for (uint8_t i = 0; i < SCRATCH_COUNT; ++i) {
+    if (buffers[i] == buf) {
+      used &= ~(1 << i);
+      break;
+    }
+  }
+}
+#endif
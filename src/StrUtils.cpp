@@ -2,103 +2,284 @@
 #include <stdlib.h>
 #include "StrUtils.h"
 
-bool allocStr(char **str, const char *src) {
-  if (src && *src) {
-    if (*str) {
-      void *ptr = realloc(*str, strlen(src) + 1);
+static const uint8_t STR_CLASSES = 3; // Slots of 8, 16 and 32 bytes
+static const uint8_t STR_SLOTS = 16; // Per slab, bits of strslab_t::used
+static const uint8_t STR_OWN = 0xFF; // Header of longer string allocated on its own
 
-      if (! ptr)
-        return false;
-      *str = (char*)ptr;
-    } else {
-      *str = (char*)malloc(strlen(src) + 1);
-      if (! *str)
-        return false;
+struct strslab_t { // Followed by STR_SLOTS slots of header byte (size class) and string
+  strslab_t *next;
+  uint16_t used;
+};
+
+static strslab_t *strSlabs[STR_CLASSES];
+
+static inline uint8_t slotSize(uint8_t cls) {
+  return 8 << cls;
+}
+
+static char *strAlloc(size_t len) {
+  char *result;
+
+  for (uint8_t cls = 0; cls < STR_CLASSES; ++cls) {
+    if (len + 2 <= slotSize(cls)) {
+      strslab_t *slab = strSlabs[cls];
+      uint8_t slot = 0;
+
+      while (slab && (slab->used == 0xFFFF))
+        slab = slab->next;
+      if (! slab) {
+        slab = (strslab_t*)malloc(sizeof(strslab_t) + slotSize(cls) * STR_SLOTS);
+        if (! slab)
+          return NULL;
+        slab->used = 0;
+        slab->next = strSlabs[cls];
+        strSlabs[cls] = slab;
+      }
+      while (slab->used & (1 << slot))
+        ++slot;
+      slab->used |= 1 << slot;
+      result = (char*)(slab + 1) + slot * slotSize(cls);
+      *result = cls;
+      return result + 1;
     }
-    strcpy(*str, src);
-  } else {
-    if (*str) {
-      free(*str);
-      *str = NULL;
+  }
+  result = (char*)malloc(len + 2);
+  if (! result)
+    return NULL;
+  *result = STR_OWN;
+
+  return result + 1;
+}
+
+static void strFree(char *str) {
+  uint8_t cls = *--str;
+
+  if (cls == STR_OWN) {
+    free(str);
+    return;
+  }
+
+  strslab_t **prev = &strSlabs[cls];
+
+  while (*prev) {
+    strslab_t *slab = *prev;
+    char *slots = (char*)(slab + 1);
+
+    if ((str >= slots) && (str < slots + slotSize(cls) * STR_SLOTS)) {
+      slab->used &= ~(1 << ((str - slots) >> (cls + 3)));
+      if (! slab->used) { // Empty slabs go back to heap
+        *prev = slab->next;
+        free(slab);
+      }
+      return;
     }
+    prev = &slab->next;
+  }
+}
+
+static bool strStore(char **str, size_t len) { // Room for len chars and NUL, content is undefined
+  if (*str) {
+    uint8_t cls = (*str)[-1];
+
+    if (cls == STR_OWN) {
+      if (len + 2 > slotSize(STR_CLASSES - 1)) {
+        void *ptr = realloc(*str - 1, len + 2);
+
+        if (! ptr)
+          return false;
+        *str = (char*)ptr + 1;
+        return true;
+      }
+    } else if (len + 2 <= slotSize(cls))
+      return true;
+
+    char *ptr = strAlloc(len);
+
+    if (! ptr)
+      return false;
+    strFree(*str);
+    *str = ptr;
+  } else {
+    *str = strAlloc(len);
+    if (! *str)
+      return false;
   }
 
   return true;
 }
 
+bool allocStr(char **str, const char *src) {
+  if (src && *src) {
+    if (! strStore(str, strlen(src)))
+      return false;
+    strcpy(*str, src);
+  } else
+    disposeStr(str);
+
+  return true;
+}
+
 bool allocStr_P(char **str, PGM_P src) {
   if (src && pgm_read_byte(src)) {
-    if (*str) {
-      void *ptr = realloc(*str, strlen_P(src) + 1);
-
-      if (! ptr)
-        return false;
-      *str = (char*)ptr;
-    } else {
-      *str = (char*)malloc(strlen_P(src) + 1);
-      if (! *str)
-        return false;
-    }
+    if (! strStore(str, strlen_P(src)))
+      return false;
     strcpy_P(*str, src);
-  } else {
-    if (*str) {
-      free(*str);
-      *str = NULL;
-    }
-  }
+  } else
+    disposeStr(str);
 
   return true;
 }
 
 void disposeStr(char **str) {
   if (*str) {
-    free(*str);
+    strFree(*str);
     *str = NULL;
   }
 }
 
-int8_t strcmp_PP(PGM_P s1, PGM_P s2) {
-  char c1, c2;
+const char *StrArena::add(const char *str) {
+  return add(str, false);
+}
 
-  do {
-    c1 = pgm_read_byte(s1++);
-    c2 = pgm_read_byte(s2++);
-  } while ((c1 == c2) && (c1 != '\0'));
+const char *StrArena::add_P(PGM_P str) {
+  return add(str, true);
+}
+
+void StrArena::clear() {
+  while (_chunks) {
+    chunk_t *next = _chunks->next;
 
-  return (c1 - c2);
+    free(_chunks);
+    _chunks = next;
+  }
 }
 
-int8_t strncmp_PP(PGM_P s1, PGM_P s2, uint16_t maxlen) {
-  char c1, c2;
+const char *StrArena::add(const char *str, bool progmem) {
+  if (_intern) {
+    for (chunk_t *chunk = _chunks; chunk; chunk = chunk->next) {
+      const char *data = (const char*)(chunk + 1);
 
-  do {
-    c1 = pgm_read_byte(s1++);
-    c2 = pgm_read_byte(s2++);
-  } while ((maxlen--) && (c1 == c2) && (c1 != '\0'));
+      for (uint16_t pos = 0; pos < chunk->used; pos += strlen(&data[pos]) + 1) {
+        if (! (progmem ? strcmp_P(&data[pos], str) : strcmp(&data[pos], str)))
+          return &data[pos];
+      }
+    }
+  }
+
+  uint16_t size = (progmem ? strlen_P(str) : strlen(str)) + 1;
+  char *result;
 
-  return (c1 - c2);
+  if ((! _chunks) || (_chunks->size - _chunks->used < size)) {
+    chunk_t *chunk = (chunk_t*)malloc(sizeof(chunk_t) + (size > CHUNK_SIZE ? size : CHUNK_SIZE));
+
+    if (! chunk)
+      return NULL;
+    chunk->size = size > CHUNK_SIZE ? size : CHUNK_SIZE;
+    if (_chunks && (size > CHUNK_SIZE)) { // Current chunk keeps its spare room
+      chunk->next = _chunks->next;
+      _chunks->next = chunk;
+    } else {
+      chunk->next = _chunks;
+      _chunks = chunk;
+    }
+    result = (char*)(chunk + 1);
+    chunk->used = size;
+  } else {
+    result = (char*)(_chunks + 1) + _chunks->used;
+    _chunks->used += size;
+  }
+  if (progmem)
+    strcpy_P(result, str);
+  else
+    strcpy(result, str);
+
+  return result;
 }
 
-int8_t strcasecmp_PP(PGM_P s1, PGM_P s2) {
-  char c1, c2;
+#define HAS_ZERO_BYTE(w) (((w) - 0x01010101UL) & ~(w) & 0x80808080UL)
 
-  do {
-    c1 = toupper(pgm_read_byte(s1++));
-    c2 = toupper(pgm_read_byte(s2++));
-  } while ((c1 == c2) && (c1 != '\0'));
+static inline uint32_t upperWord(uint32_t w) { // toupper() of 4 chars at once, bytes above 0x7F are unchanged
+  uint32_t low = w & 0x7F7F7F7FUL;
+  uint32_t lower = (low + 0x1F1F1F1FUL) & ~(low + 0x05050505UL) & ~w & 0x80808080UL; // 'a' <= byte <= 'z'
 
-  return (c1 - c2);
+  return w - (lower >> 2);
 }
 
-int8_t strncasecmp_PP(PGM_P s1, PGM_P s2, uint16_t maxlen) {
+static int8_t compare_PP(PGM_P s1, PGM_P s2, uint32_t maxlen, bool nocase) {
   char c1, c2;
 
-  do {
-    c1 = toupper(pgm_read_byte(s1++));
-    c2 = toupper(pgm_read_byte(s2++));
-  } while ((maxlen--) && (c1 == c2) && (c1 != '\0'));
+  while (((uintptr_t)s1 & 0x03) && maxlen) { // Bytes until s1 is word aligned
+    if (nocase) {
+      c1 = toupper(pgm_read_byte(s1++));
+      c2 = toupper(pgm_read_byte(s2++));
+    } else {
+      c1 = pgm_read_byte(s1++);
+      c2 = pgm_read_byte(s2++);
+    }
+    if ((c1 != c2) || (c1 == '\0'))
+      return (c1 - c2);
+    --maxlen;
+  }
+
+  // Words, s2 is assembled from two aligned reads when misaligned to s1
+  const uint32_t *w1 = (const uint32_t*)s1;
+  const uint32_t *w2 = (const uint32_t*)((uintptr_t)s2 & ~0x03);
+  uint8_t shift = ((uintptr_t)s2 & 0x03) * 8;
+  uint32_t next = shift ? pgm_read_dword(w2++) : 0;
+
+  while (maxlen >= 4) {
+    uint32_t v1 = pgm_read_dword(w1);
+    uint32_t v2;
+
+    if (shift) {
+      v2 = next >> shift;
+      if (HAS_ZERO_BYTE(v2 | (0xFFFFFFFFUL << (32 - shift)))) // s2 ends here, next word may be out of string
+        break;
+      next = pgm_read_dword(w2++);
+      v2 |= next << (32 - shift);
+    } else
+      v2 = pgm_read_dword(w2++);
+    if (nocase) {
+      v1 = upperWord(v1);
+      v2 = upperWord(v2);
+    }
+    if ((v1 != v2) || HAS_ZERO_BYTE(v1))
+      break;
+    ++w1;
+    maxlen -= 4;
+  }
+  s2 += (PGM_P)w1 - s1;
+  s1 = (PGM_P)w1;
+
+  while (maxlen--) { // Difference or end is within next 4 bytes or less than a word left
+    if (nocase) {
+      c1 = toupper(pgm_read_byte(s1++));
+      c2 = toupper(pgm_read_byte(s2++));
+    } else {
+      c1 = pgm_read_byte(s1++);
+      c2 = pgm_read_byte(s2++);
+    }
+    if ((c1 != c2) || (c1 == '\0'))
+      return (c1 - c2);
+  }
 
-  return (c1 - c2);
+  return 0;
+}
+
+int8_t strcmp_PP(PGM_P s1, PGM_P s2) {
+  return compare_PP(s1, s2, 0xFFFFFFFFUL, false);
+}
+
+int8_t strncmp_PP(PGM_P s1, PGM_P s2, uint16_t maxlen) {
+  return compare_PP(s1, s2, maxlen, false);
+}
+
+int8_t strcasecmp_PP(PGM_P s1, PGM_P s2) {
+  return compare_PP(s1, s2, 0xFFFFFFFFUL, true);
+}
+
+int8_t strncasecmp_PP(PGM_P s1, PGM_P s2, uint16_t maxlen) {
+  return compare_PP(s1, s2, maxlen, true);
 }
 
 char *byteToHex(char *out, uint8_t value) {
@@ -118,3 +299,196 @@ char *byteToHex(char *out, uint8_t value) {
 
   return out;
 }
+
+static bool escapeMatch(char e, char c) {
+  if (e == 'd')
+    return (c >= '0') && (c <= '9');
+  if (e == 'w')
+    return ((c >= '0') && (c <= '9')) || ((c >= 'A') && (c <= 'Z')) || ((c >= 'a') && (c <= 'z')) || (c == '_');
+  if (e == 's')
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+
+  return (c == e);
+}
+
+static PGM_P patternAtomEnd(PGM_P pattern) {
+  char c = pgm_read_byte(pattern++);
+
+  if (c == '\\') {
+    if (pgm_read_byte(pattern))
+      ++pattern;
+  } else if (c == '[') {
+    while ((c = pgm_read_byte(pattern)) && (c != ']')) {
+      if ((c == '\\') && pgm_read_byte(pattern + 1))
+        ++pattern;
+      ++pattern;
+    }
+    if (c)
+      ++pattern;
+  }
+
+  return pattern;
+}
+
+static bool patternAtomMatch(PGM_P pattern, char c) {
+  char p = pgm_read_byte(pattern);
+
+  if (p == '.')
+    return true;
+  if (p == '\\')
+    return escapeMatch(pgm_read_byte(pattern + 1), c);
+  if (p == '[') {
+    bool negate = false;
+    bool found = false;
+
+    if (pgm_read_byte(++pattern) == '^') {
+      negate = true;
+      ++pattern;
+    }
+    while ((p = pgm_read_byte(pattern)) && (p != ']')) {
+      char last = pgm_read_byte(pattern + 2);
+
+      if (p == '\\') {
+        found |= escapeMatch(pgm_read_byte(pattern + 1), c);
+        pattern += 2;
+      } else if ((pgm_read_byte(pattern + 1) == '-') && last && (last != ']')) {
+        found |= (c >= p) && (c <= last);
+        pattern += 3;
+      } else {
+        found |= (c == p);
+        ++pattern;
+      }
+    }
+
+    return found != negate;
+  }
+
+  return (c == p);
+}
+
+static bool patternMatchHere(const char *str, PGM_P pattern) {
+  if (! pgm_read_byte(pattern))
+    return ! *str;
+
+  PGM_P next = patternAtomEnd(pattern);
+  char q = pgm_read_byte(next);
+
+  if ((q == '*') || (q == '+') || (q == '?')) {
+    uint16_t min = (q == '+') ? 1 : 0;
+    uint16_t max = (q == '?') ? 1 : 0xFFFF;
+    uint16_t count = 0;
+
+    while ((count < max) && str[count] && patternAtomMatch(pattern, str[count])) // Greedy, then backtrack
+      ++count;
+    while (count >= min) {
+      if (patternMatchHere(str + count, next + 1))
+        return true;
+      if (! count--)
+        break;
+    }
+
+    return false;
+  }
+
+  return *str && patternAtomMatch(pattern, *str) && patternMatchHere(str + 1, next);
+}
+
+bool matchPattern_P(const char *str, PGM_P pattern) {
+  return patternMatchHere(str, pattern);
+}
+
+bool matchChoice_P(const char *str, PGM_P choices) {
+  char c;
+
+  do {
+    const char *s = str;
+
+    while (((c = pgm_read_byte(choices)) != '\0') && (c != '|') && (c == *s)) {
+      ++choices;
+      ++s;
+    }
+    if (((c == '\0') || (c == '|')) && (! *s))
+      return true;
+    while (((c = pgm_read_byte(choices)) != '\0') && (c != '|')) // Skip rest of choice
+      ++choices;
+    ++choices;
+  } while (c);
+
+  return false;
+}
+
+static const char BASE64_CHARS[] PROGMEM = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+char *base64Encode(char *out, const uint8_t *data, size_t len) {
+  char *result = out;
+
+  while (len) {
+    uint32_t triple = (uint32_t)data[0] << 16;
+
+    if (len > 1)
+      triple |= (uint32_t)data[1] << 8;
+    if (len > 2)
+      triple |= data[2];
+    *out++ = pgm_read_byte(&BASE64_CHARS[(triple >> 18) & 0x3F]);
+    *out++ = pgm_read_byte(&BASE64_CHARS[(triple >> 12) & 0x3F]);
+    *out++ = (len > 1) ? pgm_read_byte(&BASE64_CHARS[(triple >> 6) & 0x3F]) : '=';
+    *out++ = (len > 2) ? pgm_read_byte(&BASE64_CHARS[triple & 0x3F]) : '=';
+    if (len < 3)
+      break;
+    data += 3;
+    len -= 3;
+  }
+  *out = '\0';
+
+  return result;
+}
+
+int8_t base64Value(char c) {
+  if ((c >= 'A') && (c <= 'Z'))
+    return c - 'A';
+  if ((c >= 'a') && (c <= 'z'))
+    return c - 'a' + 26;
+  if ((c >= '0') && (c <= '9'))
+    return c - '0' + 52;
+  if (c == '+')
+    return 62;
+  if (c == '/')
+    return 63;
+
+  return -1;
+}
+
+int32_t base64Decode(uint8_t *out, size_t size, const char *str) {
+  uint32_t quad = 0;
+  uint8_t count = 0;
+  size_t len = 0;
+
+  for (; *str && (*str != '='); ++str) {
+    int8_t v = base64Value(*str);
+
+    if (v < 0)
+      return -1;
+    quad = (quad << 6) | v;
+    if (++count == 4) {
+      if (len + 3 > size)
+        return -1;
+      out[len++] = quad >> 16;
+      out[len++] = quad >> 8;
+      out[len++] = quad;
+      quad = 0;
+      count = 0;
+    }
+  }
+  if (count == 1)
+    return -1;
+  if (count) { // 2 or 3 chars encode 1 or 2 bytes
+    if (len + count - 1 > size)
+      return -1;
+    quad <<= 6 * (4 - count);
+    out[len++] = quad >> 16;
+    if (count == 3)
+      out[len++] = quad >> 8;
+  }
+
+  return len;
+}
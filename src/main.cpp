@@ -4,6 +4,10 @@
 #include "Leds.h"
 #include "BaseWebServer.h"
 #include "CaptivePortal.h"
+#include "ScratchPool.h"
+#ifdef USE_BENCHMARK
+#include "Benchmark.h"
+#endif
 
 const char WIFI_SSID_PARAM[] PROGMEM = "wifi_ssid";
 const char WIFI_SSID_DESCR[] PROGMEM = "WiFi SSID";
@@ -14,20 +18,32 @@ const char NTP_SERVER_DESCR[] PROGMEM = "NTP server";
 const char NTP_SERVER_DEF[] PROGMEM = "pool.ntp.org";
 const char NTP_TZ_PARAM[] PROGMEM = "ntp_tz";
 const char NTP_TZ_DESCR[] PROGMEM = "NTP time zone";
+const paramlimits_t NTP_TZ_LIMITS PROGMEM = LIMITS_RANGE(-11, 14, 1);
 const char NTP_UPDATE_PARAM[] PROGMEM = "ntp_update";
 const char NTP_UPDATE_DESCR[] PROGMEM = "NTP auto update";
+const char NTP_PREFIX[] PROGMEM = "ntp_";
+
+const char WIFI_SECTION[] PROGMEM = "wifi";
+const char NTP_SECTION[] PROGMEM = "ntp";
 
 const param_t PARAMS[] PROGMEM = {
   PARAM_STR(WIFI_SSID_PARAM, WIFI_SSID_DESCR, 32, NULL),
   PARAM_PSWD(WIFI_PSWD_PARAM, WIFI_PSWD_DESCR, 32, NULL),
   PARAM_STR(NTP_SERVER_PARAM, NTP_SERVER_DESCR, 32, NTP_SERVER_DEF),
-  PARAM_I8(NTP_TZ_PARAM, NTP_TZ_DESCR, 3),
+  PARAM_I8_LIMITS(NTP_TZ_PARAM, NTP_TZ_DESCR, 3, NTP_TZ_LIMITS),
   PARAM_BOOL(NTP_UPDATE_PARAM, NULL, false)
 };
 
+enum { SECTION_WIFI, SECTION_NTP };
+
+const paramsection_t SECTIONS[] PROGMEM = {
+  SECTION(WIFI_SECTION, 2),
+  SECTION(NTP_SECTION, 3)
+};
+
 class Config : public BaseConfig {
 public:
-  Config() : BaseConfig(PARAMS, 5) {}
+  Config() : BaseConfig(PARAMS, 5, SECTIONS, 2) {}
 
   void *getParamPtr(uint8_t index);
 
@@ -58,6 +74,21 @@ void *Config::getParamPtr(uint8_t index) {
 Config *config;
 Led *led;
 BaseWebServer *http;
+volatile bool ntpChanged = false;
+
+void configChanged(uint8_t index, const void *oldValue, const void *newValue, void *arg) {
+  *(volatile bool*)arg = true; // Applied from loop() outside of HTTP handler
+}
+
+void ntpSetup() {
+  config->require(SECTION_NTP); // Loaded on first use
+  if (config->_ntp_update && *config->_ntp_server) {
+    configTime(config->_ntp_tz * 3600, 0, config->_ntp_server);
+    Serial.print(F("NTP server \""));
+    Serial.print(config->_ntp_server);
+    Serial.println('"');
+  }
+}
 
 bool wifiConnect() {
   const uint32_t WIFI_TIMEOUT = 60000;
@@ -110,11 +141,15 @@ void setup() {
     Serial.flush();
     ESP.deepSleep(0);
   }
+  if (! scratchBegin())
+    Serial.println(F("Scratch pool reserve fail!"));
+#ifdef USE_BENCHMARK
+  runBenchmarks(Serial);
+#endif
   config = new Config();
-  if (! config->load()) {
-    config->clear();
+  if (! config->load(SECTION_WIFI)) // Other sections are loaded on demand
     Serial.println(F("Use default config"));
-  }
+  config->subscribe_P(NTP_PREFIX, configChanged, (void*)&ntpChanged);
   led = new Led(LED_BUILTIN, LOW);
 
   {
@@ -127,6 +162,7 @@ void setup() {
 
   http = new BaseWebServer(config);
   http->_setup();
+  ntpSetup();
 }
 
 void loop() {
@@ -135,5 +171,9 @@ void loop() {
   }
   if (WiFi.isConnected())
     http->_loop();
+  if (ntpChanged) {
+    ntpChanged = false;
+    ntpSetup();
+  }
   led->delay(1);
 }
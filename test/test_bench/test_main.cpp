@@ -0,0 +1,58 @@
+#include <Arduino.h>
+#include <FS.h>
+#include <StreamString.h>
+#include <unity.h>
+#include "Benchmark.h"
+#include "HeapTrace.h"
+
+// Host run of config benchmarks (env:native_bench), same CSV lines as on device
+
+static void *volatile traced; // Not optimized out
+
+void setUp() {
+  SPIFFS.format();
+}
+
+void tearDown() {}
+
+static void test_benchmarks() {
+  StreamString out;
+  uint16_t lines = 0;
+  int start = 0, end;
+
+  runBenchmarks(out);
+  while ((end = out.indexOf('\n', start)) >= 0) {
+    String line = out.substring(start, end);
+
+    line.trim();
+    TEST_MESSAGE(line.c_str());
+    TEST_ASSERT_TRUE(line.startsWith("BENCH,"));
+    TEST_ASSERT_LESS_THAN(0, line.indexOf(",FAIL"));
+    TEST_ASSERT_LESS_THAN(0, line.indexOf(",OOM"));
+    ++lines;
+    start = end + 1;
+  }
+  TEST_ASSERT_EQUAL(3 + 4 * 2 * 5 + 2 * 2 + 3 * 2 * 4, lines); // Headers, config paths, seal/open and string compares
+}
+
+static void test_heaptrace() {
+  heaptrace_t trace;
+
+  heapTraceBegin();
+  traced = malloc(100);
+  free(traced);
+  heapTraceEnd(trace);
+  TEST_ASSERT_EQUAL(1, trace.allocs);
+  TEST_ASSERT_EQUAL(1, trace.frees);
+  TEST_ASSERT_EQUAL(100, trace.bytes);
+  TEST_ASSERT_GREATER_OR_EQUAL(100, trace.peak);
+  TEST_ASSERT_EQUAL(0, trace.retained);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_heaptrace);
+  RUN_TEST(test_benchmarks);
+
+  return UNITY_END();
+}
@@ -0,0 +1,122 @@
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <unity.h>
+#include "CaptivePortal.h"
+#include "TestFixture.h"
+
+class TestPortal : public CaptivePortal { // Records AP state while portal runs
+public:
+  TestPortal(const BaseConfig *config, const Led *led) : CaptivePortal(config, led), firstMode(WIFI_OFF), firstChannel(0), lastChannel(0) {}
+
+  void _loop() {
+    if (firstMode == WIFI_OFF) {
+      firstMode = WiFi.getMode();
+      firstChannel = WiFi.nativeApChannel();
+    }
+    lastChannel = WiFi.nativeApChannel();
+    CaptivePortal::_loop();
+  }
+
+  WiFiMode_t firstMode;
+  uint8_t firstChannel;
+  uint8_t lastChannel;
+};
+
+class FixedPortal : public TestPortal {
+public:
+  FixedPortal(const BaseConfig *config, const Led *led) : TestPortal(config, led) {}
+
+  uint8_t channel() const {
+    return 6;
+  }
+};
+
+class SurveyedPortal : public FixedPortal { // Starts on own channel but opts in to survey
+public:
+  SurveyedPortal(const BaseConfig *config, const Led *led) : FixedPortal(config, led) {}
+
+protected:
+  bool autoChannel() const {
+    return true;
+  }
+};
+
+static const std::vector<std::pair<uint8_t, int8_t>> APARTMENT = { { 1, -48 }, { 1, -71 }, { 3, -80 }, { 6, -62 }, { 6, -85 }, { 9, -77 },
+  { 11, -51 }, { 11, -66 }, { 13, -88 } }; // Least interfered channel is 5
+
+static TestConfig *config;
+static Led *led;
+
+void setUp() {
+  uint32_t empty[2] = { 0, 0 };
+
+  ESP.rtcUserMemoryWrite(CP_RTC_BLOCK, empty, sizeof(empty)); // No cached channel
+  WiFi.mode(WIFI_OFF);
+  WiFi.nativeScanResults(APARTMENT, 3);
+  config = new TestConfig();
+  config->clear();
+  led = new Led(LED_BUILTIN, LOW);
+}
+
+void tearDown() {
+  delete led;
+  delete config;
+}
+
+static void test_survey_moves_ap() {
+  uint16_t scans = WiFi.nativeScans();
+  uint16_t starts = WiFi.nativeApStarts();
+
+  {
+    TestPortal portal(config, led);
+
+    TEST_ASSERT_TRUE(portal.exec(2));
+    TEST_ASSERT_EQUAL(WIFI_AP_STA, portal.firstMode);
+    TEST_ASSERT_EQUAL(1, portal.firstChannel);
+    TEST_ASSERT_EQUAL(5, portal.lastChannel);
+  }
+  TEST_ASSERT_EQUAL(scans + 1, WiFi.nativeScans());
+  TEST_ASSERT_EQUAL(starts + 2, WiFi.nativeApStarts());
+  TEST_ASSERT_EQUAL(0, WiFi.getMode() & WIFI_STA);
+
+  TestPortal next(config, led);
+
+  TEST_ASSERT_EQUAL(5, next.channel()); // Cached across reboots
+}
+
+static void test_fixed_channel() {
+  uint16_t scans = WiFi.nativeScans();
+  uint16_t starts = WiFi.nativeApStarts();
+  FixedPortal portal(config, led);
+
+  TEST_ASSERT_TRUE(portal.exec(2));
+  TEST_ASSERT_EQUAL(WIFI_AP, portal.firstMode);
+  TEST_ASSERT_EQUAL(6, portal.firstChannel);
+  TEST_ASSERT_EQUAL(6, portal.lastChannel);
+  TEST_ASSERT_EQUAL(scans, WiFi.nativeScans());
+  TEST_ASSERT_EQUAL(starts + 1, WiFi.nativeApStarts());
+
+  TestPortal next(config, led);
+
+  TEST_ASSERT_EQUAL(1, next.channel()); // Nothing surveyed, nothing cached
+}
+
+static void test_fixed_channel_opt_in() {
+  uint16_t scans = WiFi.nativeScans();
+  SurveyedPortal portal(config, led);
+
+  TEST_ASSERT_TRUE(portal.exec(2));
+  TEST_ASSERT_EQUAL(WIFI_AP_STA, portal.firstMode);
+  TEST_ASSERT_EQUAL(6, portal.firstChannel);
+  TEST_ASSERT_EQUAL(5, portal.lastChannel);
+  TEST_ASSERT_EQUAL(scans + 1, WiFi.nativeScans());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_survey_moves_ap);
+  RUN_TEST(test_fixed_channel);
+  RUN_TEST(test_fixed_channel_opt_in);
+
+  return UNITY_END();
+}
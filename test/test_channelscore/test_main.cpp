@@ -0,0 +1,67 @@
+#include <unity.h>
+#include "ChannelScore.h"
+
+void setUp() {}
+
+void tearDown() {}
+
+struct fixture_t { // Recorded scan and expected choice
+  const char *name;
+  wifinet_t nets[16];
+  uint8_t count;
+  uint8_t best;
+};
+
+static const fixture_t FIXTURES[] = {
+  { "empty", {}, 0, 1 },
+  { "one strong on 1", { { 1, -40 } }, 1, 11 },
+  { "1/6/11 busy", { { 1, -60 }, { 6, -55 }, { 11, -70 } }, 3, 13 },
+  { "apartment", { { 1, -48 }, { 1, -71 }, { 3, -80 }, { 6, -62 }, { 6, -85 }, { 9, -77 }, { 11, -51 }, { 11, -66 }, { 13, -88 } }, 9, 5 },
+  { "weak on 11 only", { { 1, -45 }, { 6, -50 }, { 11, -90 } }, 3, 13 },
+  { "many weak beat one strong", { { 1, -90 }, { 2, -90 }, { 3, -90 }, { 6, -30 }, { 11, -30 } }, 5, 1 }
+};
+
+static void test_fixtures() {
+  for (uint8_t i = 0; i < sizeof(FIXTURES) / sizeof(FIXTURES[0]); ++i) {
+    TEST_ASSERT_EQUAL_MESSAGE(FIXTURES[i].best, bestChannel(FIXTURES[i].nets, FIXTURES[i].count, 13), FIXTURES[i].name);
+  }
+}
+
+static void test_max_channel() {
+  const fixture_t &busy = FIXTURES[2];
+
+  TEST_ASSERT_EQUAL(13, bestChannel(busy.nets, busy.count, 13));
+  TEST_ASSERT_EQUAL(11, bestChannel(busy.nets, busy.count, 11)); // North America, ties with 10 and 11 is preferred
+}
+
+static void test_interference() {
+  const wifinet_t one = { 6, -50 };
+  const wifinet_t two[] = { { 6, -50 }, { 6, -50 } };
+
+  TEST_ASSERT_EQUAL(CHANNEL_QUIET, channelInterference(NULL, 0, 6));
+  TEST_ASSERT_EQUAL(-50, channelInterference(&one, 1, 6));
+  TEST_ASSERT_EQUAL(-51, channelInterference(&one, 1, 7));
+  TEST_ASSERT_EQUAL(CHANNEL_QUIET, channelInterference(&one, 1, 12)); // 6 channels apart
+  TEST_ASSERT_EQUAL(-47, channelInterference(two, 2, 6)); // Powers add up, twice is 3 dB more
+}
+
+static void test_preferred_ties() {
+  const wifinet_t nets[] = { { 13, -40 } };
+
+  const wifinet_t louder[] = { { 1, -30 }, { 2, -70 }, { 7, -59 }, { 13, -30 } };
+
+  TEST_ASSERT_EQUAL(1, bestChannel(nets, 1, 13)); // Channels 1..7 are all quiet, 1 is preferred and first
+  TEST_ASSERT_EQUAL(-58, channelInterference(louder, 4, 6));
+  TEST_ASSERT_EQUAL(-59, channelInterference(louder, 4, 7));
+  TEST_ASSERT_EQUAL(7, bestChannel(louder, 4, 13)); // 1 dB louder is no tie, even for preferred 6
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fixtures);
+  RUN_TEST(test_max_channel);
+  RUN_TEST(test_interference);
+  RUN_TEST(test_preferred_ties);
+
+  return UNITY_END();
+}
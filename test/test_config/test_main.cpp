@@ -0,0 +1,214 @@
+#include <Arduino.h>
+#include <FS.h>
+#include <StreamString.h>
+#include <unity.h>
+#include "TestFixture.h"
+
+static String readFile(const char *path) {
+  File file = SPIFFS.open(path, "r");
+  String result;
+
+  if (file) {
+    result = file.readString();
+    file.close();
+  }
+
+  return result;
+}
+
+void setUp() {
+  SPIFFS.format();
+}
+
+void tearDown() {}
+
+static void test_defaults() {
+  TestConfig config;
+
+  config.clear();
+  TEST_ASSERT_EQUAL_STRING("device", config._name);
+  TEST_ASSERT_EQUAL_STRING("", config._pswd);
+  TEST_ASSERT_EQUAL(4, config._level);
+  TEST_ASSERT_EQUAL_FLOAT(0.5, config._ratio);
+  TEST_ASSERT_TRUE(config._enabled);
+  TEST_ASSERT_EQUAL(3, config._slots[2]);
+  TEST_ASSERT_EQUAL(2, config.findParam("level"));
+  TEST_ASSERT_EQUAL(BaseConfig::ERR_INDEX, config.findParam("missing"));
+  TEST_ASSERT_EQUAL(3, config.itemCount(5));
+}
+
+static void test_limits() {
+  TestConfig config;
+  uint8_t index;
+  paramerror_t error;
+
+  config.clear();
+  TEST_ASSERT_TRUE(config.setParam(2, "6"));
+  TEST_ASSERT_EQUAL(6, config._level);
+  TEST_ASSERT_FALSE(config.setParam(2, "12"));
+  TEST_ASSERT_EQUAL(1, config.errorCount());
+  TEST_ASSERT_TRUE(config.getError(0, index, error));
+  TEST_ASSERT_EQUAL(2, index);
+  TEST_ASSERT_EQUAL(PARERR_RANGE, error);
+  TEST_ASSERT_FALSE(config.setParam(2, "5"));
+  TEST_ASSERT_TRUE(config.getError(0, index, error));
+  TEST_ASSERT_EQUAL(PARERR_STEP, error);
+  TEST_ASSERT_EQUAL(6, config._level); // Rejected value is not published
+}
+
+static void test_save_load() {
+  {
+    TestConfig config;
+
+    config.clear();
+    TEST_ASSERT_TRUE(config.setParam(0, "sensor"));
+    TEST_ASSERT_TRUE(config.setParam(1, "secret"));
+    TEST_ASSERT_TRUE(config.setParam(3, "1.25"));
+    TEST_ASSERT_TRUE(config.setParam(4, "false"));
+    TEST_ASSERT_TRUE(config.save());
+  }
+  TEST_ASSERT_TRUE(SPIFFS.exists("/config.json"));
+  TEST_ASSERT_TRUE(SPIFFS.exists("/config_extra.json"));
+  TEST_ASSERT_LESS_THAN(0, readFile("/config.json").indexOf("secret")); // Sealed at rest
+
+  TestConfig config;
+
+  TEST_ASSERT_TRUE(config.load());
+  TEST_ASSERT_EQUAL_STRING("sensor", config._name);
+  TEST_ASSERT_EQUAL_STRING("secret", config._pswd);
+  TEST_ASSERT_EQUAL_FLOAT(1.25, config._ratio);
+  TEST_ASSERT_FALSE(config._enabled);
+  TEST_ASSERT_EQUAL(2, config._slots[1]);
+}
+
+static void test_sections_on_demand() {
+  {
+    TestConfig config;
+
+    config.clear();
+    config.setParam(2, "8");
+    config.save();
+  }
+
+  TestConfig config;
+
+  TEST_ASSERT_TRUE(config.load(SECTION_MAIN));
+  TEST_ASSERT_TRUE(config.isLoaded(SECTION_MAIN));
+  TEST_ASSERT_FALSE(config.isLoaded(SECTION_EXTRA));
+  TEST_ASSERT_TRUE(config.require(SECTION_EXTRA));
+  TEST_ASSERT_EQUAL(8, config._level);
+}
+
+static void test_missing_file() {
+  TestConfig config;
+
+  TEST_ASSERT_FALSE(config.load());
+  TEST_ASSERT_EQUAL_STRING("device", config._name); // Defaults on failure
+  TEST_ASSERT_EQUAL(4, config._level);
+}
+
+static void test_from_json() {
+  TestConfig config;
+  const char JSON[] = "{\"level\":2,\"slots\":[7,8,9],\"unknown\":1}";
+
+  config.clear();
+  config.setParam(0, "custom");
+  TEST_ASSERT_TRUE(config.fromJson(JSON, strlen(JSON)));
+  TEST_ASSERT_EQUAL(2, config._level);
+  TEST_ASSERT_EQUAL(9, config._slots[2]);
+  TEST_ASSERT_EQUAL_STRING("device", config._name); // Params missing in body get defaults
+  config.setParam(0, "custom");
+
+  const char BAD[] = "{\"level\":3,\"name\":\"other\"}";
+
+  TEST_ASSERT_FALSE(config.fromJson(BAD, strlen(BAD)));
+  TEST_ASSERT_EQUAL(2, config._level); // All or nothing
+  TEST_ASSERT_EQUAL_STRING("custom", config._name);
+}
+
+static void test_msgpack_roundtrip() {
+  StreamString out;
+  TestConfig config;
+
+  config.clear();
+  config.setParam(0, "packed");
+  config.setParam(1, "hidden");
+  config.setParam(2, "10");
+  TEST_ASSERT_GREATER_THAN(0, config.toMsgPack(out));
+
+  TestConfig other;
+
+  other.clear();
+  TEST_ASSERT_TRUE(other.fromMsgPack((const uint8_t*)out.c_str(), out.length()));
+  TEST_ASSERT_EQUAL_STRING("packed", other._name);
+  TEST_ASSERT_EQUAL_STRING("", other._pswd); // Masked, so current value is kept
+  TEST_ASSERT_EQUAL(10, other._level);
+}
+
+static void test_json_capacity() { // Document sized by jsonCapacity() holds every param at full length
+  TestConfig config;
+  TestConfig other;
+  StreamString exported;
+  uint16_t slots[3] = { 65535, 65535, 65535 };
+
+  config.setSchema(3);
+  other.setSchema(3);
+  config.clear();
+  TEST_ASSERT_TRUE(config.setParam(0, "0123456789abcde"));
+  TEST_ASSERT_TRUE(config.setParam(1, "edcba9876543210"));
+  TEST_ASSERT_TRUE(config.setParam(3, "-1.23456789e-30"));
+  memcpy(config._slots, slots, sizeof(slots));
+
+  String json = config.toString();
+
+  TEST_ASSERT_GREATER_OR_EQUAL(0, json.indexOf("$schema"));
+  TEST_ASSERT_LESS_OR_EQUAL(config.jsonLength(), json.length());
+  other.clear();
+  TEST_ASSERT_TRUE(other.fromString(json));
+  TEST_ASSERT_EQUAL_STRING(config._name, other._name);
+  TEST_ASSERT_EQUAL_STRING(config._pswd, other._pswd);
+  TEST_ASSERT_EQUAL_FLOAT(config._ratio, other._ratio);
+  TEST_ASSERT_EQUAL(65535, other._slots[2]);
+
+  TEST_ASSERT_GREATER_THAN(0, config.exportJson(exported));
+  TEST_ASSERT_GREATER_OR_EQUAL(0, exported.indexOf("\"pswd\":\"********\""));
+  TEST_ASSERT_GREATER_OR_EQUAL(0, exported.indexOf("\"slots\":[65535,65535,65535]"));
+
+  TEST_ASSERT_TRUE(config.save());
+  other.clear();
+  TEST_ASSERT_TRUE(other.load());
+  TEST_ASSERT_EQUAL_STRING(config._pswd, other._pswd);
+  TEST_ASSERT_EQUAL(65535, other._slots[0]);
+}
+
+static void paramChanged(uint8_t index, const void *oldValue, const void *newValue, void *arg) {
+  *(uint8_t*)arg = index;
+}
+
+static void test_subscribe() {
+  TestConfig config;
+  uint8_t changed = BaseConfig::ERR_INDEX;
+
+  config.clear();
+  TEST_ASSERT_TRUE(config.subscribe(2, paramChanged, &changed));
+  config.setParam(0, "quiet");
+  TEST_ASSERT_EQUAL(BaseConfig::ERR_INDEX, changed);
+  config.setParam(2, "0");
+  TEST_ASSERT_EQUAL(2, changed);
+  config.unsubscribe(paramChanged, &changed);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_defaults);
+  RUN_TEST(test_limits);
+  RUN_TEST(test_save_load);
+  RUN_TEST(test_sections_on_demand);
+  RUN_TEST(test_missing_file);
+  RUN_TEST(test_from_json);
+  RUN_TEST(test_msgpack_roundtrip);
+  RUN_TEST(test_json_capacity);
+  RUN_TEST(test_subscribe);
+
+  return UNITY_END();
+}
@@ -0,0 +1,77 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "List.h"
+
+void setUp() {}
+
+void tearDown() {}
+
+template<class L> static void checkList() {
+  L list;
+
+  TEST_ASSERT_EQUAL(0, list.count());
+  for (uint8_t i = 0; i < 4; ++i) {
+    TEST_ASSERT_EQUAL(i, list.add(i * 10));
+  }
+  TEST_ASSERT_EQUAL(L::ERR_INDEX, list.add(40));
+  TEST_ASSERT_EQUAL(2, list.find(20));
+  TEST_ASSERT_EQUAL(L::ERR_INDEX, list.find(25));
+  list.remove(1);
+  TEST_ASSERT_EQUAL(3, list.count());
+  TEST_ASSERT_EQUAL(0, list[0]);
+  TEST_ASSERT_EQUAL(20, list[1]);
+  TEST_ASSERT_EQUAL(30, list[2]);
+  list.remove(2);
+  list.remove(5);
+  TEST_ASSERT_EQUAL(2, list.count());
+  TEST_ASSERT_EQUAL(20, list[1]);
+  list.clear();
+  TEST_ASSERT_EQUAL(0, list.count());
+  TEST_ASSERT_EQUAL(L::ERR_INDEX, list.find(0));
+}
+
+static void test_list() {
+  checkList<List<uint8_t, 4>>();
+}
+
+static void test_static_list() {
+  checkList<StaticList<uint8_t, 4>>();
+}
+
+class StrList : public List<char*> { // Owns its items
+protected:
+  void cleanup(void *ptr) {
+    ++cleanups;
+    free(*(char**)ptr);
+  }
+  bool match(uint8_t index, const void *t) {
+    return ! strcmp(_items[index], *(char* const*)t);
+  }
+
+public:
+  uint8_t cleanups = 0;
+};
+
+static void test_list_cleanup() {
+  StrList list;
+  char *name = (char*)"two";
+
+  list.add(strdup("one"));
+  list.add(strdup("two"));
+  list.add(strdup("three"));
+  TEST_ASSERT_EQUAL(1, list.find(name));
+  list.remove(0);
+  TEST_ASSERT_EQUAL(1, list.cleanups);
+  TEST_ASSERT_EQUAL(0, list.find(name));
+  list.clear();
+  TEST_ASSERT_EQUAL(3, list.cleanups);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_list);
+  RUN_TEST(test_static_list);
+  RUN_TEST(test_list_cleanup);
+
+  return UNITY_END();
+}
@@ -0,0 +1,301 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESP8266WiFi.h>
+#include <FS.h>
+#include <unity.h>
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include "CaptivePortal.h"
+#include "HeapTrace.h"
+#include "Leds.h"
+#include "TestFixture.h"
+
+// Route mixes of tools/scenarios run in process over the shim transport (env:native_bench), one line per route:
+// LOAD,scenario,route,requests,errors,p50 ns,p99 ns,req/s,allocs/req,peak heap
+// Requests are served one at a time as ESP8266WebServer does, latency is handler time without network.
+
+static const uint16_t LOAD_REQUESTS = 3000;
+static const uint32_t LOAD_UPLOAD_SIZE = 65536;
+static const char SCENARIO_DIR[] = "tools/scenarios/"; // Relative to project directory, where pio test runs programs
+
+class TestPortal : public CaptivePortal {
+public:
+  TestPortal(const BaseConfig *config, const Led *led) : CaptivePortal(config, led) {}
+
+  ESP8266WebServer &server() {
+    return *_http;
+  }
+};
+
+struct route_t {
+  HTTPMethod method;
+  const char *path;
+  const char *host; // NULL for AP address
+  uint8_t weight;
+  int expected; // Response code
+};
+
+struct scenario_t {
+  const char *name;
+  const route_t *routes;
+  uint8_t count;
+  uint16_t uploadEvery; // Every n-th request is a file upload to /spiffs, as background of scenario
+};
+
+static const route_t PORTAL_ROUTES[] = { // tools/scenarios/portal_burst.json, kept in step by test_scenario_files
+  { HTTP_GET, "/generate_204", "connectivitycheck.gstatic.com", 4, 302 },
+  { HTTP_GET, "/hotspot-detect.html", "captive.apple.com", 3, 302 },
+  { HTTP_GET, "/connecttest.txt", "www.msftconnecttest.com", 2, 302 },
+  { HTTP_GET, "/", NULL, 2, 200 },
+  { HTTP_GET, "/styles.css", NULL, 1, 200 },
+  { HTTP_GET, "/script.js", NULL, 1, 200 }
+};
+
+static const route_t DASHBOARD_ROUTES[] = { // tools/scenarios/dashboard_poll.json
+  { HTTP_GET, "/config", NULL, 6, 200 },
+  { HTTP_GET, "/", NULL, 1, 200 },
+  { HTTP_GET, "/setup", NULL, 1, 200 },
+  { HTTP_GET, "/spiffs", NULL, 1, 200 },
+  { HTTP_POST, "/api/config", NULL, 1, 200 } // Posts back document of GET /api/config
+};
+
+static const route_t UPLOAD_ROUTES[] = { // tools/scenarios/upload_contention.json
+  { HTTP_GET, "/config", NULL, 3, 200 },
+  { HTTP_GET, "/", NULL, 1, 200 },
+  { HTTP_GET, "/styles.css", NULL, 1, 200 },
+  { HTTP_POST, "/spiffs", NULL, 0, 200 } // Upload, not in weighted mix, peak heap includes file as shim keeps flash in memory
+};
+
+static const scenario_t SCENARIOS[] = {
+  { "portal_burst", PORTAL_ROUTES, sizeof(PORTAL_ROUTES) / sizeof(PORTAL_ROUTES[0]), 0 },
+  { "dashboard_poll", DASHBOARD_ROUTES, sizeof(DASHBOARD_ROUTES) / sizeof(DASHBOARD_ROUTES[0]), 0 },
+  { "upload_contention", UPLOAD_ROUTES, sizeof(UPLOAD_ROUTES) / sizeof(UPLOAD_ROUTES[0]), 10 }
+};
+
+static const char BOUNDARY[] = "LoadBoundary";
+
+struct routestats_t {
+  std::vector<uint32_t> latencies; // ns
+  uint32_t errors;
+  uint32_t allocs;
+  uint32_t peak;
+};
+
+static String uploadBody() { // Built before timing, so not part of handler heap
+  String result;
+
+  result.reserve(LOAD_UPLOAD_SIZE + 200);
+  result = F("--");
+  result += BOUNDARY;
+  result += F("\r\nContent-Disposition: form-data; name=\"upload\"; filename=\"loadtest.bin\"\r\nContent-Type: application/octet-stream\r\n\r\n");
+  for (uint32_t i = 0; i < LOAD_UPLOAD_SIZE; ++i) {
+    result += (char)('a' + i % 26);
+  }
+  result += F("\r\n--");
+  result += BOUNDARY;
+  result += F("--\r\n");
+
+  return result;
+}
+
+static String readScenario(const char *name) {
+  String path = String(SCENARIO_DIR) + name + F(".json");
+  String result;
+  FILE *file = fopen(path.c_str(), "r");
+  int c;
+
+  TEST_ASSERT_NOT_NULL_MESSAGE(file, path.c_str());
+  while ((c = fgetc(file)) != EOF) {
+    result += (char)c;
+  }
+  fclose(file);
+
+  return result;
+}
+
+static void checkScenario(const scenario_t &scenario) { // Table must run the same mix as tools/loadtest.py does on device
+  String json = readScenario(scenario.name);
+  DynamicJsonDocument doc(2048);
+  uint8_t count = scenario.uploadEvery ? scenario.count - 1 : scenario.count;
+  uint8_t i = 0;
+
+  TEST_ASSERT_FALSE_MESSAGE(deserializeJson(doc, json.c_str(), json.length()), scenario.name);
+
+  JsonObjectConst root = doc.as<JsonObjectConst>();
+  JsonArrayConst requests = root["requests"].as<JsonArrayConst>();
+
+  TEST_ASSERT_EQUAL_MESSAGE(count, requests.size(), scenario.name);
+  for (JsonVariantConst request : requests) {
+    const route_t &route = scenario.routes[i++];
+
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(route.method == HTTP_POST ? "POST" : "GET", request["method"] | "GET", route.path);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(route.path, request["path"] | "", scenario.name);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(route.host ? route.host : "", request["host"] | "", route.path);
+    TEST_ASSERT_EQUAL_MESSAGE(route.weight, request["weight"] | 1, route.path);
+  }
+  if (scenario.uploadEvery) {
+    JsonVariantConst upload = root["background"][0];
+
+    TEST_ASSERT_EQUAL_STRING_MESSAGE("POST", upload["method"] | "GET", scenario.name);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(scenario.routes[count].path, upload["path"] | "", scenario.name);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE("/loadtest.bin", upload["upload"] | "", scenario.name);
+    TEST_ASSERT_EQUAL_MESSAGE(LOAD_UPLOAD_SIZE, upload["size"] | 0, scenario.name);
+  } else
+    TEST_ASSERT_TRUE_MESSAGE(root["background"].isNull(), scenario.name);
+}
+
+static uint8_t pickRoute(const scenario_t &scenario) {
+  uint16_t total = 0;
+  uint16_t r;
+
+  for (uint8_t i = 0; i < scenario.count; ++i) {
+    total += scenario.routes[i].weight;
+  }
+  r = random() % total;
+  for (uint8_t i = 0; i < scenario.count; ++i) {
+    if (r < scenario.routes[i].weight)
+      return i;
+    r -= scenario.routes[i].weight;
+  }
+
+  return 0;
+}
+
+static uint32_t percentile(std::vector<uint32_t> &values, uint8_t p) {
+  if (values.empty())
+    return 0;
+  std::sort(values.begin(), values.end());
+
+  return values[std::min(values.size() - 1, values.size() * p / 100)];
+}
+
+static void runScenario(const scenario_t &scenario, ESP8266WebServer &server) {
+  std::vector<routestats_t> stats(scenario.count);
+  String upload = scenario.uploadEvery ? uploadBody() : String();
+  String uploadType = String(F("multipart/form-data; boundary=")) + BOUNDARY;
+  String posted;
+  uint64_t total = 0;
+  char msg[160];
+
+  server.keepResponse(true);
+  TEST_ASSERT_EQUAL(200, server.request(HTTP_GET, "/api/config"));
+  posted = server.responseBody();
+  server.keepResponse(false);
+  for (uint8_t i = 0; i < scenario.count; ++i) {
+    stats[i].latencies.reserve(LOAD_REQUESTS);
+  }
+  srandom(1);
+  for (uint16_t n = 1; n <= LOAD_REQUESTS; ++n) {
+    uint8_t index = scenario.uploadEvery && (n % scenario.uploadEvery == 0) ? scenario.count - 1 : pickRoute(scenario);
+    const route_t &route = scenario.routes[index];
+    bool isUpload = route.method == HTTP_POST && route.weight == 0;
+    heaptrace_t trace;
+    uint32_t start;
+    int code;
+
+    if (route.host)
+      server.setRequestHeader(F("Host"), route.host);
+    heapTraceBegin();
+    start = ESP.getCycleCount();
+    if (isUpload)
+      code = server.request(HTTP_POST, route.path, uploadType, upload);
+    else if (route.method == HTTP_POST)
+      code = server.request(HTTP_POST, route.path, F("application/json"), posted);
+    else
+      code = server.request(route.method, route.path);
+    start = ESP.getCycleCount() - start;
+    heapTraceEnd(trace);
+
+    routestats_t &route_stats = stats[index];
+    uint32_t ns = (uint64_t)start * 1000 / ESP.getCpuFreqMHz();
+
+    total += ns;
+    if (code == route.expected)
+      route_stats.latencies.push_back(ns);
+    else
+      ++route_stats.errors;
+    route_stats.allocs += trace.allocs;
+    if (trace.peak > route_stats.peak)
+      route_stats.peak = trace.peak;
+  }
+  if (scenario.uploadEvery) { // Cleanup of scenario
+    TEST_ASSERT_TRUE(SPIFFS.exists("/loadtest.bin"));
+    TEST_ASSERT_EQUAL(200, server.request(HTTP_DELETE, "/spiffs?path=/loadtest.bin"));
+  }
+  for (uint8_t i = 0; i < scenario.count; ++i) {
+    routestats_t &route_stats = stats[i];
+    uint32_t count = route_stats.latencies.size() + route_stats.errors;
+    uint32_t p50 = percentile(route_stats.latencies, 50);
+    uint32_t p99 = percentile(route_stats.latencies, 99);
+
+    snprintf(msg, sizeof(msg), "LOAD,%s,%s %s,%u,%u,%u,%u,%u,%u,%u", scenario.name, scenario.routes[i].method == HTTP_POST ? "POST" : "GET",
+      scenario.routes[i].path, count, route_stats.errors, p50, p99, p50 ? (uint32_t)(1000000000ULL / p50) : 0, count ? route_stats.allocs / count : 0,
+      route_stats.peak);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_GREATER_THAN_MESSAGE(0, count, scenario.routes[i].path);
+    TEST_ASSERT_EQUAL_MESSAGE(0, route_stats.errors, scenario.routes[i].path);
+  }
+  snprintf(msg, sizeof(msg), "LOAD,%s,all,%u,,,,%u", scenario.name, LOAD_REQUESTS, (uint32_t)(LOAD_REQUESTS * 1000000000ULL / total));
+  TEST_MESSAGE(msg);
+}
+
+static TestConfig *config;
+
+void setUp() {
+  SPIFFS.format();
+  config = new TestConfig();
+  config->clear();
+  config->setParam(1, "secret");
+}
+
+void tearDown() {
+  delete config;
+}
+
+static void test_scenario_files() {
+  for (uint8_t i = 0; i < sizeof(SCENARIOS) / sizeof(SCENARIOS[0]); ++i) {
+    checkScenario(SCENARIOS[i]);
+  }
+}
+
+static void test_portal_burst() {
+  Led led(LED_BUILTIN, LOW);
+
+  WiFi.softAP("load", "password");
+
+  TestPortal portal(config, &led);
+
+  TEST_ASSERT_TRUE(portal._setup());
+  runScenario(SCENARIOS[0], portal.server());
+  WiFi.softAPdisconnect(true);
+}
+
+static void test_dashboard_poll() {
+  TestWebServer http(config);
+  uint8_t level = config->_level;
+
+  TEST_ASSERT_TRUE(http._setup());
+  runScenario(SCENARIOS[1], http.server());
+  TEST_ASSERT_EQUAL_STRING("secret", config->_pswd); // Masked password posted back keeps stored one
+  TEST_ASSERT_EQUAL(level, config->_level);
+}
+
+static void test_upload_contention() {
+  TestWebServer http(config);
+
+  TEST_ASSERT_TRUE(http._setup());
+  runScenario(SCENARIOS[2], http.server());
+  TEST_ASSERT_FALSE(SPIFFS.exists("/loadtest.bin"));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  TEST_MESSAGE("LOAD,scenario,route,requests,errors,p50 ns,p99 ns,req/s,allocs/req,peak heap");
+  RUN_TEST(test_scenario_files);
+  RUN_TEST(test_portal_burst);
+  RUN_TEST(test_dashboard_poll);
+  RUN_TEST(test_upload_contention);
+
+  return UNITY_END();
+}
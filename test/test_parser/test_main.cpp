@@ -0,0 +1,217 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include "BaseConfig.h"
+#include "ConfigParser.h"
+
+// Parses configs of 200 params with ConfigParser and with former read() over a JSON document
+
+static const uint8_t PARAM_COUNT = 200;
+static const uint8_t STR_SIZE = 16;
+static const uint16_t BENCH_ITERATIONS = 500;
+static const uint8_t CHUNK_SIZE = 64;
+
+static param_t params[PARAM_COUNT]; // Even params are numbers, odd ones strings
+static char names[PARAM_COUNT][5];
+
+class ManyConfig : public BaseConfig {
+public:
+  ManyConfig() : BaseConfig(params, PARAM_COUNT) {}
+
+  void *getParamPtr(uint8_t index) {
+    if (index < PARAM_COUNT)
+      return index & 1 ? (void*)_strs[index / 2] : (void*)&_nums[index / 2];
+
+    return NULL;
+  }
+
+  bool fromDocument(const char *json, size_t length);
+
+  uint16_t _nums[PARAM_COUNT / 2];
+  char _strs[PARAM_COUNT / 2][STR_SIZE];
+
+protected:
+  void read(const JsonDocument &doc);
+};
+
+bool ManyConfig::fromDocument(const char *json, size_t length) { // Former fromJson()
+  JsonDocument *jsonDoc = getJsonDoc();
+
+  if (! jsonDoc)
+    return false;
+
+  DeserializationError error = deserializeJson(*jsonDoc, json, length);
+
+  if (! error)
+    read(*jsonDoc);
+  jsonDoc->clear();
+
+  return (! error);
+}
+
+void ManyConfig::read(const JsonDocument &doc) { // Two object scans per param
+  for (uint8_t i = 0; i < _paramCount; ++i) {
+    void *value = getParamPtr(i);
+    PGM_P parname = (PGM_P)pgm_read_ptr(&_params[i]._name);
+
+    if (doc.containsKey(FPSTR(parname))) {
+      if (pgm_read_byte(&_params[i]._type) == PAR_UI16)
+        *(uint16_t*)value = doc[FPSTR(parname)].as<uint16_t>();
+      else {
+        memset(value, 0, STR_SIZE);
+        strncpy((char*)value, doc[FPSTR(parname)].as<const char*>(), STR_SIZE - 1);
+      }
+    } else
+      setDefault(i);
+  }
+}
+
+static String makeJson(uint16_t seed, uint16_t unknown) { // Keys in reverse order of params, unknown keys in between
+  String result;
+  char item[48];
+
+  result.reserve(PARAM_COUNT * 16 + unknown * 48);
+  result = '{';
+  for (int16_t i = PARAM_COUNT - 1; i >= 0; --i) {
+    if (i & 1)
+      snprintf(item, sizeof(item), "\"p%03d\":\"s%u\",", i, i * seed);
+    else
+      snprintf(item, sizeof(item), "\"p%03d\":%u,", i, i + seed);
+    result += item;
+    for (uint16_t j = i; j < unknown; j += PARAM_COUNT) {
+      snprintf(item, sizeof(item), "\"x%05u\":[\"skipped text\",{\"a\":[1,2,3]}],", j);
+      result += item;
+    }
+  }
+  result.setCharAt(result.length() - 1, '}');
+
+  return result;
+}
+
+static void checkValues(const ManyConfig &config, uint16_t seed) {
+  char str[STR_SIZE];
+
+  for (uint8_t i = 0; i < PARAM_COUNT; i += 2) {
+    TEST_ASSERT_EQUAL(i + seed, config._nums[i / 2]);
+    snprintf(str, sizeof(str), "s%u", (i + 1) * seed);
+    TEST_ASSERT_EQUAL_STRING(str, config._strs[i / 2]);
+  }
+}
+
+static uint32_t parsePeak(ManyConfig &config, const String &json) { // Heap used while document is fed in chunks
+  uint32_t start = ESP.getFreeHeap();
+  uint32_t minFree = start;
+
+  {
+    ConfigParser parser(&config);
+
+    for (uint32_t pos = 0; pos < json.length(); pos += CHUNK_SIZE) {
+      TEST_ASSERT_TRUE(parser.parse(json.c_str() + pos, json.length() - pos < CHUNK_SIZE ? json.length() - pos : CHUNK_SIZE));
+      if (ESP.getFreeHeap() < minFree)
+        minFree = ESP.getFreeHeap();
+    }
+    TEST_ASSERT_TRUE(parser.finish());
+  }
+
+  return start - minFree;
+}
+
+static uint32_t timePath(ManyConfig &config, const String &json, bool document) {
+  uint32_t start = micros();
+
+  for (uint16_t i = 0; i < BENCH_ITERATIONS; ++i) {
+    if (document)
+      TEST_ASSERT_TRUE(config.fromDocument(json.c_str(), json.length()));
+    else
+      TEST_ASSERT_TRUE(config.fromJson(json.c_str(), json.length()));
+  }
+
+  return (micros() - start) * 1000 / BENCH_ITERATIONS;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+static void test_parse_200() {
+  ManyConfig config;
+  String json = makeJson(3, 0);
+
+  config.clear();
+  TEST_ASSERT_TRUE(config.fromJson(json.c_str(), json.length()));
+  checkValues(config, 3);
+  TEST_ASSERT_TRUE(config.fromDocument(json.c_str(), json.length()));
+  checkValues(config, 3);
+  json = makeJson(5, PARAM_COUNT * 2); // Unknown keys with nested values are skipped
+  TEST_ASSERT_TRUE(config.fromJson(json.c_str(), json.length()));
+  checkValues(config, 5);
+}
+
+static void test_unseen_defaults() {
+  ManyConfig config;
+  const char JSON[] = "{\"p001\":\"only\",\"p198\":7}";
+
+  config.clear();
+  config.setParam(0, "9");
+  config.setParam(3, "other");
+  TEST_ASSERT_TRUE(config.fromJson(JSON, strlen(JSON)));
+  TEST_ASSERT_EQUAL_STRING("only", config._strs[0]);
+  TEST_ASSERT_EQUAL(7, config._nums[99]);
+  TEST_ASSERT_EQUAL(0, config._nums[0]);
+  TEST_ASSERT_EQUAL_STRING("", config._strs[1]);
+}
+
+static void test_constant_memory() {
+  ManyConfig config;
+  String small = makeJson(1, 0);
+  String large = makeJson(2, 2000);
+  uint32_t smallPeak, largePeak;
+  char msg[80];
+
+  config.clear();
+  config.findParam("p000"); // Name index is built once on first lookup
+  smallPeak = parsePeak(config, small);
+  largePeak = parsePeak(config, large);
+  snprintf(msg, sizeof(msg), "%u bytes: %u peak heap, %u bytes: %u peak heap", small.length(), smallPeak, large.length(), largePeak);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_GREATER_THAN(small.length() * 10, large.length());
+  TEST_ASSERT_EQUAL(smallPeak, largePeak);
+}
+
+static void test_bench() {
+  ManyConfig config;
+  String json = makeJson(7, 0);
+  uint32_t parser, document;
+  char msg[80];
+
+  config.clear();
+  config.fromJson(json.c_str(), json.length()); // Warm up name index and JSON document pool
+  config.fromDocument(json.c_str(), json.length());
+  parser = timePath(config, json, false);
+  document = timePath(config, json, true);
+  checkValues(config, 7);
+  snprintf(msg, sizeof(msg), "%u params, %u bytes: ConfigParser %u ns/op, JSON document %u ns/op", PARAM_COUNT, json.length(), parser, document);
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+  for (uint8_t i = 0; i < PARAM_COUNT; ++i) {
+    snprintf(names[i], sizeof(names[i]), "p%03u", i);
+    params[i]._name = names[i];
+    if (i & 1) {
+      params[i]._type = params[i]._item = PAR_STR;
+      params[i]._size = STR_SIZE;
+    } else {
+      params[i]._type = params[i]._item = PAR_UI16;
+      params[i]._size = sizeof(uint16_t);
+    }
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_200);
+  RUN_TEST(test_unseen_defaults);
+  RUN_TEST(test_constant_memory);
+  RUN_TEST(test_bench);
+
+  return UNITY_END();
+}
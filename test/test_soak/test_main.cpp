@@ -0,0 +1,124 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "StrUtils.h"
+
+// Random set/dispose of many short strings with long-lived blocks in between, as config params and
+// form fields churn on a running device. Heap is compared to one malloc() block per string.
+
+static const uint16_t SOAK_STRINGS = 200;
+static const uint32_t SOAK_ITERATIONS = 1000000;
+static const uint8_t SOAK_KEPT = 50;
+static const uint32_t SOAK_HEAP = 40960; // Free heap of running sketch on device
+
+struct heapstate_t {
+  uint32_t free;
+  uint32_t maxBlock;
+  uint8_t frag;
+};
+
+struct soakresult_t {
+  heapstate_t before;
+  heapstate_t loaded; // All strings alive
+  heapstate_t after; // All strings disposed
+};
+
+static bool mallocStr(char **str, const char *src) { // Former allocStr()
+  if (src && *src) {
+    void *ptr = realloc(*str, strlen(src) + 1);
+
+    if (! ptr)
+      return false;
+    *str = (char*)ptr;
+    strcpy(*str, src);
+  } else if (*str) {
+    free(*str);
+    *str = NULL;
+  }
+
+  return true;
+}
+
+static void mallocDisposeStr(char **str) {
+  if (*str) {
+    free(*str);
+    *str = NULL;
+  }
+}
+
+static void heapState(heapstate_t &state) {
+  ESP.getHeapStats(&state.free, &state.maxBlock, &state.frag);
+}
+
+static void printState(const char *name, const char *stage, const heapstate_t &state) {
+  char msg[96];
+
+  snprintf(msg, sizeof(msg), "%s %s: free %u, max block %u, fragmentation %u%%", name, stage, state.free, state.maxBlock, state.frag);
+  TEST_MESSAGE(msg);
+}
+
+static soakresult_t soak(const char *name, bool (*alloc)(char**, const char*), void (*dispose)(char**)) {
+  static char *strs[SOAK_STRINGS];
+  void *kept[SOAK_KEPT];
+  uint8_t keptCount = 0;
+  char buf[80];
+  soakresult_t result;
+  void *ballast;
+
+  TEST_ASSERT_NOT_NULL(ballast = malloc(ESP.getMaxFreeBlockSize() - SOAK_HEAP)); // Leave as much heap as device has
+  srandom(2);
+  heapState(result.before);
+  for (uint32_t i = 0; i < SOAK_ITERATIONS; ++i) {
+    uint16_t index = random() % SOAK_STRINGS;
+    uint8_t r = random() % 100;
+    uint8_t len = r < 70 ? random() % 20 : r < 95 ? 20 + random() % 12 : 32 + random() % 40; // Mostly short
+
+    if (random() % 10 == 0) {
+      dispose(&strs[index]);
+      continue;
+    }
+    memset(buf, 'a' + index % 26, len);
+    buf[len] = '\0';
+    TEST_ASSERT_TRUE(alloc(&strs[index], buf));
+    if (len) {
+      TEST_ASSERT_EQUAL(len, strlen(strs[index]));
+      TEST_ASSERT_EQUAL('a' + index % 26, strs[index][0]);
+    } else
+      TEST_ASSERT_NULL(strs[index]);
+    if ((i % 20000 == 0) && (keptCount < SOAK_KEPT)) // Long-lived blocks pin heap between strings
+      TEST_ASSERT_NOT_NULL(kept[keptCount++] = malloc(random() % 200 + 1));
+  }
+  heapState(result.loaded);
+  for (uint16_t i = 0; i < SOAK_STRINGS; ++i) {
+    dispose(&strs[i]);
+  }
+  while (keptCount)
+    free(kept[--keptCount]);
+  heapState(result.after);
+  free(ballast);
+  printState(name, "before", result.before);
+  printState(name, "loaded", result.loaded);
+  printState(name, "after", result.after);
+
+  return result;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+static void test_soak() {
+  soakresult_t slabs = soak("slabs", allocStr, disposeStr);
+  soakresult_t blocks = soak("malloc", mallocStr, mallocDisposeStr);
+
+  TEST_ASSERT_LESS_THAN(blocks.before.free - blocks.loaded.free, slabs.before.free - slabs.loaded.free); // Less heap for same strings
+  TEST_ASSERT_EQUAL(slabs.before.free, slabs.after.free); // Empty slabs went back to heap
+  TEST_ASSERT_LESS_OR_EQUAL(blocks.loaded.frag, slabs.loaded.frag);
+  TEST_ASSERT_GREATER_OR_EQUAL(blocks.loaded.maxBlock, slabs.loaded.maxBlock);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_soak);
+
+  return UNITY_END();
+}
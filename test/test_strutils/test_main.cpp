@@ -0,0 +1,163 @@
+#include <unity.h>
+#include "StrUtils.h"
+
+void setUp() {}
+
+void tearDown() {}
+
+static void test_alloc_str() {
+  char *str = NULL;
+
+  TEST_ASSERT_TRUE(allocStr(&str, "short"));
+  TEST_ASSERT_EQUAL_STRING("short", str);
+  TEST_ASSERT_TRUE(allocStr(&str, "a string which does not fit into any slab slot"));
+  TEST_ASSERT_EQUAL_STRING("a string which does not fit into any slab slot", str);
+  TEST_ASSERT_TRUE(allocStr_P(&str, PSTR("back to slab")));
+  TEST_ASSERT_EQUAL_STRING("back to slab", str);
+  TEST_ASSERT_TRUE(allocStr(&str, ""));
+  TEST_ASSERT_NULL(str);
+  disposeStr(&str);
+  TEST_ASSERT_NULL(str);
+}
+
+static void test_alloc_str_slabs() {
+  const uint8_t COUNT = 40; // More than one slab of each class
+  char *strs[COUNT];
+  char buf[32];
+
+  for (uint8_t i = 0; i < COUNT; ++i) {
+    strs[i] = NULL;
+    snprintf(buf, sizeof(buf), "%.*s%u", i % 25, "abcdefghijklmnopqrstuvwxy", i);
+    TEST_ASSERT_TRUE(allocStr(&strs[i], buf));
+  }
+  for (uint8_t i = 0; i < COUNT; i += 2) {
+    disposeStr(&strs[i]);
+  }
+  for (uint8_t i = 1; i < COUNT; i += 2) {
+    snprintf(buf, sizeof(buf), "%.*s%u", i % 25, "abcdefghijklmnopqrstuvwxy", i);
+    TEST_ASSERT_EQUAL_STRING(buf, strs[i]);
+    disposeStr(&strs[i]);
+  }
+}
+
+static void test_arena() {
+  StrArena arena(true);
+  const char *s1 = arena.add("one");
+  const char *s2 = arena.add_P(PSTR("two"));
+
+  TEST_ASSERT_EQUAL_STRING("one", s1);
+  TEST_ASSERT_EQUAL_STRING("two", s2);
+  TEST_ASSERT_EQUAL_PTR(s1, arena.add("one"));
+}
+
+static void test_compare_pp() {
+  TEST_ASSERT_EQUAL(0, strcmp_PP(PSTR("abc"), PSTR("abc")));
+  TEST_ASSERT_LESS_THAN(0, strcmp_PP(PSTR("abc"), PSTR("abd")));
+  TEST_ASSERT_GREATER_THAN(0, strcmp_PP(PSTR("abcd"), PSTR("abc")));
+  TEST_ASSERT_EQUAL(0, strncmp_PP(PSTR("abcX"), PSTR("abcY"), 3));
+  TEST_ASSERT_EQUAL(0, strcasecmp_PP(PSTR("Hello World"), PSTR("hELLO wORLD")));
+  TEST_ASSERT_NOT_EQUAL(0, strcasecmp_PP(PSTR("@"), PSTR("`")));
+  TEST_ASSERT_EQUAL(0, strncasecmp_PP(PSTR("ABCx"), PSTR("abcy"), 3));
+}
+
+static int8_t compareBytes(const char *s1, const char *s2, uint32_t maxlen, bool nocase) { // Byte at a time reference
+  char c1, c2;
+
+  if (! maxlen)
+    return 0;
+  do {
+    c1 = nocase ? toupper((uint8_t)*s1++) : *s1++;
+    c2 = nocase ? toupper((uint8_t)*s2++) : *s2++;
+  } while ((--maxlen) && (c1 == c2) && (c1 != '\0'));
+
+  return c1 - c2;
+}
+
+static void test_compare_pp_random() { // Word compares of any alignment against reference
+  static const char ALPHABET[] = "aAbBzZ@[`{\x80\xE1\xC1 09";
+  alignas(4) static char buf1[64];
+  alignas(4) static char buf2[64];
+
+  srandom(1);
+  for (uint32_t i = 0; i < 200000; ++i) {
+    char *s1 = &buf1[random() % 4];
+    char *s2 = &buf2[random() % 4];
+    uint8_t len1 = random() % 40;
+    int8_t len2 = len1 + random() % 3 - 1;
+    uint16_t n = random() % 45;
+
+    if (len2 < 0)
+      len2 = 0;
+    for (uint8_t j = 0; j < len1; ++j) {
+      s1[j] = ALPHABET[random() % (sizeof(ALPHABET) - 1)];
+    }
+    s1[len1] = '\0';
+    memcpy(s2, s1, len2);
+    for (uint8_t j = len1; j < len2; ++j) {
+      s2[j] = 'x';
+    }
+    s2[len2] = '\0';
+    if (len2 && (random() % 3 == 0)) // Differ
+      s2[random() % len2] = ALPHABET[random() % (sizeof(ALPHABET) - 1)];
+    if (random() % 4 == 0) { // Differ in case only
+      for (uint8_t j = 0; j < len2; ++j) {
+        if (random() % 2)
+          s2[j] = toupper((uint8_t)s2[j]);
+      }
+    }
+    TEST_ASSERT_EQUAL_INT8(compareBytes(s1, s2, 0xFFFFFFFF, false), strcmp_PP(s1, s2));
+    TEST_ASSERT_EQUAL_INT8(compareBytes(s1, s2, n, false), strncmp_PP(s1, s2, n));
+    TEST_ASSERT_EQUAL_INT8(compareBytes(s1, s2, 0xFFFFFFFF, true), strcasecmp_PP(s1, s2));
+    TEST_ASSERT_EQUAL_INT8(compareBytes(s1, s2, n, true), strncasecmp_PP(s1, s2, n));
+  }
+}
+
+static void test_byte_to_hex() {
+  char hex[3];
+
+  TEST_ASSERT_EQUAL_STRING("00", byteToHex(hex, 0x00));
+  TEST_ASSERT_EQUAL_STRING("7F", byteToHex(hex, 0x7F));
+  TEST_ASSERT_EQUAL_STRING("A5", byteToHex(hex, 0xA5));
+}
+
+static void test_match_pattern() {
+  TEST_ASSERT_TRUE(matchPattern_P("abc", PSTR("abc")));
+  TEST_ASSERT_FALSE(matchPattern_P("abcd", PSTR("abc")));
+  TEST_ASSERT_TRUE(matchPattern_P("a1b2", PSTR("[a-z]\\d[a-z]\\d")));
+  TEST_ASSERT_TRUE(matchPattern_P("192.168.4.1", PSTR("\\d+.\\d+.\\d+.\\d+")));
+  TEST_ASSERT_FALSE(matchPattern_P("x", PSTR("[^x]")));
+  TEST_ASSERT_TRUE(matchPattern_P("", PSTR("a*")));
+  TEST_ASSERT_TRUE(matchPattern_P("color", PSTR("colou?r")));
+  TEST_ASSERT_TRUE(matchChoice_P("off", PSTR("on|off|auto")));
+  TEST_ASSERT_FALSE(matchChoice_P("of", PSTR("on|off|auto")));
+  TEST_ASSERT_FALSE(matchChoice_P("autox", PSTR("on|off|auto")));
+}
+
+static void test_base64() {
+  const uint8_t data[] = { 'M', 'a', 'n', 0x00, 0xFF };
+  char str[base64Length(sizeof(data)) + 1];
+  uint8_t out[sizeof(data)];
+
+  TEST_ASSERT_EQUAL_STRING("TWFu", base64Encode(str, data, 3));
+  TEST_ASSERT_EQUAL_STRING("TWE=", base64Encode(str, data, 2));
+  TEST_ASSERT_EQUAL_STRING("TQ==", base64Encode(str, data, 1));
+  base64Encode(str, data, sizeof(data));
+  TEST_ASSERT_EQUAL(sizeof(data), base64Decode(out, sizeof(out), str));
+  TEST_ASSERT_EQUAL_MEMORY(data, out, sizeof(data));
+  TEST_ASSERT_EQUAL(-1, base64Decode(out, sizeof(out), "TW*u"));
+  TEST_ASSERT_EQUAL(-1, base64Decode(out, 2, "TWFu"));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_alloc_str);
+  RUN_TEST(test_alloc_str_slabs);
+  RUN_TEST(test_arena);
+  RUN_TEST(test_compare_pp);
+  RUN_TEST(test_compare_pp_random);
+  RUN_TEST(test_byte_to_hex);
+  RUN_TEST(test_match_pattern);
+  RUN_TEST(test_base64);
+
+  return UNITY_END();
+}
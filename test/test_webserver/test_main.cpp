@@ -0,0 +1,410 @@
+#include <Arduino.h>
+#include <FS.h>
+#include <StreamString.h>
+#include <unity.h>
+#ifdef BUNDLE_KEY
+#include <bearssl/bearssl.h>
+#endif
+#include "Metrics.h"
+#include "TestFixture.h"
+
+static TestConfig *config;
+static TestWebServer *http;
+
+void setUp() {
+  scratchBegin(); // Reserved once as at boot
+  SPIFFS.format();
+  config = new TestConfig();
+  config->clear();
+  http = new TestWebServer(config);
+  http->_setup();
+}
+
+void tearDown() {
+  delete http;
+  delete config;
+  SPIFFS.setCapacity(1024 * 1024);
+  SPIFFS.setRenameLimit(-1);
+}
+
+static void test_not_found() {
+  TEST_ASSERT_EQUAL(404, http->server().request(HTTP_GET, "/missing"));
+}
+
+static void test_pages() {
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/"));
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/setup"));
+  TEST_ASSERT_GREATER_THAN(0, http->server().responseBody().indexOf("<html"));
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/script.js"));
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/styles.css"));
+}
+
+static void test_get_config() {
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/config"));
+  TEST_ASSERT_EQUAL_STRING("{\"name\":\"device\",\"pswd\":\"\",\"level\":4,\"ratio\":0.50,\"enabled\":true,\"slots\":[1,2,3]}", http->server().responseBody().c_str());
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/config?section=extra"));
+  TEST_ASSERT_EQUAL_STRING("{\"level\":4,\"ratio\":0.50,\"enabled\":true,\"slots\":[1,2,3]}", http->server().responseBody().c_str());
+  TEST_ASSERT_EQUAL(404, http->server().request(HTTP_GET, "/config?section=other"));
+}
+
+static void test_clear_config() {
+  config->setParam(2, "8");
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_DELETE, "/config"));
+  TEST_ASSERT_EQUAL(4, config->_level);
+}
+
+static void test_spiffs() {
+  const char DATA[] = "uploaded content";
+
+  TEST_ASSERT_EQUAL(200, http->server().uploadFile("/spiffs", "data.txt", (const uint8_t*)DATA, strlen(DATA)));
+  TEST_ASSERT_TRUE(SPIFFS.exists("/data.txt"));
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/data.txt"));
+  TEST_ASSERT_EQUAL_STRING(DATA, http->server().responseBody().c_str());
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/spiffs"));
+  TEST_ASSERT_GREATER_OR_EQUAL(0, http->server().responseBody().indexOf("data.txt"));
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_DELETE, "/spiffs?path=/data.txt"));
+  TEST_ASSERT_FALSE(SPIFFS.exists("/data.txt"));
+  TEST_ASSERT_EQUAL(404, http->server().request(HTTP_DELETE, "/spiffs?path=/data.txt"));
+}
+
+static void test_spiffs_delete_list() { // Body lists files, path without leading slash is from root
+  const char DATA[] = "x";
+
+  TEST_ASSERT_EQUAL(200, http->server().uploadFile("/spiffs", "a.txt", (const uint8_t*)DATA, strlen(DATA)));
+  TEST_ASSERT_EQUAL(200, http->server().uploadFile("/spiffs", "b.txt", (const uint8_t*)DATA, strlen(DATA)));
+  TEST_ASSERT_EQUAL(404, http->server().request(HTTP_DELETE, "/spiffs", "text/plain", "[\"/a.txt\",\"b.txt\",\"/missing.txt\"]"));
+  TEST_ASSERT_EQUAL_STRING("1 of 3 file(s) not deleted!", http->server().responseBody().c_str());
+  TEST_ASSERT_FALSE(SPIFFS.exists("/a.txt"));
+  TEST_ASSERT_FALSE(SPIFFS.exists("/b.txt"));
+  TEST_ASSERT_EQUAL(400, http->server().request(HTTP_DELETE, "/spiffs", "text/plain", "{}"));
+}
+
+static String formEncode(const char *str) {
+  String result;
+  char hex[3];
+
+  for (; *str; ++str) {
+    if (isalnum(*str))
+      result += *str;
+    else {
+      result += '%';
+      result += byteToHex(hex, *str);
+    }
+  }
+
+  return result;
+}
+
+static void test_post_config_form() { // Script of setup page posts JSON as "config" field
+  String body = F("config=");
+
+  body += formEncode("{\"name\":\"script form\",\"level\":8,\"enabled\":false}");
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_POST, "/config", "application/x-www-form-urlencoded", body));
+  TEST_ASSERT_EQUAL_STRING("script form", config->_name);
+  TEST_ASSERT_EQUAL(8, config->_level);
+  TEST_ASSERT_FALSE(config->_enabled);
+  TEST_ASSERT_TRUE(SPIFFS.exists("/config_extra.json"));
+
+  body = F("config=");
+  body += formEncode("{\"level\":70}");
+  TEST_ASSERT_EQUAL(400, http->server().request(HTTP_POST, "/config?section=extra", "application/x-www-form-urlencoded", body));
+  TEST_ASSERT_EQUAL(8, config->_level);
+  TEST_ASSERT_GREATER_THAN(0, http->server().responseBody().indexOf("level"));
+}
+
+static void test_post_fields_form() { // Server rendered setup form posts each param as own field
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/setup"));
+  TEST_ASSERT_GREATER_THAN(0, http->server().responseBody().indexOf("name=\"fields\""));
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_POST, "/config", "application/x-www-form-urlencoded", "fields=&name=ssr+form&level=6"));
+  TEST_ASSERT_EQUAL_STRING("ssr form", config->_name);
+  TEST_ASSERT_EQUAL(6, config->_level);
+  TEST_ASSERT_FALSE(config->_enabled); // Unchecked checkbox is not posted
+  TEST_ASSERT_EQUAL(400, http->server().request(HTTP_POST, "/config", "application/x-www-form-urlencoded", "fields=&name=bad&level=12"));
+  TEST_ASSERT_EQUAL_STRING("ssr form", config->_name);
+}
+
+static void test_setup_form_sections() { // Form of partly loaded config shows stored values, not defaults
+  config->setParam(2, "8");
+  config->setParam(4, "0");
+  config->save();
+
+  TestConfig loaded;
+  TestWebServer server(&loaded);
+
+  loaded.load(0);
+  server._setup();
+  TEST_ASSERT_FALSE(loaded.isLoaded(1));
+  TEST_ASSERT_EQUAL(200, server.server().request(HTTP_GET, "/setup"));
+  TEST_ASSERT_GREATER_THAN(0, server.server().responseBody().indexOf("value=\"8\""));
+  TEST_ASSERT_LESS_THAN(0, server.server().responseBody().indexOf(" checked"));
+}
+
+static void test_get_config_complex() { // Typed values with limits for script rendered setup form
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/config?section=extra&complex"));
+  TEST_ASSERT_EQUAL_STRING("{\"level\":{\"t\":\"U1\",\"v\":4,\"d\":\"Level\",\"mn\":0,\"mx\":10,\"st\":2.000000},"
+    "\"ratio\":{\"t\":\"F\",\"v\":0.50},\"enabled\":{\"t\":\"B\",\"v\":true},\"slots\":{\"t\":\"A\",\"v\":[1,2,3],\"i\":\"U2\",\"n\":3}}", http->server().responseBody().c_str());
+}
+
+static void test_post_missing_param() {
+  TEST_ASSERT_EQUAL(400, http->server().request(HTTP_POST, "/config", "application/x-www-form-urlencoded", "other=1"));
+}
+
+static void test_api_config_json() {
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_POST, "/api/config", "application/json", "{\"name\":\"raw json\",\"level\":10,\"enabled\":true}"));
+  TEST_ASSERT_EQUAL_STRING("raw json", config->_name);
+  TEST_ASSERT_EQUAL(10, config->_level);
+  TEST_ASSERT_EQUAL(400, http->server().request(HTTP_POST, "/api/config", "application/json", "{\"level\":12}"));
+  TEST_ASSERT_EQUAL_STRING("{\"level\":\"out of range\"}", http->server().responseBody().c_str());
+  TEST_ASSERT_EQUAL(415, http->server().request(HTTP_POST, "/api/config", "text/plain", "level=1"));
+  TEST_ASSERT_EQUAL(404, http->server().request(HTTP_POST, "/api/config?section=other", "application/json", "{}"));
+}
+
+static void test_api_config_msgpack() {
+  TestConfig other;
+  StreamString body;
+
+  other.clear();
+  other.setParam(0, "msgpack");
+  other.setParam(2, "2");
+  other.toMsgPack(body);
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_POST, "/api/config", "application/msgpack", body));
+  TEST_ASSERT_EQUAL_STRING("msgpack", config->_name);
+  TEST_ASSERT_EQUAL(2, config->_level);
+
+  http->server().setRequestHeader("Accept", "application/msgpack");
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/api/config"));
+  TEST_ASSERT_EQUAL_STRING("application/msgpack", http->server().responseType().c_str());
+  TEST_ASSERT_EQUAL(body.length(), http->server().responseBody().length());
+  TEST_ASSERT_EQUAL_MEMORY(body.c_str(), http->server().responseBody().c_str(), body.length());
+}
+
+#ifdef USE_METRICS
+static void test_metrics_routes() { // Script API is reported apart from form posts of /config
+  metricsReset();
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/api/config"));
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_POST, "/api/config", "application/json", "{\"level\":2}"));
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/metrics"));
+
+  const String &body = http->server().responseBody();
+
+  TEST_ASSERT_GREATER_OR_EQUAL(0, body.indexOf("_count{method=\"GET\",route=\"/api/config\"} 1\n"));
+  TEST_ASSERT_GREATER_OR_EQUAL(0, body.indexOf("_count{method=\"POST\",route=\"/api/config\"} 1\n"));
+  TEST_ASSERT_LESS_THAN(0, body.indexOf("route=\"/config\""));
+}
+#endif
+
+#ifdef USE_SCRATCH_POOL
+static void test_scratch_exhausted() { // Body buffer still checked out answers 503 instead of taking heap
+  TestConfig other;
+  StreamString body;
+  ScratchBuffer held;
+
+  other.clear();
+  other.setParam(0, "msgpack");
+  other.toMsgPack(body);
+  TEST_ASSERT_TRUE(held.acquire(body.length() + 1));
+  TEST_ASSERT_EQUAL(503, http->server().request(HTTP_POST, "/api/config", "application/msgpack", body));
+  TEST_ASSERT_EQUAL_STRING("1", http->server().responseHeader("Retry-After").c_str());
+  TEST_ASSERT_EQUAL_STRING("device", config->_name);
+  held.release();
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_POST, "/api/config", "application/msgpack", body));
+  TEST_ASSERT_EQUAL_STRING("msgpack", config->_name);
+}
+#endif
+
+#ifdef BUNDLE_KEY
+static void writeFile(const char *path, const String &content) {
+  File file = SPIFFS.open(path, "w");
+
+  file.print(content);
+  file.close();
+}
+
+static String readFile(const char *path) {
+  File file = SPIFFS.open(path, "r");
+  String result = file.readString();
+
+  file.close();
+
+  return result;
+}
+
+static String signBundle(const String &lines) { // Appends signature line as exporter does
+  br_hmac_key_context key;
+  br_hmac_context ctx;
+  uint8_t mac[32];
+  char hex[3];
+  String result = lines;
+
+  br_hmac_key_init(&key, &br_sha256_vtable, BUNDLE_KEY, strlen(BUNDLE_KEY));
+  br_hmac_init(&ctx, &key, 0);
+  br_hmac_update(&ctx, lines.c_str(), lines.length());
+  br_hmac_out(&ctx, mac);
+  result += F("sig ");
+  for (uint8_t i = 0; i < sizeof(mac); ++i) {
+    result += byteToHex(hex, mac[i]);
+  }
+  result += '\n';
+
+  return result;
+}
+
+static void assertNoStaged() {
+  Dir dir = SPIFFS.openDir("/");
+
+  while (dir.next()) {
+    TEST_ASSERT_FALSE(dir.fileName().startsWith("/bundle.tmp"));
+  }
+}
+
+static void test_bundle_roundtrip() {
+  String bundle;
+
+  writeFile("/a.txt", "alpha");
+  config->setParam(0, "exported");
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/bundle?file=/a.txt"));
+  bundle = http->server().responseBody();
+  config->setParam(0, "local");
+  writeFile("/a.txt", "changed");
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_POST, "/bundle", "text/plain", bundle));
+  TEST_ASSERT_EQUAL_STRING("exported", config->_name);
+  TEST_ASSERT_EQUAL_STRING("alpha", readFile("/a.txt").c_str());
+  assertNoStaged();
+
+  bundle.setCharAt(bundle.indexOf("YWxwaGE"), 'Z'); // Tampered file content
+  TEST_ASSERT_EQUAL(403, http->server().request(HTTP_POST, "/bundle", "text/plain", bundle));
+}
+
+static void test_bundle_bad_config() { // Files of bundle are not written when its config is rejected
+  writeFile("/a.txt", "local");
+  TEST_ASSERT_EQUAL(400, http->server().request(HTTP_POST, "/bundle", "text/plain",
+    signBundle("ESPBUNDLE 1\nfile /a.txt 6\nYnVuZGxl\nfile /b.txt 1\nYg==\nconfig\n{\"level\":70}\n")));
+  TEST_ASSERT_EQUAL_STRING("local", readFile("/a.txt").c_str());
+  TEST_ASSERT_FALSE(SPIFFS.exists("/b.txt"));
+  TEST_ASSERT_EQUAL(4, config->_level);
+  assertNoStaged();
+}
+
+static void test_bundle_store_error() { // Config is not applied when a file of bundle can not be written
+  String large;
+  String bundle;
+
+  for (uint16_t i = 0; i < 400; ++i) {
+    large += F("0123456789");
+  }
+  writeFile("/small.txt", "bundled");
+  writeFile("/large.txt", large);
+  config->setParam(0, "exported");
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/bundle?file=/small.txt&file=/large.txt"));
+  bundle = http->server().responseBody();
+  config->setParam(0, "local");
+  config->save();
+  writeFile("/small.txt", "local");
+  SPIFFS.remove("/large.txt");
+  SPIFFS.setCapacity(SPIFFS.usedBytes() + bundle.length() + 1000); // Bundle is uploaded, large file does not fit
+  TEST_ASSERT_EQUAL(500, http->server().request(HTTP_POST, "/bundle", "text/plain", bundle));
+  TEST_ASSERT_EQUAL_STRING("local", config->_name);
+  TEST_ASSERT_EQUAL_STRING("local", readFile("/small.txt").c_str());
+  TEST_ASSERT_FALSE(SPIFFS.exists("/large.txt"));
+  TEST_ASSERT_GREATER_OR_EQUAL(0, readFile("/config.json").indexOf("local"));
+  assertNoStaged();
+}
+
+static void test_bundle_config_file() { // Config files are written from values only, a bundled copy would bypass them
+  String stored = readFile("/config.json");
+
+  TEST_ASSERT_EQUAL(400, http->server().request(HTTP_GET, "/bundle?file=/config.json"));
+  TEST_ASSERT_EQUAL(400, http->server().request(HTTP_GET, "/bundle?file=/config_extra.json"));
+  TEST_ASSERT_EQUAL(400, http->server().request(HTTP_POST, "/bundle", "text/plain",
+    signBundle("ESPBUNDLE 1\nconfig\n{\"name\":\"bundled\"}\nfile /config_extra.json 2\ne30=\n")));
+  TEST_ASSERT_EQUAL_STRING("device", config->_name);
+  TEST_ASSERT_EQUAL_STRING(stored.c_str(), readFile("/config.json").c_str());
+  assertNoStaged();
+}
+
+static void test_bundle_too_large() { // Upload larger than free space is not stored
+  String bundle = signBundle("ESPBUNDLE 1\nfile /a.txt 48\nMDEyMzQ1Njc4OTAxMjM0NTY3ODkwMTIzNDU2Nzg5MDEyMzQ1Njc4OTAxMjM0NTY3\n");
+
+  SPIFFS.setCapacity(SPIFFS.usedBytes() + bundle.length() - 1);
+  TEST_ASSERT_EQUAL(413, http->server().request(HTTP_POST, "/bundle", "text/plain", bundle));
+  TEST_ASSERT_FALSE(SPIFFS.exists("/a.txt"));
+  TEST_ASSERT_FALSE(SPIFFS.exists("/bundle.tmp"));
+}
+
+static void test_bundle_rename_error() { // Config goes back when a staged file can not replace its target
+  String bundle;
+
+  writeFile("/a.txt", "alpha");
+  writeFile("/b.txt", "beta");
+  config->setParam(0, "exported");
+  TEST_ASSERT_EQUAL(200, http->server().request(HTTP_GET, "/bundle?file=/a.txt&file=/b.txt"));
+  bundle = http->server().responseBody();
+  config->setParam(0, "local");
+  config->save();
+  writeFile("/a.txt", "local");
+  SPIFFS.setRenameLimit(1);
+  TEST_ASSERT_EQUAL(500, http->server().request(HTTP_POST, "/bundle", "text/plain", bundle));
+  TEST_ASSERT_EQUAL_STRING("local", config->_name);
+  TEST_ASSERT_GREATER_OR_EQUAL(0, readFile("/config.json").indexOf("local"));
+  TEST_ASSERT_EQUAL_STRING("alpha", readFile("/a.txt").c_str()); // Renamed before failure, not rolled back
+  assertNoStaged();
+}
+
+#ifdef USE_AUTHORIZATION
+class ImportServer : public TestWebServer { // Sees body status before import is handled
+public:
+  ImportServer(const BaseConfig *config) : TestWebServer(config), bodyStatus(0) {}
+
+  void handleImport() {
+    bodyStatus = _bodyStatus;
+    TestWebServer::handleImport();
+  }
+
+  uint16_t bodyStatus;
+};
+
+static void test_bundle_unauthorized() { // Body of unknown client is not stored
+  ImportServer server(config);
+
+  server._setup();
+  TEST_ASSERT_EQUAL(401, server.server().request(HTTP_POST, "/bundle", "text/plain", signBundle("ESPBUNDLE 1\n")));
+  TEST_ASSERT_EQUAL(401, server.bodyStatus);
+}
+#endif
+#endif
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_not_found);
+  RUN_TEST(test_pages);
+  RUN_TEST(test_get_config);
+  RUN_TEST(test_clear_config);
+  RUN_TEST(test_spiffs);
+  RUN_TEST(test_spiffs_delete_list);
+  RUN_TEST(test_post_config_form);
+  RUN_TEST(test_post_fields_form);
+  RUN_TEST(test_setup_form_sections);
+  RUN_TEST(test_get_config_complex);
+  RUN_TEST(test_post_missing_param);
+  RUN_TEST(test_api_config_json);
+  RUN_TEST(test_api_config_msgpack);
+#ifdef USE_METRICS
+  RUN_TEST(test_metrics_routes);
+#endif
+#ifdef USE_SCRATCH_POOL
+  RUN_TEST(test_scratch_exhausted);
+#endif
+#ifdef BUNDLE_KEY
+  RUN_TEST(test_bundle_roundtrip);
+  RUN_TEST(test_bundle_bad_config);
+  RUN_TEST(test_bundle_store_error);
+  RUN_TEST(test_bundle_config_file);
+  RUN_TEST(test_bundle_too_large);
+  RUN_TEST(test_bundle_rename_error);
+#ifdef USE_AUTHORIZATION
+  RUN_TEST(test_bundle_unauthorized);
+#endif
+#endif
+
+  return UNITY_END();
+}
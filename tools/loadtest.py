@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+"""HTTP load generator for BaseWebServer routes.
+
+Drives a running device with a scenario file and prints p50/p99 latency,
+throughput and error count per route:
+
+  python tools/loadtest.py 192.168.4.1 tools/scenarios/portal_burst.json
+
+With --heap the device /heaptrace ring (USE_HEAPTRACE firmware) is sampled
+to add allocations per request and peak heap per route.
+
+A request with "body_from" posts back the JSON fetched once from that path
+before the run, requests listed under "cleanup" are sent once after it.
+
+The same route mixes run in process over the host shims, one client at a
+time and without network, in test/test_load (pio test -e native_bench -v).
+"""
+
+import argparse
+import base64
+import http.client
+import json
+import os
+import random
+import threading
+import time
+import uuid
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100.0))]
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.routes = {}
+        self.heap = {}
+        self.traced = set()
+
+    def add(self, route, elapsed, ok):
+        with self.lock:
+            latencies, errors = self.routes.setdefault(route, ([], [0]))
+            if ok:
+                latencies.append(elapsed)
+            else:
+                errors[0] += 1
+
+    def add_trace(self, requests):
+        with self.lock:
+            for req in requests:
+                key = (req["t"], req["r"])
+                if key in self.traced:
+                    continue
+                self.traced.add(key)
+                samples, allocs, peak = self.heap.get(req["r"], (0, 0, 0))
+                self.heap[req["r"]] = (samples + 1, allocs + req["a"], max(peak, req["p"]))
+
+    def report(self, duration):
+        heap = " %9s %7s" % ("allocs/rq", "peak,B") if self.heap else ""
+        print("%-32s %8s %6s %9s %9s %8s%s" % ("route", "requests", "errors", "p50,ms", "p99,ms", "req/s", heap))
+        total = 0
+        for route in sorted(self.routes):
+            latencies, errors = self.routes[route]
+            total += len(latencies)
+            if self.heap:
+                samples, allocs, peak = self.heap.get(route.replace("[bg] ", ""), (0, 0, 0))
+                heap = " %9.1f %7d" % (allocs / samples, peak) if samples else " %9s %7s" % ("-", "-")
+            print("%-32s %8d %6d %9.1f %9.1f %8.2f%s" % (route, len(latencies), errors[0],
+                percentile(latencies, 50) * 1000, percentile(latencies, 99) * 1000, len(latencies) / duration, heap))
+        print("%-32s %8d %6s %9s %9s %8.2f" % ("total", total, "", "", "", total / duration))
+
+
+def multipart(name, size):
+    boundary = uuid.uuid4().hex
+    body = ("--%s\r\nContent-Disposition: form-data; name=\"upload\"; filename=\"%s\"\r\n"
+        "Content-Type: application/octet-stream\r\n\r\n" % (boundary, name)).encode()
+    body += os.urandom(size)
+    body += ("\r\n--%s--\r\n" % boundary).encode()
+    return body, "multipart/form-data; boundary=" + boundary
+
+
+class Client:
+    def __init__(self, host, port, timeout, auth):
+        self.host = host
+        self.port = port
+        self.timeout = timeout
+        self.auth = auth
+
+    def get_json(self, path):
+        conn = http.client.HTTPConnection(self.host, self.port, timeout=self.timeout)
+        headers = {"Connection": "close"}
+        if self.auth:
+            headers["Authorization"] = "Basic " + self.auth
+        try:
+            conn.request("GET", path, headers=headers)
+            resp = conn.getresponse()
+            return json.loads(resp.read()) if resp.status == 200 else None
+        except (OSError, ValueError, http.client.HTTPException):
+            return None
+        finally:
+            conn.close()
+
+    def request(self, req):
+        headers = {"Connection": "close"}
+        if self.auth:
+            headers["Authorization"] = "Basic " + self.auth
+        if "host" in req:
+            headers["Host"] = req["host"]
+        headers.update(req.get("headers", {}))
+        body = req.get("body")
+        if isinstance(body, (dict, list)):
+            body = json.dumps(body)
+            headers.setdefault("Content-Type", "application/json")
+        if "upload" in req:
+            body, headers["Content-Type"] = multipart(req["upload"], req.get("size", 4096))
+        conn = http.client.HTTPConnection(self.host, self.port, timeout=self.timeout)
+        start = time.monotonic()
+        try:
+            conn.request(req.get("method", "GET"), req["path"], body, headers)
+            resp = conn.getresponse()
+            resp.read()
+            ok = resp.status < 500 and resp.status != 401
+        except (OSError, http.client.HTTPException):
+            ok = False
+        finally:
+            conn.close()
+        return time.monotonic() - start, ok
+
+
+def route_name(req):
+    return "%s %s" % (req.get("method", "GET"), req["path"].split("?")[0])
+
+
+def worker(client, requests, weights, think, deadline, stats):
+    while time.monotonic() < deadline:
+        req = random.choices(requests, weights)[0]
+        elapsed, ok = client.request(req)
+        stats.add(route_name(req), elapsed, ok)
+        if think:
+            time.sleep(random.uniform(0.5, 1.5) * think)
+
+
+def background(client, req, deadline, stats):
+    while time.monotonic() < deadline:
+        elapsed, ok = client.request(req)
+        stats.add("[bg] " + route_name(req), elapsed, ok)
+
+
+def heap_poller(client, deadline, stats):
+    # Ring holds the last 16 requests, so fast scenarios are sampled rather than traced in full
+    while time.monotonic() < deadline + 1:
+        requests = client.get_json("/heaptrace")
+        if requests:
+            stats.add_trace(requests)
+        time.sleep(0.5)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host", help="device address, host[:port]")
+    parser.add_argument("scenario", help="scenario JSON file")
+    parser.add_argument("-c", "--concurrency", type=int, help="override scenario concurrency")
+    parser.add_argument("-d", "--duration", type=float, help="override scenario duration, seconds")
+    parser.add_argument("-u", "--user", help="basic authorization as user:password")
+    parser.add_argument("-t", "--timeout", type=float, default=10.0)
+    parser.add_argument("--heap", action="store_true", help="sample per-request heap usage from /heaptrace")
+    args = parser.parse_args()
+
+    with open(args.scenario) as f:
+        scenario = json.load(f)
+    host, _, port = args.host.partition(":")
+    auth = base64.b64encode(args.user.encode()).decode() if args.user else None
+    client = Client(host, int(port or 80), args.timeout, auth)
+    concurrency = args.concurrency or scenario.get("concurrency", 1)
+    duration = args.duration or scenario.get("duration", 10)
+    requests = scenario["requests"]
+    for req in requests + scenario.get("background", []):
+        if "body_from" in req:
+            req["body"] = client.get_json(req["body_from"])
+            if req["body"] is None:
+                parser.error("cannot fetch %s" % req["body_from"])
+    weights = [r.get("weight", 1) for r in requests]
+
+    print("%s: %d clients for %.0f s" % (scenario.get("name", args.scenario), concurrency, duration))
+    stats = Stats()
+    deadline = time.monotonic() + duration
+    threads = [threading.Thread(target=worker, args=(client, requests, weights, scenario.get("think", 0), deadline, stats))
+        for _ in range(concurrency)]
+    threads += [threading.Thread(target=background, args=(client, req, deadline, stats))
+        for req in scenario.get("background", [])]
+    if args.heap:
+        threads.append(threading.Thread(target=heap_poller, args=(client, deadline, stats)))
+    start = time.monotonic()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.monotonic() - start
+    for req in scenario.get("cleanup", []):
+        client.request(req)
+    stats.report(elapsed)
+
+
+if __name__ == "__main__":
+    main()